@@ -0,0 +1,82 @@
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include "infini_operators.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct Options {
+    std::vector<std::string> ops;// empty for every operator
+    uint64_t max_tokens = 8192;
+    uint64_t max_bytes = uint64_t(1) << 30;
+    double min_time = 0.2;// seconds measured per case at least
+    int min_iterations = 10, max_iterations = 1000;
+    DataLayout dt = F16;
+    std::string json;
+};
+
+// peak of this machine, measured with the threads operators use
+struct Roofline {
+    int threads;
+    double gflops, gbps;
+};
+
+Roofline measure_roofline(int threads);
+
+struct Result {
+    std::string op, name, shape;
+    int iterations;
+    // latencies in microseconds
+    double min, p50, p90, p99, mean;
+    double flops, bytes;
+};
+
+// Data and layout of a tensor, filled with small random numbers. The layout
+// is inline, so a buffer stays where it was constructed.
+class Buffer {
+public:
+    // `strides` counts elements, empty for a contiguous tensor
+    Buffer(DataLayout dt, std::vector<uint64_t> const &shape, std::vector<int64_t> strides = {});
+    Buffer(const Buffer &) = delete;
+    ~Buffer();
+
+    Tensor tensor() { return {&_layout, _data}; }
+    TensorDescriptor layout() { return &_layout; }
+    // bytes the tensor covers, which a kernel reads or writes once
+    size_t bytes() const { return _bytes; }
+
+private:
+    TensorLayout _layout;
+    void *_data;
+    size_t _bytes;
+};
+
+// times the cases of every operator and keeps the results
+class Bench {
+public:
+    Bench(Options const &options, Roofline const &roofline) : _options(options), _roofline(roofline) {}
+
+    // whether a case is selected and fits, asked before allocating for it
+    bool wants(std::string const &op, uint64_t tokens, double bytes);
+    // time `f` and record it
+    void run(std::string const &op, std::string const &name, std::string const &shape,
+             double flops, double bytes, std::function<void()> const &f);
+
+    Options const &options() const { return _options; }
+    std::vector<Result> const &results() const { return _results; }
+    // time `result` would take at the roofline over the time it took
+    double efficiency(Result const &result) const;
+
+private:
+    Options const &_options;
+    Roofline _roofline;
+    std::vector<Result> _results;
+};
+
+// every case of every operator, sweeping decode and prefill LLM shapes
+void bench_operators(Bench &bench);
+
+#endif// __BENCH_H__
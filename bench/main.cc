@@ -0,0 +1,198 @@
+#include "bench.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <random>
+
+Buffer::Buffer(DataLayout dt, std::vector<uint64_t> const &shape, std::vector<int64_t> strides) {
+    if (strides.empty()) {
+        strides.resize(shape.size());
+        int64_t stride = 1;
+        for (size_t i = shape.size(); i-- > 0;) {
+            strides[i] = stride;
+            stride *= shape[i];
+        }
+    }
+    // the highest element the strides reach, plus one
+    size_t elements = 1;
+    for (size_t i = 0; i < shape.size(); ++i) {
+        elements += (shape[i] - 1) * strides[i];
+        strides[i] *= dt.size;
+    }
+    _bytes = elements * dt.size;
+    initTensorDescriptor(&_layout, shape.size(), shape.data(), strides.data(), dt);
+    _data = operator new(_bytes, std::align_val_t(64));
+
+    // numbers in [-1, 1) whatever the type, so no kernel meets inf or nan
+    std::mt19937 rng{uint32_t(_bytes)};
+    if (dt.exponent == 0) {
+        std::memset(_data, 0, _bytes);
+    } else if (dt.size == 2) {
+        auto p = static_cast<uint16_t *>(_data);
+        for (size_t i = 0; i < elements; ++i) {
+            auto bits = rng();
+            // exponent just below 1 in fp16 or bf16, random mantissa and sign
+            p[i] = dt.mantissa == 10 ? uint16_t(0x3800 | (bits & 0x3ff) | (bits >> 16 & 0x8000))
+                                     : uint16_t(0x3f00 | (bits & 0x7f) | (bits >> 16 & 0x8000));
+        }
+    } else if (dt.size == 4) {
+        auto p = static_cast<float *>(_data);
+        for (size_t i = 0; i < elements; ++i) {
+            p[i] = std::uniform_real_distribution<float>(-1, 1)(rng);
+        }
+    } else {
+        std::memset(_data, 0, _bytes);
+    }
+}
+
+Buffer::~Buffer() {
+    operator delete(_data, std::align_val_t(64));
+}
+
+bool Bench::wants(std::string const &op, uint64_t tokens, double bytes) {
+    auto const &ops = _options.ops;
+    return (ops.empty() || std::find(ops.begin(), ops.end(), op) != ops.end()) &&
+           tokens <= _options.max_tokens &&
+           bytes <= double(_options.max_bytes);
+}
+
+void Bench::run(std::string const &op, std::string const &name, std::string const &shape,
+                double flops, double bytes, std::function<void()> const &f) {
+    using clock = std::chrono::steady_clock;
+    // the first calls fault pages in and grow the arena
+    f();
+    f();
+
+    std::vector<double> times;
+    auto begin = clock::now();
+    while (int(times.size()) < _options.max_iterations &&
+           (int(times.size()) < _options.min_iterations ||
+            std::chrono::duration<double>(clock::now() - begin).count() < _options.min_time)) {
+        auto t0 = clock::now();
+        f();
+        times.push_back(std::chrono::duration<double, std::micro>(clock::now() - t0).count());
+    }
+    std::sort(times.begin(), times.end());
+    auto at = [&](double q) { return times[std::min(times.size() - 1, size_t(q * times.size()))]; };
+    double sum = 0;
+    for (auto t : times) {
+        sum += t;
+    }
+    _results.push_back({op, name, shape, int(times.size()), times.front(), at(0.5), at(0.9), at(0.99), sum / times.size(), flops, bytes});
+
+    auto const &r = _results.back();
+    printf("%-16s %-16s %-18s %10.1f %10.1f %10.1f %9.1f %8.1f %6.1f%%\n",
+           op.c_str(), name.c_str(), shape.c_str(), r.p50, r.p90, r.p99,
+           flops / r.p50 * 1e-3, bytes / r.p50 * 1e-3, efficiency(r) * 100);
+    fflush(stdout);
+}
+
+double Bench::efficiency(Result const &result) const {
+    auto bound = std::max(result.flops / (_roofline.gflops * 1e3), result.bytes / (_roofline.gbps * 1e3));
+    return bound / result.p50;
+}
+
+static void usage(char const *program) {
+    printf("usage: %s [options]\n"
+           "  --ops a,b,...      operators to run (default all)\n"
+           "  --max-tokens n     largest prefill length (default 8192)\n"
+           "  --max-mb n         skip cases touching more memory (default 1024)\n"
+           "  --min-time s       seconds measured per case at least (default 0.2)\n"
+           "  --iterations n     calls measured per case at least (default 10)\n"
+           "  --dtype f16|bf16|f32\n"
+           "  --json file        write the results as JSON\n",
+           program);
+}
+
+static std::vector<std::string> split(char const *list) {
+    std::vector<std::string> items;
+    std::string s(list);
+    size_t pos = 0;
+    while (pos <= s.size()) {
+        auto next = std::min(s.find(',', pos), s.size());
+        if (next > pos) {
+            items.push_back(s.substr(pos, next - pos));
+        }
+        pos = next + 1;
+    }
+    return items;
+}
+
+static char const *dtype_name(DataLayout dt) {
+    return dt.size == 4 ? "f32" : dt.mantissa == 10 ? "f16" : "bf16";
+}
+
+static void write_json(Options const &options, Roofline const &roofline, Bench const &bench) {
+    auto const &results = bench.results();
+    std::ofstream out(options.json);
+    out << "{\n  \"dtype\": \"" << dtype_name(options.dt) << "\",\n"
+        << "  \"machine\": {\"threads\": " << roofline.threads
+        << ", \"peak_gflops\": " << roofline.gflops
+        << ", \"bandwidth_gbps\": " << roofline.gbps << "},\n"
+        << "  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        auto const &r = results[i];
+        out << (i ? ",\n" : "\n")
+            << "    {\"op\": \"" << r.op << "\", \"case\": \"" << r.name << "\", \"shape\": \"" << r.shape << "\""
+            << ", \"iterations\": " << r.iterations
+            << ", \"latency_us\": {\"min\": " << r.min << ", \"p50\": " << r.p50 << ", \"p90\": " << r.p90
+            << ", \"p99\": " << r.p99 << ", \"mean\": " << r.mean << "}"
+            << ", \"flops\": " << r.flops << ", \"bytes\": " << r.bytes
+            << ", \"gflops\": " << r.flops / r.p50 * 1e-3
+            << ", \"gbps\": " << r.bytes / r.p50 * 1e-3
+            << ", \"roofline\": " << bench.efficiency(r) << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        auto arg = argv[i];
+        auto value = [&] {
+            if (i + 1 == argc) {
+                usage(argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            return argv[++i];
+        };
+        if (!strcmp(arg, "--ops")) {
+            options.ops = split(value());
+        } else if (!strcmp(arg, "--max-tokens")) {
+            options.max_tokens = std::strtoull(value(), nullptr, 10);
+        } else if (!strcmp(arg, "--max-mb")) {
+            options.max_bytes = std::strtoull(value(), nullptr, 10) << 20;
+        } else if (!strcmp(arg, "--min-time")) {
+            options.min_time = std::atof(value());
+        } else if (!strcmp(arg, "--iterations")) {
+            options.min_iterations = std::max(1, std::atoi(value()));
+            options.max_iterations = std::max(options.max_iterations, options.min_iterations);
+        } else if (!strcmp(arg, "--dtype")) {
+            auto dt = std::string(value());
+            options.dt = dt == "f32" ? F32 : dt == "bf16" ? BF16 : F16;
+        } else if (!strcmp(arg, "--json")) {
+            options.json = value();
+        } else {
+            usage(argv[0]);
+            return strcmp(arg, "--help") ? EXIT_FAILURE : EXIT_SUCCESS;
+        }
+    }
+
+    auto roofline = measure_roofline(getCpuThreadPoolSize());
+    printf("%d threads, peak %.1f GFLOP/s, %.1f GB/s, %s\n\n",
+           roofline.threads, roofline.gflops, roofline.gbps, dtype_name(options.dt));
+    printf("%-16s %-16s %-18s %10s %10s %10s %9s %8s %7s\n",
+           "op", "case", "shape", "p50 us", "p90 us", "p99 us", "GFLOP/s", "GB/s", "roof");
+
+    Bench bench(options, roofline);
+    bench_operators(bench);
+
+    if (!options.json.empty()) {
+        write_json(options, roofline, bench);
+    }
+    return 0;
+}
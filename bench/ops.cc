@@ -0,0 +1,345 @@
+#include "bench.h"
+#include <algorithm>
+
+// hidden size, heads and feed-forward size of the models swept
+struct Model {
+    uint64_t hidden, heads, ffn;
+};
+constexpr static Model MODELS[] = {{4096, 32, 11008}, {8192, 64, 28672}};
+constexpr static uint64_t HEAD_DIM = 128;
+constexpr static uint64_t VOCAB = 32000;
+// experts of a mixture, each of a slice of the ffn, and those a token goes to
+constexpr static uint64_t EXPERTS = 8, TOP_K = 2;
+// decode is 1 token, prefill a prompt of the others
+constexpr static uint64_t TOKENS[] = {1, 512, 2048, 8192};
+// context a decoded token attends to
+constexpr static uint64_t DECODE_CONTEXT = 4096;
+
+static std::string phase(uint64_t tokens) {
+    return tokens == 1 ? "decode" : "prefill";
+}
+
+static std::string dims(std::vector<uint64_t> const &shape) {
+    std::string s;
+    for (auto d : shape) {
+        s += (s.empty() ? "" : "x") + std::to_string(d);
+    }
+    return s;
+}
+
+// caller-owned scratch memory of the size a descriptor asks for
+struct Workspace {
+    Buffer buffer;
+    uint64_t size;
+
+    explicit Workspace(uint64_t size) : buffer(U8, {std::max(size, uint64_t(1))}), size(size) {}
+    void *data() { return size ? buffer.tensor().data : nullptr; }
+};
+
+// rows of a vocabulary table gathered for the tokens, scattered across it
+static void bench_embedding(Bench &bench, uint64_t tokens, uint64_t hidden) {
+    auto dt = bench.options().dt;
+    if (!bench.wants("embedding", tokens, double(VOCAB * hidden + tokens * hidden) * dt.size)) {
+        return;
+    }
+    Buffer y(dt, {tokens, hidden}), table(dt, {VOCAB, hidden}), indices(I32, {tokens});
+    auto index = static_cast<int32_t *>(indices.tensor().data);
+    for (uint64_t i = 0; i < tokens; ++i) {
+        index[i] = int32_t(i * 7919 % VOCAB);
+    }
+    EmbeddingConfig config{y.layout(), table.layout(), indices.layout(), nullptr};
+    auto descriptor = (EmbeddingDescriptor *) createEmbeddingDescriptor(DevCpu, &config);
+    bench.run("embedding", phase(tokens), dims({tokens, hidden}),
+              0, double(2 * y.bytes() + indices.bytes()), [&] {
+                  embedding(descriptor, nullptr, 0, y.tensor(), table.tensor(), indices.tensor(), {nullptr, nullptr}, nullptr);
+              });
+    destroyEmbeddingDescriptor(descriptor);
+}
+
+// the token of a decode step drawn from the logits, or straight from the
+// last hidden state and the output weight so the logits are never stored
+static void bench_sample(Bench &bench, uint64_t tokens, uint64_t hidden) {
+    auto dt = bench.options().dt;
+    if (tokens != 1 || !bench.wants("sample", tokens, double(VOCAB * hidden) * dt.size)) {
+        return;
+    }
+    Buffer result(I32, {tokens}), logits(dt, {tokens, VOCAB}), x(dt, {tokens, hidden}),
+        weight(dt, {hidden, VOCAB}, {1, int64_t(hidden)});
+    auto descriptor = (SampleDescriptor *) createSampleDescriptor(DevCpu, nullptr);
+    bench.run("sample", "top50", dims({tokens, VOCAB}),
+              2.0 * tokens * VOCAB, double(logits.bytes()), [&] {
+                  sample(descriptor, nullptr, 0, result.tensor(), logits.tensor(), 0.8f, 50, 0.9f, 0, nullptr);
+              });
+    bench.run("sample", "matmul/top50", dims({tokens, VOCAB, hidden}),
+              2.0 * tokens * VOCAB * hidden, double(x.bytes() + weight.bytes()), [&] {
+                  sampleMatmul(descriptor, nullptr, 0, result.tensor(), x.tensor(), weight.tensor(), 0.8f, 50, 0.9f, 0, nullptr);
+              });
+    destroySampleDescriptor(descriptor);
+}
+
+// c = a * b^T, b stored as a weight of `n` rows of `k`
+static void bench_matmul(Bench &bench, std::string const &name, uint64_t m, uint64_t n, uint64_t k) {
+    auto dt = bench.options().dt;
+    if (!bench.wants("matmul", m, double(m * k + n * k + m * n) * dt.size)) {
+        return;
+    }
+    Buffer c(dt, {m, n}), a(dt, {m, k}), b(dt, {k, n}, {1, int64_t(k)});
+    MatmulConfig config{c.layout(), a.layout(), b.layout()};
+    auto descriptor = createMatmulDescriptor(DevCpu, &config);
+    uint64_t size;
+    getMatmulWorkspaceSize(descriptor, &size);
+    Workspace workspace(size);
+    bench.run("matmul", name + "/" + phase(m), dims({m, n, k}),
+              2.0 * m * n * k, double(c.bytes() + a.bytes() + b.bytes()), [&] {
+                  matmul(descriptor, workspace.data(), size, c.tensor(), 0, a.tensor(), b.tensor(), 1, nullptr);
+              });
+    destroyMatmulDescriptor(descriptor);
+}
+
+// the up projection of every expert of a mixture over the tokens routed to
+// it, weights stored as in `bench_matmul`, in one grouped call; the share of
+// the tokens an expert gets grows with its index, the first ones few or none
+static void bench_matmul_grouped(Bench &bench, uint64_t tokens, uint64_t hidden, uint64_t ffn) {
+    auto dt = bench.options().dt;
+    auto m = tokens * TOP_K, n = ffn / EXPERTS;
+    if (!bench.wants("matmul", m, double(m * hidden + EXPERTS * n * hidden + m * n) * dt.size)) {
+        return;
+    }
+    Buffer c(dt, {m, n}), a(dt, {m, hidden}), b(dt, {EXPERTS, hidden, n}, {int64_t(n * hidden), 1, int64_t(hidden)}), cu_seqlens(I64, {EXPERTS + 1});
+    auto offsets = static_cast<int64_t *>(cu_seqlens.tensor().data);
+    for (uint64_t e = 0; e <= EXPERTS; ++e) {
+        offsets[e] = int64_t(m * e * e / (EXPERTS * EXPERTS));
+    }
+    MatmulConfig config{c.layout(), a.layout(), b.layout(), nullptr, cu_seqlens.layout(), nullptr};
+    auto descriptor = createMatmulDescriptor(DevCpu, &config);
+    uint64_t size;
+    getMatmulWorkspaceSize(descriptor, &size);
+    Workspace workspace(size);
+    bench.run("matmul", "moe_up/" + phase(tokens), dims({m, n, hidden}),
+              2.0 * m * n * hidden, double(c.bytes() + a.bytes() + b.bytes()), [&] {
+                  matmulGrouped(descriptor, workspace.data(), size, c.tensor(), 0, a.tensor(), b.tensor(), cu_seqlens.tensor(), Tensor{nullptr, nullptr}, 1, nullptr);
+              });
+    destroyMatmulDescriptor(descriptor);
+}
+
+// routing of the tokens of `bench_matmul_grouped` to their experts and back
+static void bench_moe(Bench &bench, uint64_t tokens, uint64_t hidden) {
+    auto dt = bench.options().dt;
+    auto rows = tokens * TOP_K;
+    if (!bench.wants("moe", tokens, double(2 * rows * hidden + tokens * hidden) * dt.size)) {
+        return;
+    }
+    Buffer weights(F32, {tokens, TOP_K}), experts(I32, {tokens, TOP_K}), logits(dt, {tokens, EXPERTS}),
+        permuted(dt, {rows, hidden}), cu_seqlens(I64, {EXPERTS + 1}), positions(I32, {tokens, TOP_K}), x(dt, {tokens, hidden});
+    MoeConfig config{weights.layout(), experts.layout(), logits.layout(), permuted.layout(), cu_seqlens.layout(), positions.layout(), x.layout(), x.layout()};
+    auto descriptor = (MoeDescriptor *) createMoeDescriptor(DevCpu, &config);
+    uint64_t size;
+    getMoeWorkspaceSize(descriptor, &size);
+    Workspace workspace(size);
+    bench.run("moe", "gate/" + phase(tokens), dims({tokens, EXPERTS}),
+              4.0 * tokens * EXPERTS, double(logits.bytes() + weights.bytes() + experts.bytes()), [&] {
+                  moeGate(descriptor, nullptr, 0, weights.tensor(), experts.tensor(), logits.tensor(), 1, nullptr);
+              });
+    bench.run("moe", "permute/" + phase(tokens), dims({rows, hidden}),
+              0, double(permuted.bytes() + x.bytes() + positions.bytes() + experts.bytes()), [&] {
+                  moePermute(descriptor, workspace.data(), size, permuted.tensor(), cu_seqlens.tensor(), positions.tensor(), x.tensor(), experts.tensor(), nullptr);
+              });
+    bench.run("moe", "unpermute/" + phase(tokens), dims({rows, hidden}),
+              2.0 * rows * hidden, double(permuted.bytes() + x.bytes() + positions.bytes() + weights.bytes()), [&] {
+                  moeUnpermute(descriptor, nullptr, 0, x.tensor(), permuted.tensor(), positions.tensor(), weights.tensor(), nullptr);
+              });
+    destroyMoeDescriptor(descriptor);
+}
+
+static void bench_rms_norm(Bench &bench, uint64_t tokens, uint64_t hidden) {
+    auto dt = bench.options().dt;
+    if (!bench.wants("rms_norm", tokens, double(2 * tokens * hidden + hidden) * dt.size)) {
+        return;
+    }
+    Buffer y(dt, {tokens, hidden}), x(dt, {tokens, hidden}), w(dt, {hidden});
+    RMSNormConfig config{y.layout(), x.layout(), w.layout()};
+    auto descriptor = (RMSNormDescriptor *) createRMSNormDescriptor(DevCpu, &config);
+    bench.run("rms_norm", phase(tokens), dims({tokens, hidden}),
+              4.0 * tokens * hidden, double(y.bytes() + x.bytes() + w.bytes()), [&] {
+                  rmsNorm(descriptor, nullptr, 0, y.tensor(), x.tensor(), w.tensor(), 1e-5f, nullptr);
+              });
+    destroyRMSNormDescriptor(descriptor);
+}
+
+// activations to int8 per token as an integer matmul takes them, plain
+// and normalized on the way
+static void bench_quantize(Bench &bench, uint64_t tokens, uint64_t hidden) {
+    auto dt = bench.options().dt;
+    if (!bench.wants("quantize", tokens, double(tokens * hidden) * (dt.size + 1))) {
+        return;
+    }
+    Buffer q(I8, {tokens, hidden}), scales(F32, {tokens}), x(dt, {tokens, hidden}), w(dt, {hidden});
+    for (auto norm : {false, true}) {
+        QuantizeConfig config{q.layout(), scales.layout(), nullptr, x.layout(), norm ? w.layout() : nullptr};
+        auto descriptor = (QuantizeDescriptor *) createQuantizeDescriptor(DevCpu, &config);
+        bench.run("quantize", std::string(norm ? "rms_norm/" : "") + phase(tokens), dims({tokens, hidden}),
+                  (norm ? 7.0 : 3.0) * tokens * hidden, double(q.bytes() + scales.bytes() + x.bytes() + (norm ? w.bytes() : 0)), [&] {
+                      if (norm) {
+                          quantizeRMSNorm(descriptor, nullptr, 0, q.tensor(), scales.tensor(), Tensor{nullptr, nullptr}, x.tensor(), w.tensor(), 1e-5f, nullptr);
+                      } else {
+                          quantize(descriptor, nullptr, 0, q.tensor(), scales.tensor(), Tensor{nullptr, nullptr}, x.tensor(), nullptr);
+                      }
+                  });
+        destroyQuantizeDescriptor(descriptor);
+    }
+}
+
+static void bench_layer_norm(Bench &bench, uint64_t tokens, uint64_t hidden) {
+    auto dt = bench.options().dt;
+    if (!bench.wants("layer_norm", tokens, double(2 * tokens * hidden + 2 * hidden) * dt.size)) {
+        return;
+    }
+    Buffer y(dt, {tokens, hidden}), x(dt, {tokens, hidden}), w(dt, {hidden}), b(dt, {hidden});
+    LayerNormConfig config{y.layout(), x.layout(), w.layout(), b.layout(), nullptr};
+    auto descriptor = (LayerNormDescriptor *) createLayerNormDescriptor(DevCpu, &config);
+    bench.run("layer_norm", phase(tokens), dims({tokens, hidden}),
+              8.0 * tokens * hidden, double(y.bytes() + x.bytes() + w.bytes() + b.bytes()), [&] {
+                  layerNorm(descriptor, nullptr, 0, y.tensor(), x.tensor(), w.tensor(), b.tensor(), {nullptr, nullptr}, 1e-5f, nullptr);
+              });
+    destroyLayerNormDescriptor(descriptor);
+}
+
+// scores of every head, `rows` queries over `columns` keys
+static void bench_causal_softmax(Bench &bench, uint64_t tokens, uint64_t heads, uint64_t rows, uint64_t columns) {
+    auto dt = bench.options().dt;
+    if (!bench.wants("causal_softmax", tokens, double(heads * rows * columns) * dt.size)) {
+        return;
+    }
+    Buffer y(dt, {heads, rows, columns});
+    CausalSoftmaxConfig config{y.layout()};
+    auto descriptor = createCausalSoftmaxDescriptor(DevCpu, &config);
+    uint64_t size;
+    getCausalSoftmaxWorkspaceSize(descriptor, &size);
+    Workspace workspace(size);
+    // max, exp, sum and scale of every element, read and written once
+    bench.run("causal_softmax", phase(tokens), dims({heads, rows, columns}),
+              4.0 * heads * rows * columns, 2.0 * y.bytes(), [&] {
+                  causalSoftmax(descriptor, workspace.data(), size, y.tensor(), nullptr);
+              });
+    destroyCausalSoftmaxDescriptor(descriptor);
+}
+
+static void bench_rotary_embedding(Bench &bench, uint64_t tokens, uint64_t heads) {
+    auto dt = bench.options().dt;
+    if (!bench.wants("rotary_embedding", tokens, double(tokens * heads * HEAD_DIM) * dt.size)) {
+        return;
+    }
+    Buffer t(dt, {tokens, heads, HEAD_DIM}), pos(U32, {tokens});
+    RotaryEmbeddingConfig config{t.layout(), pos.layout()};
+    auto descriptor = (RotaryEmbeddingDescriptor *) createRotaryEmbeddingDescriptor(DevCpu, &config);
+    // a 2x2 rotation of every pair, not counting sin and cos
+    bench.run("rotary_embedding", phase(tokens), dims({tokens, heads, HEAD_DIM}),
+              3.0 * tokens * heads * HEAD_DIM, double(2 * t.bytes() + pos.bytes()), [&] {
+                  rotaryEmbedding(descriptor, nullptr, 0, t.tensor(), pos.tensor(), 1e4f, nullptr);
+              });
+    destroyRotaryEmbeddingDescriptor(descriptor);
+}
+
+// keys and values of the tokens written to a head-major cache, k rotated on
+// the way, then to one of int8 with a scale per slot
+static void bench_kv_cache_append(Bench &bench, uint64_t tokens, uint64_t heads) {
+    auto dt = bench.options().dt;
+    auto capacity = std::max(tokens, DECODE_CONTEXT);
+    if (!bench.wants("kv_cache_append", tokens, double(2 * (capacity + tokens) * heads * HEAD_DIM) * dt.size)) {
+        return;
+    }
+    Buffer k(dt, {tokens, heads, HEAD_DIM}), v(dt, {tokens, heads, HEAD_DIM}), slots(I32, {tokens}), pos(U32, {tokens}),
+        k_scales(F32, {heads, capacity}), v_scales(F32, {heads, capacity});
+    auto slot = static_cast<int32_t *>(slots.tensor().data);
+    for (uint64_t i = 0; i < tokens; ++i) {
+        slot[i] = int32_t(i);
+    }
+    for (auto quantized : {false, true}) {
+        auto cache_dt = quantized ? I8 : dt;
+        Buffer k_cache(cache_dt, {heads, capacity, HEAD_DIM}), v_cache(cache_dt, {heads, capacity, HEAD_DIM});
+        auto scales = [&](Buffer &buffer) { return quantized ? buffer.tensor() : Tensor{nullptr, nullptr}; };
+        KVCacheAppendConfig config{k_cache.layout(), v_cache.layout(), scales(k_scales).layout, scales(v_scales).layout,
+                                   k.layout(), v.layout(), slots.layout(), pos.layout()};
+        auto descriptor = (KVCacheAppendDescriptor *) createKVCacheAppendDescriptor(DevCpu, &config);
+        bench.run("kv_cache_append", std::string(quantized ? "rotary/i8/" : "rotary/") + phase(tokens), dims({tokens, heads, HEAD_DIM}),
+                  3.0 * tokens * heads * HEAD_DIM / 2, double(k.bytes() + v.bytes()) * (1 + double(cache_dt.size) / dt.size) + slots.bytes() + pos.bytes(), [&] {
+                      kvCacheAppend(descriptor, nullptr, 0, k_cache.tensor(), v_cache.tensor(), scales(k_scales), scales(v_scales),
+                                    k.tensor(), v.tensor(), slots.tensor(), pos.tensor(), 1e4f, nullptr);
+                  });
+        destroyKVCacheAppendDescriptor(descriptor);
+    }
+}
+
+static void bench_swiglu(Bench &bench, uint64_t tokens, uint64_t ffn) {
+    auto dt = bench.options().dt;
+    if (!bench.wants("swiglu", tokens, double(2 * tokens * ffn) * dt.size)) {
+        return;
+    }
+    Buffer gate(dt, {tokens, ffn}), up(dt, {tokens, ffn});
+    SwigluConfig config{gate.layout(), up.layout()};
+    auto descriptor = (SwigluDescriptor *) createSwigluDescriptor(DevCpu, &config);
+    bench.run("swiglu", phase(tokens), dims({tokens, ffn}),
+              4.0 * tokens * ffn, double(2 * gate.bytes() + up.bytes()), [&] {
+                  swiglu(descriptor, nullptr, 0, gate.tensor(), up.tensor(), nullptr);
+              });
+    destroySwigluDescriptor(descriptor);
+}
+
+static void bench_activation(Bench &bench, uint64_t tokens, uint64_t ffn) {
+    auto dt = bench.options().dt;
+    if (!bench.wants("activation", tokens, double(2 * tokens * ffn) * dt.size)) {
+        return;
+    }
+    Buffer y(dt, {tokens, ffn}), x(dt, {tokens, ffn});
+    ActivationConfig config{y.layout(), x.layout()};
+    auto descriptor = (ActivationDescriptor *) createActivationDescriptor(DevCpu, ActGeluTanh, &config);
+    bench.run("activation", "gelu/" + phase(tokens), dims({tokens, ffn}),
+              8.0 * tokens * ffn, double(y.bytes() + x.bytes()), [&] {
+                  activation(descriptor, nullptr, 0, y.tensor(), x.tensor(), nullptr);
+              });
+    destroyActivationDescriptor(descriptor);
+}
+
+// (tokens, heads, head_dim) to (heads, tokens, head_dim), as attention does
+static void bench_reform(Bench &bench, uint64_t tokens, uint64_t heads) {
+    auto dt = bench.options().dt;
+    if (!bench.wants("reform", tokens, double(2 * tokens * heads * HEAD_DIM) * dt.size)) {
+        return;
+    }
+    Buffer y(dt, {heads, tokens, HEAD_DIM}),
+        x(dt, {heads, tokens, HEAD_DIM}, {int64_t(HEAD_DIM), int64_t(heads * HEAD_DIM), 1});
+    ReformConfig config{y.layout(), x.layout()};
+    auto descriptor = createReformDescriptor(DevCpu, &config);
+    bench.run("reform", phase(tokens), dims({heads, tokens, HEAD_DIM}),
+              0, double(y.bytes() + x.bytes()), [&] {
+                  reform(descriptor, nullptr, 0, y.tensor(), x.tensor(), nullptr);
+              });
+    destroyReformDescriptor(descriptor);
+}
+
+void bench_operators(Bench &bench) {
+    for (auto const &model : MODELS) {
+        for (auto tokens : TOKENS) {
+            bench_embedding(bench, tokens, model.hidden);
+            bench_matmul(bench, "proj", tokens, model.hidden, model.hidden);
+            bench_matmul(bench, "ffn_up", tokens, model.ffn, model.hidden);
+            bench_matmul(bench, "ffn_down", tokens, model.hidden, model.ffn);
+            bench_matmul_grouped(bench, tokens, model.hidden, model.ffn);
+            bench_moe(bench, tokens, model.hidden);
+            bench_rms_norm(bench, tokens, model.hidden);
+            bench_layer_norm(bench, tokens, model.hidden);
+            bench_quantize(bench, tokens, model.hidden);
+            if (tokens == 1) {
+                bench_causal_softmax(bench, tokens, model.heads, 1, DECODE_CONTEXT);
+            } else {
+                bench_causal_softmax(bench, tokens, model.heads, tokens, tokens);
+            }
+            bench_rotary_embedding(bench, tokens, model.heads);
+            bench_kv_cache_append(bench, tokens, model.heads);
+            bench_swiglu(bench, tokens, model.ffn);
+            bench_activation(bench, tokens, model.ffn);
+            bench_reform(bench, tokens, model.heads);
+            bench_sample(bench, tokens, model.hidden);
+        }
+    }
+}
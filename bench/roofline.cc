@@ -0,0 +1,70 @@
+#include "bench.h"
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+// run `f(thread)` on `threads` threads at once, returning the seconds taken
+template<class F>
+static double timed(int threads, F const &f) {
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t) {
+        workers.emplace_back(f, t);
+    }
+    f(0);
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+// Independent multiply-add chains, wide enough for the compiler to fill
+// every vector register and hide the latency of each.
+constexpr static int CHAINS = 64;
+constexpr static int64_t FMA_ROUNDS = 1 << 22;
+
+static float fma_loop(float a, float b) {
+    float acc[CHAINS];
+    for (int j = 0; j < CHAINS; ++j) {
+        acc[j] = float(j);
+    }
+    for (int64_t i = 0; i < FMA_ROUNDS; ++i) {
+        for (int j = 0; j < CHAINS; ++j) {
+            acc[j] = acc[j] * a + b;
+        }
+    }
+    float sum = 0;
+    for (int j = 0; j < CHAINS; ++j) {
+        sum += acc[j];
+    }
+    return sum;
+}
+
+Roofline measure_roofline(int threads) {
+    Roofline roofline{threads, 0, 0};
+
+    // best of a few runs, each kept from being optimized away by its result
+    std::vector<float> sink(threads);
+    for (int repeat = 0; repeat < 3; ++repeat) {
+        auto seconds = timed(threads, [&](int t) { sink[t] = fma_loop(0.999f, 0.001f); });
+        roofline.gflops = std::max(roofline.gflops, 2.0 * CHAINS * FMA_ROUNDS * threads / seconds * 1e-9);
+    }
+
+    // triad a = b + s * c over arrays far bigger than the caches
+    size_t n = size_t(32) << 20;
+    std::unique_ptr<float[]> a(new float[n]), b(new float[n]), c(new float[n]);
+    auto part = [&](int t, auto const &body) {
+        auto begin = n * t / threads,
+             end = n * (t + 1) / threads;
+        for (size_t i = begin; i < end; ++i) {
+            body(i);
+        }
+    };
+    timed(threads, [&](int t) { part(t, [&](size_t i) { a[i] = 0, b[i] = 1, c[i] = 2; }); });
+    for (int repeat = 0; repeat < 5; ++repeat) {
+        auto seconds = timed(threads, [&](int t) { part(t, [&](size_t i) { a[i] = b[i] + 0.5f * c[i]; }); });
+        roofline.gbps = std::max(roofline.gbps, 3.0 * n * sizeof(float) / seconds * 1e-9);
+    }
+    return roofline;
+}
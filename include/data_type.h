@@ -23,7 +23,10 @@ const static struct DataLayout
     F16  = {1, 1, 2, 10,  5},
     BF16 = {1, 1, 2,  7,  8},
     F32  = {1, 1, 4, 23,  8},
-    F64  = {1, 1, 8, 52, 11};
+    F64  = {1, 1, 8, 52, 11},
+    // OCP 8-bit floats: E4M3 has no infinities and saturates at 448
+    F8E4M3 = {1, 1, 1, 3, 4},
+    F8E5M2 = {1, 1, 1, 2, 5};
 // clang-format on
 
 #endif// __DATA_TYPE_H__
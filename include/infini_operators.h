@@ -1,7 +1,21 @@
+#include "ops/activation/activation.h"
 #include "ops/causal_softmax/causal_softmax.h"
+#include "ops/embedding/embedding.h"
+#include "ops/kv_cache_append/kv_cache_append.h"
+#include "ops/layer_norm/layer_norm.h"
 #include "ops/matmul/matmul.h"
+#include "ops/moe/moe.h"
+#include "ops/quantize/quantize.h"
 #include "ops/reform/reform.h"
 #include "ops/rms_norm/rms_norm.h"
 #include "ops/rotary_embedding/rotary_embedding.h"
+#include "ops/sample/sample.h"
 #include "ops/swiglu/swiglu.h"
+#include "runtime/graph.h"
+#include "runtime/numa.h"
+#include "runtime/profile.h"
+#include "runtime/stream.h"
+#include "runtime/thread_pool.h"
+#include "runtime/tuning.h"
+#include "runtime/weights.h"
 #include "tensor/tensor_descriptor.h"
@@ -0,0 +1,31 @@
+#ifndef ACTIVATION_H
+#define ACTIVATION_H
+
+#include "../../export.h"
+#include "../../operators.h"
+
+typedef enum ActivationType {
+    ActSilu,
+    ActGeluTanh,
+    ActGeluErf,
+    ActRelu,
+} ActivationType;
+
+// Optional config of `createActivationDescriptor`: the layouts of every later call, planned once.
+// For `gatedActivation`, `y` is the gate and `x` is the up projection.
+typedef struct ActivationConfig {
+    TensorDescriptor y, x;
+} ActivationConfig;
+
+typedef struct ActivationDescriptor ActivationDescriptor;
+
+__C __export void *createActivationDescriptor(Device, ActivationType, void *config);
+__C __export void destroyActivationDescriptor(ActivationDescriptor *descriptor);
+
+__C __export void getActivationWorkspaceSize(ActivationDescriptor *descriptor, uint64_t *size);
+// y = act(x)
+__C __export void activation(ActivationDescriptor *descriptor, void *workspace, uint64_t workspace_size, Tensor y, Tensor x, void *stream);
+// gate = act(gate) * up
+__C __export void gatedActivation(ActivationDescriptor *descriptor, void *workspace, uint64_t workspace_size, Tensor gate, Tensor up, void *stream);
+
+#endif
@@ -4,11 +4,30 @@
 #include "../../export.h"
 #include "../../operators.h"
 
+// Optional config of `createCausalSoftmaxDescriptor`: the layouts of every later call, planned once.
+// The offsets are NULL but for `causalSoftmaxVarlen`, `cu_seqlens_k` there too when it is not given.
+typedef struct CausalSoftmaxConfig {
+    TensorDescriptor y, cu_seqlens_q, cu_seqlens_k;
+} CausalSoftmaxConfig;
+
 typedef struct CausalSoftmaxDescriptor CausalSoftmaxDescriptor;
 
 __C __export CausalSoftmaxDescriptor *createCausalSoftmaxDescriptor(Device, void *config);
 __C __export void destroyCausalSoftmaxDescriptor(CausalSoftmaxDescriptor *descriptor);
-__C __export void causalSoftmax(CausalSoftmaxDescriptor *descriptor, Tensor y, void *stream);
+
+// bytes of scratch memory a call needs, see `getMatmulWorkspaceSize`
+__C __export void getCausalSoftmaxWorkspaceSize(CausalSoftmaxDescriptor *descriptor, uint64_t *size);
+__C __export void causalSoftmax(CausalSoftmaxDescriptor *descriptor, void *workspace, uint64_t workspace_size, Tensor y, void *stream);
+
+// `causalSoftmax` of the scores of sequences of different lengths packed
+// in one batch. `y` (heads, total_q, columns) holds the queries of every
+// sequence one after another, as the offsets `cu_seqlens_q` (sequences + 1)
+// tell, each row scoring the keys of its own sequence from column 0. These
+// are as many as its queries, or as `cu_seqlens_k` tells when given, so a
+// sequence may go on from keys already cached. Columns past them are zeroed.
+// Offsets are I32 or I64, starting at 0. Cpu only.
+__C __export void causalSoftmaxVarlen(CausalSoftmaxDescriptor *descriptor, void *workspace, uint64_t workspace_size, Tensor y,
+                                      Tensor cu_seqlens_q, Tensor cu_seqlens_k, void *stream);
 
 
 #endif
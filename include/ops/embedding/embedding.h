@@ -0,0 +1,27 @@
+#ifndef EMBEDDING_H
+#define EMBEDDING_H
+
+#include "../../export.h"
+#include "../../operators.h"
+
+// Optional config of `createEmbeddingDescriptor`: the layouts of every later call, planned once.
+// `scales` is NULL unless the table is quantized.
+typedef struct EmbeddingConfig {
+    TensorDescriptor y, table, indices, scales;
+} EmbeddingConfig;
+
+typedef struct EmbeddingDescriptor EmbeddingDescriptor;
+
+__C __export void *createEmbeddingDescriptor(Device, void *config);
+
+__C __export void destroyEmbeddingDescriptor(EmbeddingDescriptor *descriptor);
+
+__C __export void getEmbeddingWorkspaceSize(EmbeddingDescriptor *descriptor, uint64_t *size);
+
+// y[i] = table[indices[i]] for `y` (n, hidden), `table` (vocab, hidden) and
+// `indices` (n) of I32 or I64, rows of either possibly strided. A table of
+// the type of `y` is copied as is; an I8 table is dequantized on the way,
+// row v scaled by `scales[v]`, (vocab) of any float type.
+__C __export void embedding(EmbeddingDescriptor *descriptor, void *workspace, uint64_t workspace_size, Tensor y, Tensor table, Tensor indices, Tensor scales, void *stream);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef KV_CACHE_APPEND_H
+#define KV_CACHE_APPEND_H
+
+#include "../../export.h"
+#include "../../operators.h"
+
+// Optional config of `createKVCacheAppendDescriptor`: the layouts of every
+// later call, planned once. The scales are NULL unless the caches are
+// quantized, and `pos` unless k is rotated.
+typedef struct KVCacheAppendConfig {
+    TensorDescriptor k_cache, v_cache, k_scales, v_scales, k, v, slots, pos;
+} KVCacheAppendConfig;
+
+typedef struct KVCacheAppendDescriptor KVCacheAppendDescriptor;
+
+__C __export void *createKVCacheAppendDescriptor(Device, void *config);
+__C __export void destroyKVCacheAppendDescriptor(KVCacheAppendDescriptor *descriptor);
+
+__C __export void getKVCacheAppendWorkspaceSize(KVCacheAppendDescriptor *descriptor, uint64_t *size);
+
+// Writes the keys and values `k` and `v` (tokens, kv_heads, dh) of every
+// token to slot `slots[i]` (tokens) of the caches, I32 or I64. A cache is
+// either (kv_heads, capacity, dh), or paged as (blocks, kv_heads,
+// block_size, dh) with slot s in block s / block_size, in any strides
+// contiguous along dh. Slots wrap around the capacity, so that a sliding
+// window keeps its cache as a ring buffer, and negative slots are skipped.
+// No two tokens of a call may land in the same slot. When `pos` (tokens)
+// is given, k is written rotated as `rotaryEmbedding` would at these
+// positions; `k` itself is left as is.
+//
+// Caches of I8, F8E4M3 or F8E5M2 hold x / scale, rounded and saturated.
+// Their F32 scales are either (kv_heads), fixed by the caller, or shaped
+// as the cache without dh, one per slot and head, which every append sets
+// to the largest magnitude of the row over the largest value the type
+// holds. 8-bit floats may do without scales. `matmulDequant` reads such a
+// cache back inside its loops.
+__C __export void kvCacheAppend(KVCacheAppendDescriptor *descriptor, void *workspace, uint64_t workspace_size,
+                                Tensor k_cache, Tensor v_cache, Tensor k_scales, Tensor v_scales,
+                                Tensor k, Tensor v, Tensor slots, Tensor pos, float theta, void *stream);
+
+#endif
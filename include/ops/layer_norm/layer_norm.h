@@ -0,0 +1,26 @@
+#ifndef LAYER_NORM_H
+#define LAYER_NORM_H
+
+#include "../../export.h"
+#include "../../operators.h"
+
+// Optional config of `createLayerNormDescriptor`: the layouts of every later
+// call, planned once. `b` and `residual` are NULL when there are none.
+typedef struct LayerNormConfig {
+    TensorDescriptor y, x, w, b, residual;
+} LayerNormConfig;
+
+typedef struct LayerNormDescriptor LayerNormDescriptor;
+
+__C __export void *createLayerNormDescriptor(Device, void *config);
+__C __export void destroyLayerNormDescriptor(LayerNormDescriptor *descriptor);
+
+__C __export void getLayerNormWorkspaceSize(LayerNormDescriptor *descriptor, uint64_t *size);
+
+// y = (x - mean) / sqrt(variance + epsilon) * w + b over every row of `x`
+// (n, d), `b` optional. With a `residual` (n, d), x + residual is written
+// to it first and normalized instead of x, as the add before the norm of a
+// transformer block would. Tensors given as absent have a NULL layout.
+__C __export void layerNorm(LayerNormDescriptor *descriptor, void *workspace, uint64_t workspace_size, Tensor y, Tensor x, Tensor w, Tensor b, Tensor residual, float epsilon, void *stream);
+
+#endif
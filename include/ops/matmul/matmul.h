@@ -4,12 +4,58 @@
 #include "../../export.h"
 #include "../../operators.h"
 
+// Optional config of `createMatmulDescriptor`. When given, the layouts are
+// validated and the kernel is planned once, and every later call must use
+// tensors with exactly these layouts. `b_scales` is NULL but for
+// `matmulDequant`, `cu_seqlens` and `b_index` but for `matmulGrouped`.
+typedef struct MatmulConfig {
+    TensorDescriptor c, a, b, b_scales, cu_seqlens, b_index;
+} MatmulConfig;
+
 typedef struct MatmulDescriptor MatmulDescriptor;
 
 __C __export MatmulDescriptor *createMatmulDescriptor(Device, void *config);
 
 __C __export void destroyMatmulDescriptor(MatmulDescriptor *descriptor);
 
-__C __export void matmul(MatmulDescriptor *descriptor, Tensor c, float beta, Tensor a, Tensor b, float alpha, void *stream);
+// Bytes of scratch memory a call needs, for a descriptor created with a
+// config and the current cpu thread pool. Calls given a NULL workspace use
+// memory of the library instead.
+__C __export void getMatmulWorkspaceSize(MatmulDescriptor *descriptor, uint64_t *size);
+
+// c = beta * c + alpha * a * b over the last two dimensions, summed in
+// F32. c, a and b are each F16, BF16 or F32, independently: F16 or BF16
+// inputs may give an F32 result, as logits or a residual stream kept in
+// F32 want, and F32 activations may meet F16 weights, with no pass
+// converting either. Cuda takes a and b of one type.
+//
+// The dimensions before are a batch of up to 8, which a and b broadcast
+// to that of c as numpy does, lacking leading ones or having 1 or a stride
+// of 0 where they repeat: grouped query attention multiplies queries of
+// (batch, kv_heads, group, seq, dh) by keys of (batch, kv_heads, 1, dh,
+// seq) without copying them for every head of a group. Cuda and Bang take
+// one batch dimension once those of length 1 are dropped and contiguous
+// ones merged.
+__C __export void matmul(MatmulDescriptor *descriptor, void *workspace, uint64_t workspace_size, Tensor c, float beta, Tensor a, Tensor b, float alpha, void *stream);
+
+// `matmul` of a `b` held as I8, F8E4M3 or F8E5M2, each element multiplied
+// by its F32 scale as it is read. `b_scales` has the dimensions of `b`,
+// any of them 1 to share a scale along it: the keys of a quantized cache
+// with one scale per slot and head are (kv_heads, 1, seq) against
+// (kv_heads, dh, seq), and its values (kv_heads, seq, 1). 8-bit floats
+// may do without scales. Cpu only.
+__C __export void matmulDequant(MatmulDescriptor *descriptor, void *workspace, uint64_t workspace_size,
+                                Tensor c, float beta, Tensor a, Tensor b, Tensor b_scales, float alpha, void *stream);
+
+// `matmul` of groups of rows of different counts in one call, as the
+// experts of a mixture each take their own tokens. The rows of `a`
+// (rows, k) and `c` (rows, n) of group g are [cu_seqlens[g],
+// cu_seqlens[g + 1]), `cu_seqlens` (groups + 1) being I32 or I64 from 0,
+// and are multiplied by the matrix b[g] of `b` (matrices, k, n), or
+// b[b_index[g]] when `b_index` (groups), I32 or I64, is given, so that
+// requests may share LoRA adapters. The tiles of every group are spread
+// over the threads together. Cpu only.
+__C __export void matmulGrouped(MatmulDescriptor *descriptor, void *workspace, uint64_t workspace_size,
+                                Tensor c, float beta, Tensor a, Tensor b, Tensor cu_seqlens, Tensor b_index, float alpha, void *stream);
 
 #endif
@@ -0,0 +1,46 @@
+#ifndef MOE_H
+#define MOE_H
+
+#include "../../export.h"
+#include "../../operators.h"
+
+// Optional config of `createMoeDescriptor`: the layouts of every later
+// call, planned once. Each of `moeGate`, `moePermute` and `moeUnpermute`
+// is planned when all of the layouts it takes are given, and the others
+// may be NULL.
+typedef struct MoeConfig {
+    TensorDescriptor weights, experts, logits, permuted, cu_seqlens, positions, x, y;
+} MoeConfig;
+
+typedef struct MoeDescriptor MoeDescriptor;
+
+__C __export void *createMoeDescriptor(Device, void *config);
+__C __export void destroyMoeDescriptor(MoeDescriptor *descriptor);
+
+// bytes of scratch memory a call needs, see `getMatmulWorkspaceSize`
+__C __export void getMoeWorkspaceSize(MoeDescriptor *descriptor, uint64_t *size);
+
+// Route every token to the k experts of highest router `logits` (tokens,
+// experts), written to `experts` (tokens, k), I32 or I64, from the best
+// down, the first of equal logits ahead. Their softmax probabilities over
+// all experts go to `weights` (tokens, k) in F32, renormalized to sum to 1
+// over the k when `normalize` is not 0.
+__C __export void moeGate(MoeDescriptor *descriptor, void *workspace, uint64_t workspace_size,
+                          Tensor weights, Tensor experts, Tensor logits, int normalize, void *stream);
+
+// Gather the rows of `x` (tokens, d) into `permuted` (tokens * k, d)
+// grouped by expert as `matmulGrouped` takes them: those of expert e are
+// [cu_seqlens[e], cu_seqlens[e + 1]), in the order of their tokens, and
+// `cu_seqlens` (experts + 1), I32 or I64, is written. `positions` (tokens,
+// k), I32 or I64, receives the row of `permuted` that each expert of
+// `experts` (tokens, k) got its token at.
+__C __export void moePermute(MoeDescriptor *descriptor, void *workspace, uint64_t workspace_size,
+                             Tensor permuted, Tensor cu_seqlens, Tensor positions, Tensor x, Tensor experts, void *stream);
+
+// Combine the outputs of the experts back in token order: y[t] (tokens,
+// d) is the sum over j of weights[t, j] * permuted[positions[t, j]],
+// accumulated in F32.
+__C __export void moeUnpermute(MoeDescriptor *descriptor, void *workspace, uint64_t workspace_size,
+                               Tensor y, Tensor permuted, Tensor positions, Tensor weights, void *stream);
+
+#endif
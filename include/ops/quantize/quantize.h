@@ -0,0 +1,39 @@
+#ifndef QUANTIZE_H
+#define QUANTIZE_H
+
+#include "../../export.h"
+#include "../../operators.h"
+
+// Optional config of `createQuantizeDescriptor`: the layouts of every later
+// call, planned once. `zeros` is NULL when quantization is symmetric, and
+// `w` unless the config is for `quantizeRMSNorm`.
+typedef struct QuantizeConfig {
+    TensorDescriptor q, scales, zeros, x, w;
+} QuantizeConfig;
+
+typedef struct QuantizeDescriptor QuantizeDescriptor;
+
+__C __export void *createQuantizeDescriptor(Device, void *config);
+__C __export void destroyQuantizeDescriptor(QuantizeDescriptor *descriptor);
+
+__C __export void getQuantizeWorkspaceSize(QuantizeDescriptor *descriptor, uint64_t *size);
+
+// Quantize every row of `x` (n, d) into `q` (n, d) with a scale of its own,
+// written to `scales` (n) in F32. Without `zeros` it is symmetric, q in I8
+// and x / scale rounded with scale = max |x| / 127. Otherwise the zero
+// point of every row is written to `zeros` (n) in I32, and x / scale + zero
+// spans the whole range of q, I8 or U8, from min(x, 0) to max(x, 0), so
+// that 0 stays exact.
+__C __export void quantize(QuantizeDescriptor *descriptor, void *workspace, uint64_t workspace_size,
+                           Tensor q, Tensor scales, Tensor zeros, Tensor x, void *stream);
+
+// `quantize` of `rmsNorm` of x with `w` (d), the normalized rows never
+// written out in floating point.
+__C __export void quantizeRMSNorm(QuantizeDescriptor *descriptor, void *workspace, uint64_t workspace_size,
+                                  Tensor q, Tensor scales, Tensor zeros, Tensor x, Tensor w, float epsilon, void *stream);
+
+// x = (q - zero) * scale for every row, undoing `quantize`
+__C __export void dequantize(QuantizeDescriptor *descriptor, void *workspace, uint64_t workspace_size,
+                             Tensor x, Tensor q, Tensor scales, Tensor zeros, void *stream);
+
+#endif
@@ -3,10 +3,18 @@
 
 #include "../../export.h"
 #include "../../operators.h"
+
+// Optional config of `createReformDescriptor`: the layouts of every later call, planned once.
+typedef struct ReformConfig {
+    TensorDescriptor y, x;
+} ReformConfig;
+
 typedef struct ReformDescriptor ReformDescriptor;
 
 __C __export ReformDescriptor *createReformDescriptor(Device, void *config);
 __C __export void destroyReformDescriptor(ReformDescriptor *descriptor);
-__C __export void reform(ReformDescriptor *descriptor, Tensor y, Tensor x, void *stream);
+
+__C __export void getReformWorkspaceSize(ReformDescriptor *descriptor, uint64_t *size);
+__C __export void reform(ReformDescriptor *descriptor, void *workspace, uint64_t workspace_size, Tensor y, Tensor x, void *stream);
 
 #endif
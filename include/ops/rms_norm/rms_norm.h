@@ -4,10 +4,17 @@
 #include "../../export.h"
 #include "../../operators.h"
 
+// Optional config of `createRMSNormDescriptor`: the layouts of every later call, planned once.
+typedef struct RMSNormConfig {
+    TensorDescriptor y, x, w;
+} RMSNormConfig;
+
 typedef struct RMSNormDescriptor RMSNormDescriptor;
 
 __C __export void *createRMSNormDescriptor(Device, void *config);
 __C __export void destroyRMSNormDescriptor(RMSNormDescriptor *descriptor);
-__C __export void rmsNorm(RMSNormDescriptor *descriptor, Tensor y, Tensor x, Tensor w, float epsilon, void *stream);
+
+__C __export void getRMSNormWorkspaceSize(RMSNormDescriptor *descriptor, uint64_t *size);
+__C __export void rmsNorm(RMSNormDescriptor *descriptor, void *workspace, uint64_t workspace_size, Tensor y, Tensor x, Tensor w, float epsilon, void *stream);
 
 #endif
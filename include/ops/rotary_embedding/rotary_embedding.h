@@ -4,10 +4,26 @@
 #include "../../export.h"
 #include "../../operators.h"
 
+// Optional config of `createRotaryEmbeddingDescriptor`: the layouts of every later call, planned once.
+// `pos` is NULL for `rotaryEmbeddingVarlen`, the others but for it, and `start_pos` when it is not given.
+typedef struct RotaryEmbeddingConfig {
+    TensorDescriptor t, pos, cu_seqlens, start_pos;
+} RotaryEmbeddingConfig;
+
 typedef struct RotaryEmbeddingDescriptor RotaryEmbeddingDescriptor;
 
 __C __export void *createRotaryEmbeddingDescriptor(Device, void *config);
 __C __export void destroyRotaryEmbeddingDescriptor(RotaryEmbeddingDescriptor *descriptor);
-__C __export void rotaryEmbedding(RotaryEmbeddingDescriptor *descriptor, Tensor t, Tensor pos, float theta, void *stream);
+
+__C __export void getRotaryEmbeddingWorkspaceSize(RotaryEmbeddingDescriptor *descriptor, uint64_t *size);
+__C __export void rotaryEmbedding(RotaryEmbeddingDescriptor *descriptor, void *workspace, uint64_t workspace_size, Tensor t, Tensor pos, float theta, void *stream);
+
+// `rotaryEmbedding` of the tokens of sequences of different lengths packed
+// one after another in `t`, as the offsets `cu_seqlens` (sequences + 1),
+// I32 or I64 from 0, tell. The tokens of every sequence are at positions
+// counted from 0, or from its entry of `start_pos` (sequences), U32 or I32,
+// the tokens it has already cached. Cpu only.
+__C __export void rotaryEmbeddingVarlen(RotaryEmbeddingDescriptor *descriptor, void *workspace, uint64_t workspace_size, Tensor t,
+                                        Tensor cu_seqlens, Tensor start_pos, float theta, void *stream);
 
 #endif
@@ -0,0 +1,38 @@
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+#include "../../export.h"
+#include "../../operators.h"
+
+// Optional config of `createSampleDescriptor`: the layouts of every later
+// call, planned once. `logits` is set for `sample`, or `hidden` and `weight`
+// for `sampleMatmul`, the others NULL.
+typedef struct SampleConfig {
+    TensorDescriptor result, logits, hidden, weight;
+} SampleConfig;
+
+typedef struct SampleDescriptor SampleDescriptor;
+
+__C __export void *createSampleDescriptor(Device, void *config);
+
+__C __export void destroySampleDescriptor(SampleDescriptor *descriptor);
+
+// bytes of scratch memory a call needs, see `getMatmulWorkspaceSize`
+__C __export void getSampleWorkspaceSize(SampleDescriptor *descriptor, uint64_t *size);
+
+// Draw a token of every row of `logits` (batch, vocab) into `result`
+// (batch), I32 or I64. Only the `topk` most likely tokens are kept, all of
+// them when it is 0, then only the most likely of those that together hold
+// a fraction `topp` of their probability, softmax at `temperature`. A token
+// is drawn among these with a generator seeded by `seed` and the row. With
+// `topk` 1 or `temperature` 0 it is the argmax, the first of equal logits.
+__C __export void sample(SampleDescriptor *descriptor, void *workspace, uint64_t workspace_size, Tensor result, Tensor logits,
+                         float temperature, uint64_t topk, float topp, uint64_t seed, void *stream);
+
+// `sample` of the logits `hidden` (batch, dim) times `weight` (dim, vocab),
+// computed a slice at a time so they are never written out. `weight` must
+// be contiguous along one of its dimensions.
+__C __export void sampleMatmul(SampleDescriptor *descriptor, void *workspace, uint64_t workspace_size, Tensor result, Tensor hidden, Tensor weight,
+                               float temperature, uint64_t topk, float topp, uint64_t seed, void *stream);
+
+#endif
@@ -4,10 +4,17 @@
 #include "../../export.h"
 #include "../../operators.h"
 
+// Optional config of `createSwigluDescriptor`: the layouts of every later call, planned once.
+typedef struct SwigluConfig {
+    TensorDescriptor gate, up;
+} SwigluConfig;
+
 typedef struct SwigluDescriptor SwigluDescriptor;
 
 __C __export void *createSwigluDescriptor(Device, void *config);
 __C __export void destroySwigluDescriptor(SwigluDescriptor *descriptor);
-__C __export void swiglu(SwigluDescriptor *descriptor, Tensor gate, Tensor up, void *stream);
+
+__C __export void getSwigluWorkspaceSize(SwigluDescriptor *descriptor, uint64_t *size);
+__C __export void swiglu(SwigluDescriptor *descriptor, void *workspace, uint64_t workspace_size, Tensor gate, Tensor up, void *stream);
 
 #endif
@@ -0,0 +1,31 @@
+#ifndef GRAPH_H
+#define GRAPH_H
+
+#include "../export.h"
+#include <stdint.h>
+
+// From `beginCpuStreamCapture` until `endCpuStreamCapture`, operator calls
+// on the stream are recorded rather than run, validated and planned once.
+// The returned graph replays all of them in order with a single launch. The
+// descriptors used must outlive the graph.
+__C __export void beginCpuStreamCapture(void *stream);
+
+__C __export void *endCpuStreamCapture(void *stream);
+
+__C __export void destroyCpuGraph(void *graph);
+
+// Every data pointer of the graph inside [old_data, old_data + size), or
+// equal to old_data when size is 0, is moved by the same offset to new_data.
+typedef struct {
+    void *old_data;
+    void *new_data;
+    uint64_t size;
+} CpuGraphBinding;
+
+// rebinds the data of the graph for later launches
+__C __export void updateCpuGraph(void *graph, CpuGraphBinding const *bindings, int num_bindings);
+
+// runs the graph on `stream`, or at once when `stream` is NULL
+__C __export void launchCpuGraph(void *graph, void *stream);
+
+#endif// GRAPH_H
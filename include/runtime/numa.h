@@ -0,0 +1,30 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include "../export.h"
+#include <stdint.h>
+
+typedef enum {
+    // rows are split across nodes in the proportion the cpu thread pool is,
+    // which is how matmul splits the output rows of a weight
+    NumaSplit,
+    // pages are spread round-robin over the nodes
+    NumaInterleave,
+} NumaPlacement;
+
+// number of NUMA nodes the cpu thread pool spans
+__C __export int getNumaNodeCount();
+
+// Page aligned memory none of whose pages have been touched yet, so that
+// `numaPlace` decides the node each one resides on.
+__C __export void *numaAllocate(uint64_t size);
+
+__C __export void numaFree(void *ptr, uint64_t size);
+
+// Fill memory from `numaAllocate` with `rows` rows of `row_bytes` copied from
+// `src`, or zeros when `src` is NULL, touching every page from a worker of
+// the node it is placed on. Place prepacked weights this way before the
+// first matmul reads them.
+__C __export void numaPlace(void *dst, void const *src, uint64_t rows, uint64_t row_bytes, NumaPlacement placement);
+
+#endif// NUMA_H
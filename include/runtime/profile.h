@@ -0,0 +1,39 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "../export.h"
+#include <stdint.h>
+
+// Calls of one operator on one shape bucket: the data type and the shape of
+// its output with every dimension rounded up to a power of two (for matmul
+// the reduced dimension too). Latencies are in microseconds, percentiles
+// within about 5%. A call on a stream is timed until it is queued only.
+typedef struct OpProfile {
+    char op[32];
+    char shape[64];
+    uint64_t calls;
+    double total_us, min_us, max_us, p50_us, p90_us, p99_us;
+    double bytes, flops;
+} OpProfile;
+
+// Profiling starts enabled when the INFINI_PROFILE environment variable is
+// set to anything but 0. When it names a file, the trace is written there
+// at exit. A disabled profiler costs every call one relaxed load.
+__C __export void setProfiling(int enabled);
+
+__C __export int isProfiling();
+
+// number of (operator, shape bucket) entries recorded so far
+__C __export uint64_t getProfileCount();
+
+// entries are ordered by first call
+__C __export void getProfile(uint64_t index, OpProfile *profile);
+
+// drop every entry and trace event
+__C __export void resetProfile();
+
+// Write the calls recorded as Chrome trace JSON, for chrome://tracing or
+// Perfetto. Holds the last 1M calls. Returns 0 on success.
+__C __export int dumpProfileTrace(char const *path);
+
+#endif// PROFILE_H
@@ -0,0 +1,33 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "../export.h"
+
+// An ordered queue of cpu operator calls, the counterpart of a cuda stream.
+// Passed as the `stream` of an operator created on DevCpu, the call returns
+// at once and runs after every call queued before it. The descriptor and
+// the tensor data must stay valid until the call has run.
+__C __export void *createCpuStream();
+
+// waits for every queued call before releasing the stream
+__C __export void destroyCpuStream(void *stream);
+
+__C __export void synchronizeCpuStream(void *stream);
+
+// Marks a position of a stream, to wait for the calls queued before it
+// without waiting for the whole stream.
+__C __export void *createCpuEvent();
+
+__C __export void destroyCpuEvent(void *event);
+
+__C __export void recordCpuEvent(void *event, void *stream);
+
+// 1 when every call before the recorded position has run, 0 otherwise
+__C __export int queryCpuEvent(void *event);
+
+__C __export void synchronizeCpuEvent(void *event);
+
+// calls queued on `stream` from now on run after the event is reached
+__C __export void cpuStreamWaitEvent(void *stream, void *event);
+
+#endif// STREAM_H
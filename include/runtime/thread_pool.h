@@ -0,0 +1,14 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include "../export.h"
+
+// Restart the workers shared by every cpu operator with `num_threads` threads,
+// the calling thread included. When `cores` is not NULL, worker i is pinned to
+// cores[i % num_cores], so that several processes can run on disjoint cores.
+// `num_threads` <= 0 uses every core available to the process.
+__C __export void setCpuThreadPool(int num_threads, int const *cores, int num_cores);
+
+__C __export int getCpuThreadPoolSize();
+
+#endif// THREAD_POOL_H
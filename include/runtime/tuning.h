@@ -0,0 +1,24 @@
+#ifndef TUNING_H
+#define TUNING_H
+
+#include "../export.h"
+
+// In autotuning mode, creating a descriptor with a config benchmarks
+// candidate configs of its cpu kernel, such as the blocking and threads of
+// matmul, unless the tuning cache has its layouts already, and adds the
+// fastest to the cache. Otherwise cached configs are used when present and
+// built-in ones when not. INFINI_AUTOTUNE=1 enables it at startup.
+__C __export void setAutotune(int enabled);
+
+__C __export int isAutotuning();
+
+// The cache is read at startup from INFINI_TUNING_CACHE, by default
+// ~/.cache/infini/tuning.txt, and rewritten there with every new result,
+// keeping what other processes sharing the file wrote in the meantime.
+// Entries are keyed by cpu model, and a cache of another library version
+// is ignored. Loading also switches the file written to. Return 0 on success.
+__C __export int loadTuningCache(char const *path);
+
+__C __export int saveTuningCache(char const *path);
+
+#endif// TUNING_H
@@ -0,0 +1,44 @@
+#ifndef WEIGHTS_H
+#define WEIGHTS_H
+
+#include "../export.h"
+#include "../tensor.h"
+#include <stdint.h>
+
+typedef struct WeightFile WeightFile;
+
+// Map a safetensors file read only and parse its header, or return NULL
+// when it cannot be read or is malformed. Weights are views of the mapped
+// file, so nothing is copied and processes opening the same file share its
+// pages. Tensors of a data type the library has no layout for are not given
+// as weights, but their bytes are carried into a sidecar. Duplicate names, an
+// unpaired surrogate escape or data outside the file make it malformed.
+__C __export WeightFile *openWeightFile(char const *path);
+
+// Unmap the file and destroy the descriptors of its weights, none of which
+// may still be in use.
+__C __export void closeWeightFile(WeightFile *file);
+
+__C __export uint64_t getWeightCount(WeightFile *file);
+
+// name of the `index`-th weight, in the order of their data in the file
+__C __export char const *getWeightName(WeightFile *file, uint64_t index);
+
+// The named weight, with a descriptor owned by `file`, or a tensor whose
+// layout and data are NULL when there is none. Its data are read only.
+__C __export Tensor getWeight(WeightFile *file, char const *name);
+
+// value of `key` in the string metadata of the header, or NULL
+__C __export char const *getWeightMetadata(WeightFile *file, char const *key);
+
+// Write every tensor of `file` to `path` as safetensors, the data starting at
+// a multiple of 64 bytes and each tensor aligned to its element size without
+// gaps between them, with the `count` weights of `names` stored transposed in their last
+// two dimensions. Name the weights a matmul takes as b (..., k, n) dense
+// along n: they are then contiguous along k, the layout matmul packs b to,
+// and `openWeightFile` of `path` gives them the same shape with strides
+// that matmul reads without packing. Open such a sidecar on later starts in
+// place of the original. Return 0 on success.
+__C __export int writePackedWeights(WeightFile *file, char const *path, char const *const *names, uint64_t count);
+
+#endif// WEIGHTS_H
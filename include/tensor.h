@@ -4,11 +4,18 @@
 #include "data_type.h"
 #include <stdint.h>
 
+// tensors of at most this many dimensions keep their shape and strides inline
+#define TENSOR_INLINE_NDIM 8
+
 struct TensorLayout {
     struct DataLayout dt;
     uint64_t ndim;
     uint64_t *shape;
     int64_t *strides;
+    // where `shape` and `strides` point when `ndim` fits, so a layout must
+    // not be copied by value
+    uint64_t inline_shape[TENSOR_INLINE_NDIM];
+    int64_t inline_strides[TENSOR_INLINE_NDIM];
 };
 
 typedef struct TensorLayout *TensorDescriptor;
@@ -4,8 +4,26 @@
 #include "../export.h"
 #include "../tensor.h"
 
+// Allocates a single block when `ndim` is at most `TENSOR_INLINE_NDIM`.
 __C __export void createTensorDescriptor(TensorDescriptor* desc_ptr, uint64_t ndim, uint64_t *shape_, int64_t *strides_, DataLayout datatype);
 
 __C __export void destroyTensorDescriptor(TensorDescriptor desc);
 
+// Fill caller-owned `layout` without allocating, `ndim` must be at most
+// `TENSOR_INLINE_NDIM`. It needs no destroy, and `layout` serves as its
+// descriptor for as long as it stays in place.
+__C __export void initTensorDescriptor(struct TensorLayout *layout, uint64_t ndim, uint64_t const *shape, int64_t const *strides, DataLayout datatype);
+
+// Shared descriptor of the given data type, shape and strides, created on
+// first request and owned by the library; a lookup does not allocate. The
+// cache never evicts, so a descriptor stays valid until
+// `clearTensorDescriptorCache`, and every distinct layout requested is kept
+// until then. Use it for the bounded set of layouts of a model, and
+// `initTensorDescriptor` for those that change from call to call.
+__C __export void getCachedTensorDescriptor(TensorDescriptor *desc_ptr, uint64_t ndim, uint64_t const *shape, int64_t const *strides, DataLayout datatype);
+
+// Destroy every cached descriptor. None may still be in use, including by
+// calls queued on a stream or captured in a graph.
+__C __export void clearTensorDescriptorCache();
+
 #endif// TENSOR_DESCRIPTOR_H
@@ -24,3 +24,5 @@ F16 = DataLayout(1, 1, 2, 10, 5)
 BF16 = DataLayout(1, 1, 2, 7, 8)
 F32 = DataLayout(1, 1, 4, 23, 8)
 F64 = DataLayout(1, 1, 8, 52, 11)
+F8E4M3 = DataLayout(1, 1, 1, 3, 4)
+F8E5M2 = DataLayout(1, 1, 1, 2, 5)
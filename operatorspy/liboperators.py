@@ -8,6 +8,7 @@ Device = c_int
 Optype = c_int
 
 LIB_OPERATORS_DIR = "INFINI_ROOT"
+TENSOR_INLINE_NDIM = 8
 
 
 class TensorLayout(Structure):
@@ -16,6 +17,8 @@ class TensorLayout(Structure):
         ("ndim", c_uint64),
         ("shape", POINTER(c_uint64)),
         ("pattern", POINTER(c_int64)),
+        ("inline_shape", c_uint64 * TENSOR_INLINE_NDIM),
+        ("inline_pattern", c_int64 * TENSOR_INLINE_NDIM),
     ]
 
 
@@ -55,6 +58,20 @@ def open_lib():
         POINTER(c_int64),
         DataLayout,
     ]
+    lib.initTensorDescriptor.argtypes = [
+        POINTER(TensorLayout),
+        c_uint64,
+        POINTER(c_uint64),
+        POINTER(c_int64),
+        DataLayout,
+    ]
+    lib.getCachedTensorDescriptor.argtypes = [
+        POINTER(POINTER(TensorLayout)),
+        c_uint64,
+        POINTER(c_uint64),
+        POINTER(c_int64),
+        DataLayout,
+    ]
     return lib
 
 
@@ -91,12 +108,21 @@ def to_tensor(tensor, lib, shape = None, strides = None):
         U16 if tensor.dtype == torch.uint16 else
         U32 if tensor.dtype == torch.uint32 else
         U64 if tensor.dtype == torch.uint64 else
+        F8E4M3 if tensor.dtype == getattr(torch, "float8_e4m3fn", None) else
+        F8E5M2 if tensor.dtype == getattr(torch, "float8_e5m2", None) else
         None
     )
     # fmt: on
     assert dt is not None
-    # Create TensorDecriptor
-    tensor_desc = TensorDescriptor()
-    lib.createTensorDescriptor(ctypes.byref(tensor_desc), ndim, shape, strides, dt)
+    # Fill a TensorDecriptor owned by the returned tensor, which keeps it
+    # alive, so layouts that change per call add nothing to the library's
+    # cache; only layouts too large to store inline are interned there
+    if ndim <= TENSOR_INLINE_NDIM:
+        layout = TensorLayout()
+        lib.initTensorDescriptor(ctypes.byref(layout), ndim, shape, strides, dt)
+        tensor_desc = ctypes.pointer(layout)
+    else:
+        tensor_desc = TensorDescriptor()
+        lib.getCachedTensorDescriptor(ctypes.byref(tensor_desc), ndim, shape, strides, dt)
     # Create Tensor
     return CTensor(tensor_desc, ctypes.c_void_p(data_ptr))
@@ -0,0 +1,92 @@
+from ctypes import c_int, c_void_p, c_uint64
+import sys
+import os
+
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), "..", "..")))
+from operatorspy import (
+    open_lib,
+    to_tensor,
+    CTensor,
+    DeviceEnum,
+)
+
+from operatorspy.tests.test_utils import get_args
+import torch
+
+
+class ActivationType:
+    SILU = 0
+    GELU_TANH = 1
+    GELU_ERF = 2
+    RELU = 3
+
+
+def act(x, type):
+    x = x.to(torch.float32)
+    if type == ActivationType.SILU:
+        return torch.nn.functional.silu(x)
+    if type == ActivationType.GELU_TANH:
+        return torch.nn.functional.gelu(x, approximate="tanh")
+    if type == ActivationType.GELU_ERF:
+        return torch.nn.functional.gelu(x)
+    return torch.nn.functional.relu(x)
+
+
+def test(lib, descriptor, type, torch_device, dtype=torch.float16):
+    tol = {torch.float16: 1e-3, torch.bfloat16: 1e-2, torch.float32: 1e-5}[dtype]
+    x = (torch.rand((13, 1000), dtype=dtype) * 8 - 4).to(torch_device)
+    y = torch.zeros((13, 1000), dtype=dtype).to(torch_device)
+    ans = act(x, type).to(dtype)
+    lib.activation(descriptor, None, 0, to_tensor(y, lib), to_tensor(x, lib), None)
+    assert torch.allclose(y, ans, atol=tol, rtol=tol)
+
+    gate = (torch.rand((13, 1000), dtype=dtype) * 8 - 4).to(torch_device)
+    up = torch.rand((13, 1000), dtype=dtype).to(torch_device)
+    ans = (act(gate, type) * up.to(torch.float32)).to(dtype)
+    lib.gatedActivation(descriptor, None, 0, to_tensor(gate, lib), to_tensor(up, lib), None)
+    assert torch.allclose(gate, ans, atol=tol, rtol=tol)
+    print("Test passed!")
+
+
+def test_device(lib, device, torch_device, dtypes):
+    for type in [ActivationType.SILU, ActivationType.GELU_TANH, ActivationType.GELU_ERF, ActivationType.RELU]:
+        descriptor = lib.createActivationDescriptor(device, type, None)
+        for dtype in dtypes:
+            test(lib, descriptor, type, torch_device, dtype)
+        lib.destroyActivationDescriptor(descriptor)
+
+
+def test_cpu(lib):
+    test_device(lib, DeviceEnum.DEVICE_CPU, "cpu", [torch.float16, torch.bfloat16, torch.float32])
+
+
+def test_cuda(lib):
+    test_device(lib, DeviceEnum.DEVICE_CUDA, "cuda", [torch.float16])
+
+
+if __name__ == "__main__":
+    args = get_args()
+    lib = open_lib()
+    lib.createActivationDescriptor.restype = c_void_p
+    lib.createActivationDescriptor.argtypes = [c_int, c_int, c_void_p]
+    lib.destroyActivationDescriptor.argtypes = [c_void_p]
+    lib.activation.argtypes = [
+        c_void_p,
+        c_void_p,
+        c_uint64,
+        CTensor,
+        CTensor,
+        c_void_p,
+    ]
+    lib.gatedActivation.argtypes = [
+        c_void_p,
+        c_void_p,
+        c_uint64,
+        CTensor,
+        CTensor,
+        c_void_p,
+    ]
+    if args.cpu:
+        test_cpu(lib)
+    if args.cuda:
+        test_cuda(lib)
@@ -1,4 +1,4 @@
-from ctypes import c_void_p
+from ctypes import c_void_p, c_uint64
 import ctypes
 import sys
 import os
@@ -23,11 +23,29 @@ def causal_softmax(x):
     return torch.nn.functional.softmax(masked, dim=-1).to(type)
 
 
-def test(lib, descriptor, torch_device):
-    x = torch.rand((32, 20, 512), dtype=torch.float16).to(torch_device)
+def test(lib, descriptor, torch_device, dtype=torch.float16):
+    tol = 1e-2 if dtype == torch.bfloat16 else 1e-3
+    x = torch.rand((32, 20, 512), dtype=dtype).to(torch_device)
     ans = causal_softmax(x)
-    lib.causalSoftmax(descriptor, to_tensor(x, lib), None)
-    assert torch.allclose(x, ans, atol=0, rtol=1e-3)
+    lib.causalSoftmax(descriptor, None, 0, to_tensor(x, lib), None)
+    assert torch.allclose(x, ans, atol=0, rtol=tol)
+    print("Test passed!")
+
+
+def test_varlen(lib, descriptor, torch_device, dtype=torch.float16):
+    tol = 1e-2 if dtype == torch.bfloat16 else 1e-3
+    # three sequences packed, the last going on from keys already cached
+    q_lens, k_lens = [5, 1, 7], [5, 1, 12]
+    cu_seqlens_q = torch.tensor([0, 5, 6, 13], dtype=torch.int32).to(torch_device)
+    cu_seqlens_k = torch.tensor([0, 5, 6, 18], dtype=torch.int32).to(torch_device)
+    x = torch.rand((8, sum(q_lens), max(k_lens)), dtype=dtype).to(torch_device)
+    ans = torch.zeros_like(x)
+    begin = 0
+    for q, k in zip(q_lens, k_lens):
+        ans[:, begin : begin + q, :k] = causal_softmax(x[:, begin : begin + q, :k])
+        begin += q
+    lib.causalSoftmaxVarlen(descriptor, None, 0, to_tensor(x, lib), to_tensor(cu_seqlens_q, lib), to_tensor(cu_seqlens_k, lib), None)
+    assert torch.allclose(x, ans, atol=0, rtol=tol)
     print("Test passed!")
 
 
@@ -35,7 +53,9 @@ def test_cpu(lib):
     device = DeviceEnum.DEVICE_CPU
     config = None
     descriptor = lib.createCausalSoftmaxDescriptor(device, config)
-    test(lib, descriptor, "cpu")
+    for dtype in [torch.float16, torch.bfloat16, torch.float32]:
+        test(lib, descriptor, "cpu", dtype)
+        test_varlen(lib, descriptor, "cpu", dtype)
     lib.destroyCausalSoftmaxDescriptor(descriptor)
 
 
@@ -60,6 +80,17 @@ if __name__ == "__main__":
     lib.destroyCausalSoftmaxDescriptor.argtypes = [c_void_p]
     lib.causalSoftmax.argtypes = [
         c_void_p,
+        c_void_p,
+        c_uint64,
+        CTensor,
+        c_void_p,
+    ]
+    lib.causalSoftmaxVarlen.argtypes = [
+        c_void_p,
+        c_void_p,
+        c_uint64,
+        CTensor,
+        CTensor,
         CTensor,
         c_void_p,
     ]
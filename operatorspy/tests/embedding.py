@@ -0,0 +1,74 @@
+import ctypes
+from ctypes import c_void_p, c_uint64
+import sys
+import os
+
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), "..", "..")))
+from operatorspy import (
+    open_lib,
+    to_tensor,
+    CTensor,
+    DeviceEnum,
+)
+
+from operatorspy.tests.test_utils import get_args
+import torch
+
+
+def embedding(table, indices, scales=None):
+    if scales is None:
+        return table[indices]
+    return table[indices].float() * scales[indices].float().unsqueeze(1)
+
+
+def test(lib, descriptor, torch_device, dtype, index_dtype):
+    vocab, hidden, n = 32000, 4096, 7
+    table = torch.rand((vocab, hidden), dtype=dtype).to(torch_device)
+    indices = torch.randint(0, vocab, (n,), dtype=index_dtype).to(torch_device)
+    # rows of the output are strided, as a slice of a larger buffer
+    y = torch.zeros((n, hidden + 64), dtype=dtype).to(torch_device)[:, :hidden]
+
+    ans = embedding(table, indices)
+    lib.embedding(
+        descriptor, None, 0, to_tensor(y, lib), to_tensor(table, lib), to_tensor(indices, lib), CTensor(), None
+    )
+    assert torch.equal(y, ans)
+
+    # a table quantized to int8 with one scale per row
+    scales = table.float().abs().amax(dim=1) / 127
+    quantized = torch.round(table.float() / scales.unsqueeze(1)).to(torch.int8)
+    ans = embedding(quantized, indices, scales).to(dtype)
+    lib.embedding(
+        descriptor, None, 0, to_tensor(y, lib), to_tensor(quantized, lib), to_tensor(indices, lib), to_tensor(scales, lib), None
+    )
+    assert torch.allclose(y, ans, atol=1e-3, rtol=1e-2)
+    print("Test passed!")
+
+
+def test_cpu(lib):
+    device = DeviceEnum.DEVICE_CPU
+    config = None
+    descriptor = lib.createEmbeddingDescriptor(device, config)
+    for dtype in [torch.float16, torch.bfloat16, torch.float32]:
+        for index_dtype in [torch.int32, torch.int64]:
+            test(lib, descriptor, "cpu", dtype, index_dtype)
+    lib.destroyEmbeddingDescriptor(descriptor)
+
+
+if __name__ == "__main__":
+    args = get_args()
+    lib = open_lib()
+    lib.createEmbeddingDescriptor.restype = c_void_p
+    lib.destroyEmbeddingDescriptor.argtypes = [c_void_p]
+    lib.embedding.argtypes = [
+        c_void_p,
+        c_void_p,
+        c_uint64,
+        CTensor,
+        CTensor,
+        CTensor,
+        CTensor,
+        c_void_p,
+    ]
+    if args.cpu:
+        test_cpu(lib)
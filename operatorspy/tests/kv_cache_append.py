@@ -0,0 +1,122 @@
+from ctypes import c_float, c_void_p, c_uint64
+import sys
+import os
+
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), "..", "..")))
+from operatorspy import (
+    open_lib,
+    to_tensor,
+    CTensor,
+    DeviceEnum,
+)
+
+from operatorspy.tests.test_utils import get_args
+import torch
+
+
+def test(lib, descriptor, torch_device, dtype=torch.float16):
+    tokens, kv_heads, dh, capacity = 5, 8, 128, 16
+    k = torch.rand((tokens, kv_heads, dh), dtype=dtype).to(torch_device)
+    v = torch.rand((tokens, kv_heads, dh), dtype=dtype).to(torch_device)
+    # the last tokens of a window wrap around to the front, one is padding
+    slots = torch.tensor([13, 14, 15, 16, -1], dtype=torch.int64).to(torch_device)
+
+    # a cache stored (capacity, kv_heads, dh), described as (kv_heads, capacity, dh)
+    k_cache = torch.zeros((capacity, kv_heads, dh), dtype=dtype).to(torch_device)
+    v_cache = torch.zeros((capacity, kv_heads, dh), dtype=dtype).to(torch_device)
+    lib.kvCacheAppend(
+        descriptor, None, 0,
+        to_tensor(k_cache.transpose(0, 1), lib), to_tensor(v_cache.transpose(0, 1), lib), CTensor(), CTensor(),
+        to_tensor(k, lib), to_tensor(v, lib), to_tensor(slots, lib), CTensor(), 0.0, None,
+    )
+    for i, slot in enumerate(slots.tolist()):
+        if slot >= 0:
+            assert torch.equal(k_cache[slot % capacity], k[i])
+            assert torch.equal(v_cache[slot % capacity], v[i])
+    assert not k_cache[1:13].any()
+
+    # paged, (blocks, kv_heads, block_size, dh)
+    blocks, block_size = 4, 4
+    k_cache = torch.zeros((blocks, kv_heads, block_size, dh), dtype=dtype).to(torch_device)
+    v_cache = torch.zeros((blocks, kv_heads, block_size, dh), dtype=dtype).to(torch_device)
+    slots = torch.tensor([0, 5, 6, 11, 15], dtype=torch.int32).to(torch_device)
+    lib.kvCacheAppend(
+        descriptor, None, 0, to_tensor(k_cache, lib), to_tensor(v_cache, lib), CTensor(), CTensor(),
+        to_tensor(k, lib), to_tensor(v, lib), to_tensor(slots, lib), CTensor(), 0.0, None,
+    )
+    for i, slot in enumerate(slots.tolist()):
+        assert torch.equal(k_cache[slot // block_size, :, slot % block_size], k[i])
+        assert torch.equal(v_cache[slot // block_size, :, slot % block_size], v[i])
+    print("Test passed!")
+
+
+def test_quantized(lib, descriptor, torch_device, dtype=torch.float16):
+    tokens, kv_heads, dh, capacity = 5, 8, 128, 16
+    k = (torch.rand((tokens, kv_heads, dh), dtype=dtype) * 2 - 1).to(torch_device)
+    v = (torch.rand((tokens, kv_heads, dh), dtype=dtype) * 2 - 1).to(torch_device)
+    slots = torch.arange(tokens, dtype=torch.int64).to(torch_device)
+
+    # int8 with a scale per slot and head, set by the append
+    k_cache = torch.zeros((kv_heads, capacity, dh), dtype=torch.int8).to(torch_device)
+    v_cache = torch.zeros((kv_heads, capacity, dh), dtype=torch.int8).to(torch_device)
+    k_scales = torch.zeros((kv_heads, capacity), dtype=torch.float32).to(torch_device)
+    v_scales = torch.zeros((kv_heads, capacity), dtype=torch.float32).to(torch_device)
+    lib.kvCacheAppend(
+        descriptor, None, 0, to_tensor(k_cache, lib), to_tensor(v_cache, lib),
+        to_tensor(k_scales, lib), to_tensor(v_scales, lib),
+        to_tensor(k, lib), to_tensor(v, lib), to_tensor(slots, lib), CTensor(), 0.0, None,
+    )
+    for x, cache, scales in [(k, k_cache, k_scales), (v, v_cache, v_scales)]:
+        x = x.float().transpose(0, 1)
+        expected = x.abs().amax(-1) / 127
+        assert torch.allclose(scales[:, :tokens], expected)
+        restored = cache[:, :tokens].float() * scales[:, :tokens, None]
+        # rounded to the nearest step of the scale
+        assert ((restored - x).abs() <= expected[..., None] / 2 + 1e-6).all()
+
+    # float8 as is, when the values fit
+    fp8 = getattr(torch, "float8_e4m3fn", None)
+    if fp8 is None:
+        return
+    k_cache = torch.zeros((kv_heads, capacity, dh), dtype=fp8).to(torch_device)
+    v_cache = torch.zeros((kv_heads, capacity, dh), dtype=fp8).to(torch_device)
+    lib.kvCacheAppend(
+        descriptor, None, 0, to_tensor(k_cache, lib), to_tensor(v_cache, lib), CTensor(), CTensor(),
+        to_tensor(k, lib), to_tensor(v, lib), to_tensor(slots, lib), CTensor(), 0.0, None,
+    )
+    assert torch.equal(k_cache[:, :tokens].view(torch.uint8), k.float().transpose(0, 1).to(fp8).view(torch.uint8))
+    assert torch.equal(v_cache[:, :tokens].view(torch.uint8), v.float().transpose(0, 1).to(fp8).view(torch.uint8))
+    print("Test passed!")
+
+
+def test_cpu(lib):
+    device = DeviceEnum.DEVICE_CPU
+    descriptor = lib.createKVCacheAppendDescriptor(device, None)
+    for dtype in [torch.float16, torch.bfloat16, torch.float32]:
+        test(lib, descriptor, "cpu", dtype)
+        test_quantized(lib, descriptor, "cpu", dtype)
+    lib.destroyKVCacheAppendDescriptor(descriptor)
+
+
+if __name__ == "__main__":
+    args = get_args()
+    lib = open_lib()
+    lib.createKVCacheAppendDescriptor.restype = c_void_p
+    lib.destroyKVCacheAppendDescriptor.argtypes = [c_void_p]
+    lib.kvCacheAppend.argtypes = [
+        c_void_p,
+        c_void_p,
+        c_uint64,
+        CTensor,
+        CTensor,
+        CTensor,
+        CTensor,
+        CTensor,
+        CTensor,
+        CTensor,
+        CTensor,
+        c_float,
+        c_void_p,
+    ]
+    if args.cpu:
+        test_cpu(lib)
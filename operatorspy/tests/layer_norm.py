@@ -0,0 +1,71 @@
+from ctypes import c_float, c_void_p, c_uint64
+import sys
+import os
+
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), "..", "..")))
+from operatorspy import (
+    open_lib,
+    to_tensor,
+    CTensor,
+    DeviceEnum,
+)
+
+from operatorspy.tests.test_utils import get_args
+import torch
+
+
+def test(lib, descriptor, torch_device, dtype=torch.float16):
+    tol = 1e-2 if dtype == torch.bfloat16 else 1e-3
+    n, d = 16, 2048
+    y = torch.zeros((n, d), dtype=dtype).to(torch_device)
+    # far from zero mean, which a two moment reduction would lose
+    x = (torch.rand((n, d), dtype=torch.float32) + 100).to(dtype).to(torch_device)
+    w = torch.rand((d,), dtype=dtype).to(torch_device)
+    b = torch.rand((d,), dtype=dtype).to(torch_device)
+    eps = 1e-5
+
+    ans = torch.nn.functional.layer_norm(x.float(), (d,), w.float(), b.float(), eps).to(dtype)
+    lib.layerNorm(
+        descriptor, None, 0, to_tensor(y, lib), to_tensor(x, lib), to_tensor(w, lib), to_tensor(b, lib), CTensor(), eps, None
+    )
+    assert torch.allclose(y, ans, atol=tol, rtol=tol)
+
+    # residual added in place before the norm, no bias
+    residual = torch.rand((n, d), dtype=dtype).to(torch_device)
+    h = x + residual
+    ans = torch.nn.functional.layer_norm(h.float(), (d,), w.float(), None, eps).to(dtype)
+    lib.layerNorm(
+        descriptor, None, 0, to_tensor(y, lib), to_tensor(x, lib), to_tensor(w, lib), CTensor(), to_tensor(residual, lib), eps, None
+    )
+    assert torch.equal(residual, h)
+    assert torch.allclose(y, ans, atol=tol, rtol=tol)
+    print("Test passed!")
+
+
+def test_cpu(lib):
+    device = DeviceEnum.DEVICE_CPU
+    descriptor = lib.createLayerNormDescriptor(device, None)
+    for dtype in [torch.float16, torch.bfloat16, torch.float32]:
+        test(lib, descriptor, "cpu", dtype)
+    lib.destroyLayerNormDescriptor(descriptor)
+
+
+if __name__ == "__main__":
+    args = get_args()
+    lib = open_lib()
+    lib.createLayerNormDescriptor.restype = c_void_p
+    lib.destroyLayerNormDescriptor.argtypes = [c_void_p]
+    lib.layerNorm.argtypes = [
+        c_void_p,
+        c_void_p,
+        c_uint64,
+        CTensor,
+        CTensor,
+        CTensor,
+        CTensor,
+        CTensor,
+        c_float,
+        c_void_p,
+    ]
+    if args.cpu:
+        test_cpu(lib)
@@ -1,4 +1,4 @@
-from ctypes import c_float, c_void_p
+from ctypes import c_float, c_void_p, c_uint64, POINTER, byref
 import sys
 import os
 
@@ -22,33 +22,122 @@ def matmul(c, beta, a, b, alpha):
     )
 
 
-def test(lib, descriptor, torch_device):
-    c = torch.zeros((1, 2048), dtype=torch.float16).to(torch_device)
-    a = torch.rand((1, 2048), dtype=torch.float16).to(torch_device)
-    b = torch.rand((2048, 2048), dtype=torch.float16).to(torch_device)
+def test(lib, descriptor, torch_device, dtype=torch.float16, stream=None):
+    tol = 1e-2 if dtype == torch.bfloat16 else 1e-3
+    c = torch.zeros((1, 2048), dtype=dtype).to(torch_device)
+    a = torch.rand((1, 2048), dtype=dtype).to(torch_device)
+    b = torch.rand((2048, 2048), dtype=dtype).to(torch_device)
 
     beta = 0.0
     alpha = 1.0
 
     ans = matmul(c, beta, a, b, alpha)
+    workspace_size = c_uint64(0)
+    lib.getMatmulWorkspaceSize(descriptor, byref(workspace_size))
+    workspace = torch.zeros(workspace_size.value, dtype=torch.uint8).to(torch_device)
     lib.matmul(
         descriptor,
+        workspace.data_ptr() if workspace_size.value else None,
+        workspace_size.value,
         to_tensor(c, lib),
         beta,
         to_tensor(a, lib),
         to_tensor(b, lib),
         alpha,
-        None,
+        stream,
     )
+    if stream is not None:
+        lib.synchronizeCpuStream(stream)
 
-    assert torch.allclose(c, ans, atol=0, rtol=1e-3)
+    assert torch.allclose(c, ans, atol=0, rtol=tol)
+    print("Test passed!")
+
+
+def test_dequant(lib, descriptor, torch_device, dtype=torch.float16):
+    # scores of a query against int8 keys of one scale per position
+    heads, dh, seq = 4, 128, 300
+    q = torch.rand((heads, 1, dh), dtype=dtype).to(torch_device)
+    keys = torch.randint(-127, 128, (heads, seq, dh), dtype=torch.int8).to(torch_device)
+    scales = (torch.rand((heads, seq), dtype=torch.float32) / 100).to(torch_device)
+    c = torch.zeros((heads, 1, seq), dtype=dtype).to(torch_device)
+    lib.matmulDequant(
+        descriptor, None, 0, to_tensor(c, lib), 0.0, to_tensor(q, lib),
+        to_tensor(keys.transpose(1, 2), lib), to_tensor(scales.unsqueeze(1), lib), 1.0, None,
+    )
+    ans = torch.matmul(q.float(), (keys.float() * scales.unsqueeze(-1)).transpose(1, 2)).to(dtype)
+    tol = 1e-2 if dtype == torch.bfloat16 else 1e-3
+    assert torch.allclose(c, ans, atol=tol, rtol=tol)
+    print("Test passed!")
+
+
+def test_mixed(lib, descriptor, torch_device):
+    # half inputs into f32 outputs, and f32 activations times half weights
+    m, n, k = 7, 300, 1024
+    for c_dtype, a_dtype, b_dtype in [
+        (torch.float32, torch.float16, torch.float16),
+        (torch.float32, torch.bfloat16, torch.bfloat16),
+        (torch.float32, torch.float32, torch.float16),
+        (torch.float16, torch.float32, torch.float16),
+    ]:
+        a = torch.rand((m, k), dtype=a_dtype).to(torch_device)
+        b = torch.rand((n, k), dtype=b_dtype).to(torch_device).t()
+        c = torch.zeros((m, n), dtype=c_dtype).to(torch_device)
+        lib.matmul(descriptor, None, 0, to_tensor(c, lib), 0.0, to_tensor(a, lib), to_tensor(b, lib), 1.0, None)
+        ans = torch.matmul(a.float(), b.float()).to(c_dtype)
+        tol = 1e-5 if c_dtype == torch.float32 else 1e-3
+        assert torch.allclose(c, ans, atol=0, rtol=tol)
+    print("Test passed!")
+
+
+def test_broadcast(lib, descriptor, torch_device, dtype=torch.float16):
+    # grouped query attention scores: every key head serves a group of query heads
+    batch, kv_heads, group, seq, dh = 2, 2, 4, 33, 64
+    q = torch.rand((batch, kv_heads, group, 1, dh), dtype=dtype).to(torch_device)
+    k = torch.rand((batch, kv_heads, 1, seq, dh), dtype=dtype).to(torch_device)
+    c = torch.zeros((batch, kv_heads, group, 1, seq), dtype=dtype).to(torch_device)
+    lib.matmul(descriptor, None, 0, to_tensor(c, lib), 0.0, to_tensor(q, lib), to_tensor(k.transpose(-1, -2), lib), 1.0, None)
+    ans = torch.matmul(q.float(), k.float().transpose(-1, -2)).to(dtype)
+    tol = 1e-2 if dtype == torch.bfloat16 else 1e-3
+    assert torch.allclose(c, ans, atol=tol, rtol=tol)
+    print("Test passed!")
+
+
+def test_grouped(lib, descriptor, torch_device, dtype=torch.float16):
+    # tokens routed to 4 experts, one of them getting none, and a second
+    # call in which groups pick their expert by index
+    k, n = 256, 96
+    cu_seqlens = torch.tensor([0, 5, 5, 40, 47], dtype=torch.int32)
+    rows = int(cu_seqlens[-1])
+    a = torch.rand((rows, k), dtype=dtype).to(torch_device)
+    b = torch.rand((4, k, n), dtype=dtype).to(torch_device)
+    for b_index in [None, torch.tensor([2, 2, 0, 3], dtype=torch.int64)]:
+        c = torch.zeros((rows, n), dtype=dtype).to(torch_device)
+        lib.matmulGrouped(
+            descriptor, None, 0, to_tensor(c, lib), 0.0, to_tensor(a, lib), to_tensor(b, lib),
+            to_tensor(cu_seqlens, lib), CTensor() if b_index is None else to_tensor(b_index, lib), 1.0, None,
+        )
+        ans = torch.zeros((rows, n), dtype=dtype)
+        for g in range(4):
+            begin, end = int(cu_seqlens[g]), int(cu_seqlens[g + 1])
+            matrix = b[g if b_index is None else int(b_index[g])]
+            ans[begin:end] = torch.matmul(a[begin:end].float(), matrix.float()).to(dtype)
+        tol = 1e-2 if dtype == torch.bfloat16 else 1e-3
+        assert torch.allclose(c, ans, atol=0, rtol=tol)
     print("Test passed!")
 
 
 def test_cpu(lib):
     device = DeviceEnum.DEVICE_CPU
     descriptor = lib.createMatmulDescriptor(device, None)
-    test(lib, descriptor, "cpu")
+    for dtype in [torch.float16, torch.bfloat16, torch.float32]:
+        test(lib, descriptor, "cpu", dtype)
+        test_dequant(lib, descriptor, "cpu", dtype)
+        test_grouped(lib, descriptor, "cpu", dtype)
+        test_broadcast(lib, descriptor, "cpu", dtype)
+    test_mixed(lib, descriptor, "cpu")
+    stream = lib.createCpuStream()
+    test(lib, descriptor, "cpu", stream=stream)
+    lib.destroyCpuStream(stream)
     lib.destroyMatmulDescriptor(descriptor)
 
 
@@ -71,8 +160,11 @@ if __name__ == "__main__":
     lib = open_lib()
     lib.createMatmulDescriptor.restype = c_void_p
     lib.destroyMatmulDescriptor.argtypes = [c_void_p]
+    lib.getMatmulWorkspaceSize.argtypes = [c_void_p, POINTER(c_uint64)]
     lib.matmul.argtypes = [
         c_void_p,
+        c_void_p,
+        c_uint64,
         CTensor,
         c_float,
         CTensor,
@@ -80,6 +172,34 @@ if __name__ == "__main__":
         c_float,
         c_void_p,
     ]
+    lib.matmulDequant.argtypes = [
+        c_void_p,
+        c_void_p,
+        c_uint64,
+        CTensor,
+        c_float,
+        CTensor,
+        CTensor,
+        CTensor,
+        c_float,
+        c_void_p,
+    ]
+    lib.matmulGrouped.argtypes = [
+        c_void_p,
+        c_void_p,
+        c_uint64,
+        CTensor,
+        c_float,
+        CTensor,
+        CTensor,
+        CTensor,
+        CTensor,
+        c_float,
+        c_void_p,
+    ]
+    lib.createCpuStream.restype = c_void_p
+    lib.destroyCpuStream.argtypes = [c_void_p]
+    lib.synchronizeCpuStream.argtypes = [c_void_p]
     if args.cpu:
         test_cpu(lib)
     if args.cuda:
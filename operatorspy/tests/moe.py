@@ -0,0 +1,102 @@
+from ctypes import c_int, c_void_p, c_uint64, POINTER, byref
+import sys
+import os
+
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), "..", "..")))
+from operatorspy import (
+    open_lib,
+    to_tensor,
+    CTensor,
+    DeviceEnum,
+)
+
+from operatorspy.tests.test_utils import get_args
+import torch
+
+
+def test(lib, descriptor, torch_device, dtype=torch.float16):
+    tokens, experts, k, d = 37, 8, 2, 512
+    logits = torch.randn((tokens, experts), dtype=dtype).to(torch_device)
+    x = torch.rand((tokens, d), dtype=dtype).to(torch_device)
+    weights = torch.zeros((tokens, k), dtype=torch.float32).to(torch_device)
+    ids = torch.zeros((tokens, k), dtype=torch.int32).to(torch_device)
+
+    lib.moeGate(descriptor, None, 0, to_tensor(weights, lib), to_tensor(ids, lib), to_tensor(logits, lib), 1, None)
+    probs = torch.softmax(logits.float(), -1)
+    top, top_ids = probs.topk(k, -1)
+    assert torch.equal(ids.long(), top_ids)
+    assert torch.allclose(weights, top / top.sum(-1, keepdim=True), atol=1e-6)
+
+    permuted = torch.zeros((tokens * k, d), dtype=dtype).to(torch_device)
+    cu_seqlens = torch.zeros((experts + 1,), dtype=torch.int64).to(torch_device)
+    positions = torch.zeros((tokens, k), dtype=torch.int64).to(torch_device)
+    workspace_size = c_uint64(0)
+    lib.getMoeWorkspaceSize(descriptor, byref(workspace_size))
+    workspace = torch.zeros(workspace_size.value, dtype=torch.uint8).to(torch_device)
+    lib.moePermute(
+        descriptor, workspace.data_ptr() if workspace_size.value else None, workspace_size.value,
+        to_tensor(permuted, lib), to_tensor(cu_seqlens, lib), to_tensor(positions, lib), to_tensor(x, lib), to_tensor(ids, lib), None,
+    )
+    # a stable sort of the (token, expert) pairs by expert
+    order = torch.sort(ids.flatten().long(), stable=True).indices
+    assert torch.equal(cu_seqlens[1:], torch.bincount(ids.flatten().long(), minlength=experts).cumsum(0))
+    assert torch.equal(permuted, x[order // k])
+    assert torch.equal(positions.flatten()[order], torch.arange(tokens * k))
+
+    # every expert doubles its rows
+    y = torch.zeros((tokens, d), dtype=dtype).to(torch_device)
+    expert_out = permuted * 2
+    lib.moeUnpermute(descriptor, None, 0, to_tensor(y, lib), to_tensor(expert_out, lib), to_tensor(positions, lib), to_tensor(weights, lib), None)
+    ans = (expert_out.float()[positions] * weights[..., None]).sum(1).to(dtype)
+    tol = 1e-2 if dtype == torch.bfloat16 else 1e-3
+    assert torch.allclose(y, ans, atol=tol, rtol=tol)
+    print("Test passed!")
+
+
+def test_cpu(lib):
+    device = DeviceEnum.DEVICE_CPU
+    descriptor = lib.createMoeDescriptor(device, None)
+    for dtype in [torch.float16, torch.bfloat16, torch.float32]:
+        test(lib, descriptor, "cpu", dtype)
+    lib.destroyMoeDescriptor(descriptor)
+
+
+if __name__ == "__main__":
+    args = get_args()
+    lib = open_lib()
+    lib.createMoeDescriptor.restype = c_void_p
+    lib.destroyMoeDescriptor.argtypes = [c_void_p]
+    lib.getMoeWorkspaceSize.argtypes = [c_void_p, POINTER(c_uint64)]
+    lib.moeGate.argtypes = [
+        c_void_p,
+        c_void_p,
+        c_uint64,
+        CTensor,
+        CTensor,
+        CTensor,
+        c_int,
+        c_void_p,
+    ]
+    lib.moePermute.argtypes = [
+        c_void_p,
+        c_void_p,
+        c_uint64,
+        CTensor,
+        CTensor,
+        CTensor,
+        CTensor,
+        CTensor,
+        c_void_p,
+    ]
+    lib.moeUnpermute.argtypes = [
+        c_void_p,
+        c_void_p,
+        c_uint64,
+        CTensor,
+        CTensor,
+        CTensor,
+        CTensor,
+        c_void_p,
+    ]
+    if args.cpu:
+        test_cpu(lib)
@@ -0,0 +1,105 @@
+from ctypes import c_float, c_void_p, c_uint64
+import sys
+import os
+
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), "..", "..")))
+from operatorspy import (
+    open_lib,
+    to_tensor,
+    CTensor,
+    DeviceEnum,
+)
+
+from operatorspy.tests.test_utils import get_args
+import torch
+
+
+def check(q, scales, zeros, x):
+    # every number within half a step of its row
+    zero = zeros.float() if zeros is not None else torch.zeros_like(scales)
+    restored = (q.float() - zero[:, None]) * scales[:, None]
+    assert ((restored - x.float()).abs() <= scales[:, None] / 2 + 1e-5).all()
+
+
+def test(lib, descriptor, torch_device, dtype=torch.float16):
+    n, d = 16, 4096
+    x = (torch.rand((n, d), dtype=dtype) * 4 - 1).to(torch_device)
+    w = torch.rand((d,), dtype=dtype).to(torch_device)
+    scales = torch.zeros((n,), dtype=torch.float32).to(torch_device)
+    zeros = torch.zeros((n,), dtype=torch.int32).to(torch_device)
+    eps = 1e-5
+
+    # symmetric
+    q = torch.zeros((n, d), dtype=torch.int8).to(torch_device)
+    lib.quantize(descriptor, None, 0, to_tensor(q, lib), to_tensor(scales, lib), CTensor(), to_tensor(x, lib), None)
+    assert torch.allclose(scales, x.float().abs().amax(1) / 127)
+    check(q, scales, None, x)
+
+    # asymmetric, int8 and uint8
+    for qtype in [torch.int8, torch.uint8]:
+        q = torch.zeros((n, d), dtype=qtype).to(torch_device)
+        lib.quantize(descriptor, None, 0, to_tensor(q, lib), to_tensor(scales, lib), to_tensor(zeros, lib), to_tensor(x, lib), None)
+        check(q, scales, zeros, x)
+
+        y = torch.zeros((n, d), dtype=dtype).to(torch_device)
+        lib.dequantize(descriptor, None, 0, to_tensor(y, lib), to_tensor(q, lib), to_tensor(scales, lib), to_tensor(zeros, lib), None)
+        ans = ((q.float() - zeros.float()[:, None]) * scales[:, None]).to(dtype)
+        assert torch.allclose(y, ans)
+
+    # normalized on the way
+    q = torch.zeros((n, d), dtype=torch.int8).to(torch_device)
+    lib.quantizeRMSNorm(
+        descriptor, None, 0, to_tensor(q, lib), to_tensor(scales, lib), CTensor(), to_tensor(x, lib), to_tensor(w, lib), eps, None
+    )
+    h = x.float() * torch.rsqrt(x.float().pow(2).mean(-1, keepdim=True) + eps) * w.float()
+    check(q, scales, None, h)
+    print("Test passed!")
+
+
+def test_cpu(lib):
+    device = DeviceEnum.DEVICE_CPU
+    descriptor = lib.createQuantizeDescriptor(device, None)
+    for dtype in [torch.float16, torch.bfloat16, torch.float32]:
+        test(lib, descriptor, "cpu", dtype)
+    lib.destroyQuantizeDescriptor(descriptor)
+
+
+if __name__ == "__main__":
+    args = get_args()
+    lib = open_lib()
+    lib.createQuantizeDescriptor.restype = c_void_p
+    lib.destroyQuantizeDescriptor.argtypes = [c_void_p]
+    lib.quantize.argtypes = [
+        c_void_p,
+        c_void_p,
+        c_uint64,
+        CTensor,
+        CTensor,
+        CTensor,
+        CTensor,
+        c_void_p,
+    ]
+    lib.quantizeRMSNorm.argtypes = [
+        c_void_p,
+        c_void_p,
+        c_uint64,
+        CTensor,
+        CTensor,
+        CTensor,
+        CTensor,
+        CTensor,
+        c_float,
+        c_void_p,
+    ]
+    lib.dequantize.argtypes = [
+        c_void_p,
+        c_void_p,
+        c_uint64,
+        CTensor,
+        CTensor,
+        CTensor,
+        CTensor,
+        c_void_p,
+    ]
+    if args.cpu:
+        test_cpu(lib)
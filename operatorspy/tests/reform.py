@@ -1,5 +1,5 @@
 import ctypes
-from ctypes import c_float, POINTER, c_void_p
+from ctypes import c_float, POINTER, c_void_p, c_uint64
 import sys
 import os
 
@@ -23,7 +23,7 @@ def test(lib, descriptor, torch_device, x = None):
         x = x.to(torch_device)
     y = torch.zeros((5, 5), dtype=torch.float16).to(torch_device)
 
-    lib.reform(descriptor, to_tensor(y, lib), to_tensor(x, lib, [5, 5], [20, 2]), None)
+    lib.reform(descriptor, None, 0, to_tensor(y, lib), to_tensor(x, lib, [5, 5], [20, 2]), None)
     
     return x, y
 
@@ -79,6 +79,8 @@ if __name__ == "__main__":
     lib.destroyReformDescriptor.argtypes = [c_void_p]
     lib.reform.argtypes = [
         c_void_p,
+        c_void_p,
+        c_uint64,
         CTensor,
         CTensor,
         c_void_p,
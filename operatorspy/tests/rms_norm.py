@@ -1,4 +1,4 @@
-from ctypes import c_float, c_void_p
+from ctypes import c_float, c_void_p, c_uint64
 import sys
 import os
 
@@ -22,28 +22,30 @@ def rms_norm(x, w, eps):
     return w * hidden_states.to(input_dtype)
 
 
-def test(lib, descriptor, torch_device):
-    y = torch.zeros((16, 13312), dtype=torch.float16).to(torch_device)
-    x = torch.rand((16, 2048), dtype=torch.float16).to(torch_device)
-    w = torch.ones((2048,), dtype=torch.float16).to(torch_device)
+def test(lib, descriptor, torch_device, dtype=torch.float16):
+    tol = 1e-2 if dtype == torch.bfloat16 else 1e-3
+    y = torch.zeros((16, 13312), dtype=dtype).to(torch_device)
+    x = torch.rand((16, 2048), dtype=dtype).to(torch_device)
+    w = torch.ones((2048,), dtype=dtype).to(torch_device)
 
     eps = 1e-5
     ans = rms_norm(x, w, eps)
     lib.rmsNorm(
-        descriptor, to_tensor(y, lib, [16, 2048], [26624, 2]), to_tensor(x, lib), to_tensor(w, lib), eps, None
+        descriptor, None, 0, to_tensor(y, lib, [16, 2048], [13312 * y.element_size(), y.element_size()]), to_tensor(x, lib), to_tensor(w, lib), eps, None
     )
 
     # print(ans)
     # print("=======================================================")
     # print(y[:, :2048])
-    assert torch.allclose(y[:, :2048], ans, atol=1e-3, rtol=1e-3)
+    assert torch.allclose(y[:, :2048], ans, atol=tol, rtol=tol)
     print("Test passed!")
 
 
 def test_cpu(lib):
     device = DeviceEnum.DEVICE_CPU
     descriptor = lib.createRMSNormDescriptor(device, None)
-    test(lib, descriptor, "cpu")
+    for dtype in [torch.float16, torch.bfloat16, torch.float32]:
+        test(lib, descriptor, "cpu", dtype)
     lib.destroyRMSNormDescriptor(descriptor)
 
 
@@ -68,6 +70,8 @@ if __name__ == "__main__":
     lib.destroyRMSNormDescriptor.argtypes = [c_void_p]
     lib.rmsNorm.argtypes = [
         c_void_p,
+        c_void_p,
+        c_uint64,
         CTensor,
         CTensor,
         CTensor,
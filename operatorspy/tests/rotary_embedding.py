@@ -1,5 +1,5 @@
 import ctypes
-from ctypes import c_float, POINTER, c_void_p
+from ctypes import c_float, POINTER, c_void_p, c_uint64
 import sys
 import os
 
@@ -44,18 +44,35 @@ def test(lib, descriptor, torch_device):
 
     ans = rotary_embedding(t, pos, theta, torch_device)
     lib.rotaryEmbedding(
-        descriptor, to_tensor(t, lib), to_tensor(pos, lib), c_float(theta, lib), None
+        descriptor, None, 0, to_tensor(t, lib), to_tensor(pos, lib), c_float(theta, lib), None
     )
 
     assert torch.allclose(t, ans, atol=1, rtol=1e-3)
     print("Test passed!")
 
 
+def test_varlen(lib, descriptor, torch_device):
+    # three sequences packed, the second going on after 9 cached tokens
+    t = torch.rand((10, 32, 128), dtype=torch.float16).to(torch_device)
+    cu_seqlens = torch.tensor([0, 4, 5, 10], dtype=torch.int32).to(torch_device)
+    start_pos = torch.tensor([0, 9, 0], dtype=torch.int32).to(torch_device)
+    pos = torch.tensor([0, 1, 2, 3, 9, 0, 1, 2, 3, 4], dtype=torch.int32).to(torch_device)
+    theta = 1e4
+
+    ans = rotary_embedding(t, pos, theta, torch_device)
+    lib.rotaryEmbeddingVarlen(
+        descriptor, None, 0, to_tensor(t, lib), to_tensor(cu_seqlens, lib), to_tensor(start_pos, lib), c_float(theta), None
+    )
+    assert torch.allclose(t, ans, atol=1, rtol=1e-3)
+    print("Test passed!")
+
+
 def test_cpu(lib):
     device = DeviceEnum.DEVICE_CPU
     config = None
     descriptor = lib.createRotaryEmbeddingDescriptor(device, config)
     test(lib, descriptor, "cpu")
+    test_varlen(lib, descriptor, "cpu")
     lib.destroyRotaryEmbeddingDescriptor(descriptor)
 
 
@@ -81,7 +98,7 @@ def test_bang(lib):
     t = t.to("mlu")
     pos = pos.to("mlu")
     lib.rotaryEmbedding(
-        descriptor, to_tensor(t, lib), to_tensor(pos, lib), c_float(theta), None
+        descriptor, None, 0, to_tensor(t, lib), to_tensor(pos, lib), c_float(theta), None
     )
     assert torch.allclose(t.cpu(), ans, atol=1e-3, rtol=1e-3)
     print("Test passed!")
@@ -95,6 +112,18 @@ if __name__ == "__main__":
     lib.destroyRotaryEmbeddingDescriptor.argtypes = [c_void_p]
     lib.rotaryEmbedding.argtypes = [
         c_void_p,
+        c_void_p,
+        c_uint64,
+        CTensor,
+        CTensor,
+        c_float,
+        c_void_p,
+    ]
+    lib.rotaryEmbeddingVarlen.argtypes = [
+        c_void_p,
+        c_void_p,
+        c_uint64,
+        CTensor,
         CTensor,
         CTensor,
         c_float,
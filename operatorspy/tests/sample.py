@@ -0,0 +1,94 @@
+import ctypes
+from ctypes import c_float, c_void_p, c_uint64
+import sys
+import os
+
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), "..", "..")))
+from operatorspy import (
+    open_lib,
+    to_tensor,
+    CTensor,
+    DeviceEnum,
+)
+
+from operatorspy.tests.test_utils import get_args
+import torch
+
+
+def candidates(logits, temperature, topk, topp):
+    values, indices = logits.float().sort(descending=True, stable=True)
+    if topk > 0:
+        values, indices = values[:topk], indices[:topk]
+    probs = torch.softmax(values / temperature, dim=0)
+    cumulative = probs.cumsum(dim=0)
+    n = int((cumulative < topp * cumulative[-1]).sum()) + 1
+    return set(indices[:n].tolist())
+
+
+def test(lib, descriptor, torch_device, dtype):
+    batch, vocab = 4, 32000
+    logits = torch.randn((batch, vocab), dtype=dtype).to(torch_device)
+    result = torch.zeros((batch,), dtype=torch.int64).to(torch_device)
+
+    lib.sample(descriptor, None, 0, to_tensor(result, lib), to_tensor(logits, lib), 0.0, 0, 1.0, 0, None)
+    assert torch.equal(result, logits.float().argmax(dim=1))
+
+    temperature, topk, topp = 0.8, 50, 0.9
+    for seed in range(16):
+        lib.sample(descriptor, None, 0, to_tensor(result, lib), to_tensor(logits, lib), temperature, topk, topp, seed, None)
+        for i in range(batch):
+            assert result[i].item() in candidates(logits[i], temperature, topk, topp)
+
+    # the logits of hidden states and a weight stored vocab-major, never written out
+    dim = 256
+    hidden = torch.randn((batch, dim), dtype=dtype).to(torch_device)
+    weight = (torch.randn((vocab, dim), dtype=dtype) / dim**0.5).to(torch_device)
+    lib.sampleMatmul(
+        descriptor, None, 0, to_tensor(result, lib), to_tensor(hidden, lib), to_tensor(weight.t(), lib), 0.0, 0, 1.0, 0, None
+    )
+    ans = (hidden.float() @ weight.float().t()).argmax(dim=1)
+    assert torch.equal(result, ans)
+    print("Test passed!")
+
+
+def test_cpu(lib):
+    device = DeviceEnum.DEVICE_CPU
+    config = None
+    descriptor = lib.createSampleDescriptor(device, config)
+    for dtype in [torch.float16, torch.bfloat16, torch.float32]:
+        test(lib, descriptor, "cpu", dtype)
+    lib.destroySampleDescriptor(descriptor)
+
+
+if __name__ == "__main__":
+    args = get_args()
+    lib = open_lib()
+    lib.createSampleDescriptor.restype = c_void_p
+    lib.destroySampleDescriptor.argtypes = [c_void_p]
+    lib.sample.argtypes = [
+        c_void_p,
+        c_void_p,
+        c_uint64,
+        CTensor,
+        CTensor,
+        c_float,
+        c_uint64,
+        c_float,
+        c_uint64,
+        c_void_p,
+    ]
+    lib.sampleMatmul.argtypes = [
+        c_void_p,
+        c_void_p,
+        c_uint64,
+        CTensor,
+        CTensor,
+        CTensor,
+        c_float,
+        c_uint64,
+        c_float,
+        c_uint64,
+        c_void_p,
+    ]
+    if args.cpu:
+        test_cpu(lib)
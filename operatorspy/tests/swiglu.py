@@ -1,4 +1,4 @@
-from ctypes import c_float, c_void_p
+from ctypes import c_float, c_void_p, c_uint64
 import sys
 import os
 
@@ -17,19 +17,21 @@ def swiglu(gate, up):
     return up * torch.nn.functional.silu(gate).to(gate.dtype)
 
 
-def test(lib, descriptor, torch_device):
-    gate = torch.rand((13, 4), dtype=torch.float16).to(torch_device)
-    up = torch.rand((13, 4), dtype=torch.float16).to(torch_device)
+def test(lib, descriptor, torch_device, dtype=torch.float16):
+    tol = 1e-2 if dtype == torch.bfloat16 else 1e-3
+    gate = torch.rand((13, 4), dtype=dtype).to(torch_device)
+    up = torch.rand((13, 4), dtype=dtype).to(torch_device)
     ans = swiglu(gate, up)
-    lib.swiglu(descriptor, to_tensor(gate, lib), to_tensor(up, lib), None)
-    assert torch.allclose(gate, ans, atol=1e-3, rtol=1e-3)
+    lib.swiglu(descriptor, None, 0, to_tensor(gate, lib), to_tensor(up, lib), None)
+    assert torch.allclose(gate, ans, atol=tol, rtol=tol)
     print("Test passed!")
 
 
 def test_cpu(lib):
     device = DeviceEnum.DEVICE_CPU
     descriptor = lib.createSwigluDescriptor(device, None)
-    test(lib, descriptor, "cpu")
+    for dtype in [torch.float16, torch.bfloat16, torch.float32]:
+        test(lib, descriptor, "cpu", dtype)
     lib.destroySwigluDescriptor(descriptor)
 
 
@@ -56,6 +58,8 @@ if __name__ == "__main__":
     lib.destroySwigluDescriptor.argtypes = [c_void_p]
     lib.swiglu.argtypes = [
         c_void_p,
+        c_void_p,
+        c_uint64,
         CTensor,
         CTensor,
         c_void_p,
@@ -0,0 +1,220 @@
+import ctypes
+from ctypes import c_char_p, c_int, c_uint64, c_void_p, POINTER
+import sys
+import os
+import json
+import struct
+import tempfile
+
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), "..", "..")))
+from operatorspy import (
+    open_lib,
+    CTensor,
+)
+
+from operatorspy.tests.test_utils import get_args
+
+TRANSPOSED_KEY = "infini.transposed"
+
+
+# a safetensors file of `tensors`, (name, dtype, shape, bytes) in order, with
+# `header` replacing the generated one when given
+def safetensors(tensors, metadata=None, header=None):
+    data = b""
+    if header is None:
+        entries = {}
+        if metadata is not None:
+            entries["__metadata__"] = metadata
+        for name, dtype, shape, payload in tensors:
+            entries[name] = {"dtype": dtype, "shape": shape, "data_offsets": [len(data), len(data) + len(payload)]}
+            data += payload
+        header = json.dumps(entries)
+    else:
+        data = b"".join(payload for _, _, _, payload in tensors)
+    if isinstance(header, str):
+        header = header.encode()
+    return struct.pack("<Q", len(header)) + header + data
+
+
+def write(directory, name, contents):
+    path = os.path.join(directory, name)
+    with open(path, "wb") as f:
+        f.write(contents)
+    return path.encode()
+
+
+def f32(values):
+    return struct.pack(f"<{len(values)}f", *values)
+
+
+def read_floats(tensor, count):
+    return list((ctypes.c_float * count).from_address(tensor.data))
+
+
+def check_layout(tensor, shape, strides):
+    layout = tensor.layout.contents
+    assert [layout.shape[i] for i in range(layout.ndim)] == shape
+    assert [layout.pattern[i] for i in range(layout.ndim)] == strides
+
+
+# parse a written file again, checking it is valid safetensors: data offsets
+# contiguous from 0 to the end, and the data aligned to 64 bytes
+def read_header(path):
+    with open(path, "rb") as f:
+        contents = f.read()
+    (length,) = struct.unpack("<Q", contents[:8])
+    assert (8 + length) % 64 == 0
+    header = json.loads(contents[8 : 8 + length])
+    metadata = header.pop("__metadata__", {})
+    ranges = sorted(entry["data_offsets"] for entry in header.values())
+    end = 0
+    for begin, stop in ranges:
+        assert begin == end
+        end = stop
+    assert 8 + length + end == len(contents)
+    return header, metadata, contents[8 + length :]
+
+
+def test_round_trip(lib, directory):
+    # a (k, n) = (3, 2) weight, a vector, a BF16 matrix and a tensor of a
+    # data type without a layout, whose bytes are carried through
+    b = [float(i) for i in range(6)]
+    bias = [0.5, -0.5]
+    half = bytes(range(8))
+    flags = bytes([1, 0, 1])
+    tensors = [
+        ("flags", "BOOL", [3], flags),
+        ("b", "F32", [3, 2], f32(b)),
+        ("half", "BF16", [2, 2], half),
+        ("bias", "F32", [2], f32(bias)),
+    ]
+    source = write(directory, "source.safetensors", safetensors(tensors, {"format": "pt"}))
+    file = lib.openWeightFile(source)
+    assert file
+    assert lib.getWeightCount(file) == 3
+    assert lib.getWeightName(file, 0) == b"b"
+    assert not lib.getWeight(file, b"flags").layout
+    assert lib.getWeightMetadata(file, b"format") == b"pt"
+    assert lib.getWeightMetadata(file, TRANSPOSED_KEY.encode()) is None
+
+    # not transposed, and a name that is not a weight
+    plain = os.path.join(directory, "plain.safetensors").encode()
+    assert lib.writePackedWeights(file, plain, None, 0) == 0
+    assert lib.writePackedWeights(file, plain, (c_char_p * 1)(b"flags"), 1) != 0
+    header, metadata, data = read_header(plain)
+    assert metadata == {"format": "pt", TRANSPOSED_KEY: ""}
+    begin, end = header["flags"]["data_offsets"]
+    assert header["flags"]["dtype"] == "BOOL" and data[begin:end] == flags
+    assert header["b"]["shape"] == [3, 2]
+    packed = lib.openWeightFile(plain)
+    assert packed
+    weight = lib.getWeight(packed, b"b")
+    check_layout(weight, [3, 2], [8, 4])
+    assert read_floats(weight, 6) == b
+    lib.closeWeightFile(packed)
+
+    # b transposed: stored (n, k) with the same logical shape
+    sidecar = os.path.join(directory, "sidecar.safetensors").encode()
+    assert lib.writePackedWeights(file, sidecar, (c_char_p * 2)(b"b", b"half"), 2) == 0
+    lib.closeWeightFile(file)
+    header, metadata, data = read_header(sidecar)
+    assert metadata["format"] == "pt"
+    assert sorted(metadata[TRANSPOSED_KEY].split("\n")) == ["b", "half"]
+    assert header["b"]["shape"] == [2, 3]
+    begin, end = header["flags"]["data_offsets"]
+    assert data[begin:end] == flags
+    for entry in header.values():
+        size = {"F32": 4, "BF16": 2}.get(entry["dtype"], 1)
+        assert entry["data_offsets"][0] % size == 0
+    file = lib.openWeightFile(sidecar)
+    assert file
+    weight = lib.getWeight(file, b"b")
+    check_layout(weight, [3, 2], [4, 12])
+    # stored column by column, along k
+    assert read_floats(weight, 6) == [b[0], b[2], b[4], b[1], b[3], b[5]]
+    assert read_floats(lib.getWeight(file, b"bias"), 2) == bias
+    check_layout(lib.getWeight(file, b"half"), [2, 2], [2, 4])
+
+    # back to the original layout, the transposition no longer listed
+    again = os.path.join(directory, "again.safetensors").encode()
+    assert lib.writePackedWeights(file, again, None, 0) == 0
+    lib.closeWeightFile(file)
+    header, metadata, data = read_header(again)
+    assert metadata[TRANSPOSED_KEY] == ""
+    assert header["b"]["shape"] == [3, 2]
+    begin, end = header["b"]["data_offsets"]
+    assert data[begin:end] == f32(b)
+    begin, end = header["half"]["data_offsets"]
+    assert data[begin:end] == half
+    print("Round trip passed!")
+
+
+def test_malformed(lib, directory):
+    weight = [("w", "F32", [2], f32([1.0, 2.0]))]
+    entry = '"w":{"dtype":"F32","shape":[2],"data_offsets":[0,8]}'
+    good = safetensors(weight)
+    file = lib.openWeightFile(write(directory, "good.safetensors", good))
+    assert file
+    lib.closeWeightFile(file)
+    cases = {
+        "empty": b"",
+        "short length": b"\x01\x00\x00",
+        "length past the end": struct.pack("<Q", 1 << 40) + good[8:],
+        "length into the data": struct.pack("<Q", len(good) - 8 - 8 + 1) + good[8:],
+        "truncated": safetensors(weight, header="{" + entry),
+        "offsets past the end": safetensors(weight, header='{"w":{"dtype":"F32","shape":[2],"data_offsets":[0,16]}}'),
+        "offsets reversed": safetensors(weight, header='{"w":{"dtype":"F32","shape":[0],"data_offsets":[8,0]}}'),
+        "shape not the bytes": safetensors(weight, header='{"w":{"dtype":"F32","shape":[3],"data_offsets":[0,8]}}'),
+        "no dtype": safetensors(weight, header='{"w":{"shape":[2],"data_offsets":[0,8]}}'),
+        "duplicate names": safetensors(weight, header="{" + entry + "," + entry + "}"),
+        "bad hex escape": safetensors(weight, header='{"\\u00zz":{"dtype":"F32","shape":[2],"data_offsets":[0,8]}}'),
+        "lone high surrogate": safetensors(weight, header='{"\\ud800":{"dtype":"F32","shape":[2],"data_offsets":[0,8]}}'),
+        "high then not low": safetensors(
+            weight, header='{"\\ud800\\u0041":{"dtype":"F32","shape":[2],"data_offsets":[0,8]}}'
+        ),
+        "lone low surrogate": safetensors(weight, header='{"\\udc00":{"dtype":"F32","shape":[2],"data_offsets":[0,8]}}'),
+        "control character": safetensors(weight, header='{"w\n":{"dtype":"F32","shape":[2],"data_offsets":[0,8]}}'),
+    }
+    for name, contents in cases.items():
+        file = lib.openWeightFile(write(directory, "bad.safetensors", contents))
+        assert not file, name
+
+    # a paired surrogate is one character
+    file = lib.openWeightFile(
+        write(directory, "pair.safetensors", safetensors(weight, header='{"\\ud83d\\ude00":' + entry[4:] + "}"))
+    )
+    assert file
+    assert lib.getWeightName(file, 0) == "\U0001F600".encode()
+    lib.closeWeightFile(file)
+    print("Malformed headers passed!")
+
+
+def test_cpu(lib):
+    with tempfile.TemporaryDirectory() as directory:
+        test_round_trip(lib, directory)
+        test_malformed(lib, directory)
+
+
+if __name__ == "__main__":
+    args = get_args()
+    lib = open_lib()
+    lib.openWeightFile.restype = c_void_p
+    lib.openWeightFile.argtypes = [c_char_p]
+    lib.closeWeightFile.argtypes = [c_void_p]
+    lib.getWeightCount.restype = c_uint64
+    lib.getWeightCount.argtypes = [c_void_p]
+    lib.getWeightName.restype = c_char_p
+    lib.getWeightName.argtypes = [c_void_p, c_uint64]
+    lib.getWeight.restype = CTensor
+    lib.getWeight.argtypes = [c_void_p, c_char_p]
+    lib.getWeightMetadata.restype = c_char_p
+    lib.getWeightMetadata.argtypes = [c_void_p, c_char_p]
+    lib.writePackedWeights.restype = c_int
+    lib.writePackedWeights.argtypes = [
+        c_void_p,
+        c_char_p,
+        POINTER(c_char_p),
+        c_uint64,
+    ]
+    if args.cpu:
+        test_cpu(lib)
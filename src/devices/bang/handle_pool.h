@@ -12,11 +12,14 @@ void use_cnnl(cnrtQueue_t queue, T const &f) {
     auto &pool = get_cnnl_pool();
     auto handle = pool.pop();
     if (!handle) {
-        cnnlCreate(&(*handle));
+        cnnlCreate(&handle.emplace());
     }
     cnnlSetQueue(*handle, (cnrtQueue_t) queue);
     f(*handle);
-    pool.push(std::move(*handle));
+    // more handles than the pool holds were in use at once
+    if (!pool.push(std::move(*handle))) {
+        cnnlDestroy(*handle);
+    }
 }
 
 #endif // __BANG_HANDLE_POOL_H__
@@ -0,0 +1,70 @@
+#include "arena.h"
+#include "../../ops/utils.h"
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+// slabs are rounded up to this, the size of a transparent huge page on x86
+constexpr static size_t SLAB_GRANULE = 2 << 20;
+
+struct Slab {
+    void *data = nullptr;
+    size_t size = 0;
+
+    void release() {
+        if (data) {
+#ifdef _WIN32
+            _aligned_free(data);
+#else
+            munmap(data, size);
+#endif
+        }
+        data = nullptr;
+        size = 0;
+    }
+
+    ~Slab() { release(); }
+};
+
+static thread_local Slab slab;
+
+void *arena_allocate(size_t size) {
+    if (size <= slab.size) {
+        return slab.data;
+    }
+    slab.release();
+    size = (size + SLAB_GRANULE - 1) / SLAB_GRANULE * SLAB_GRANULE;
+#ifdef _WIN32
+    slab.data = _aligned_malloc(size, WORKSPACE_ALIGNMENT);
+#else
+    // mappings are page aligned, and a 2MB multiple lets the kernel back them with huge pages
+    slab.data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (slab.data == MAP_FAILED) {
+        slab.data = nullptr;
+    }
+#ifdef MADV_HUGEPAGE
+    else {
+        madvise(slab.data, size, MADV_HUGEPAGE);
+    }
+#endif
+#endif
+    ASSERT_VALID_PTR(slab.data);
+    slab.size = size;
+    return slab.data;
+}
+
+void arena_release() {
+    slab.release();
+}
+
+void *Workspace::get(size_t required) const {
+    if (!data) {
+        return required ? arena_allocate(required) : nullptr;
+    }
+    ASSERT(size >= required);
+    return data;
+}
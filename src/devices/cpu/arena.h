@@ -0,0 +1,31 @@
+#ifndef __CPU_ARENA_H__
+#define __CPU_ARENA_H__
+
+#include <cstddef>
+#include <cstdint>
+
+// alignment of every workspace slice handed to a kernel
+constexpr static size_t WORKSPACE_ALIGNMENT = 64;
+
+inline size_t align_workspace(size_t size) {
+    return (size + WORKSPACE_ALIGNMENT - 1) / WORKSPACE_ALIGNMENT * WORKSPACE_ALIGNMENT;
+}
+
+// Memory owned by the calling thread, at least `size` bytes and 64 byte
+// aligned, valid until its next call. The slab only grows, in whole huge
+// pages where possible, so steady state calls never allocate.
+void *arena_allocate(size_t size);
+
+// releases the slab of the calling thread
+void arena_release();
+
+// Scratch memory of one operator call: the workspace the caller gave, or
+// else the arena of the thread running the call.
+struct Workspace {
+    void *data;
+    size_t size;
+
+    void *get(size_t required) const;
+};
+
+#endif// __CPU_ARENA_H__
@@ -1,22 +1,124 @@
 #include "common_cpu.h"
+#include <cstring>
 
 float f16_to_f32(uint16_t code) {
-    union {
-        uint32_t u32;
-        float f32;
-    } ans{0};
-    ans.u32 = ((static_cast<uint32_t>(code) << 16) & (1 << 31)) |
-              ((((code >> 10) & mask_low(5)) - 15 + 127) << 23) |
-              ((code & mask_low(10)) << 13);
-    return ans.f32;
+    uint32_t sign = static_cast<uint32_t>(code & (1 << 15)) << 16,
+             exponent = (code >> 10) & mask_low(5),
+             mantissa = code & mask_low(10),
+             u32;
+    if (exponent == mask_low(5)) {
+        // inf or nan
+        u32 = sign | (0xffu << 23) | (mantissa << 13);
+    } else if (exponent != 0) {
+        u32 = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    } else if (mantissa != 0) {
+        // subnormal, normalize it as f32
+        exponent = 127 - 14;
+        while (!(mantissa & (1 << 10))) {
+            mantissa <<= 1;
+            --exponent;
+        }
+        u32 = sign | (exponent << 23) | ((mantissa & mask_low(10)) << 13);
+    } else {
+        u32 = sign;
+    }
+    float f32;
+    std::memcpy(&f32, &u32, sizeof(f32));
+    return f32;
 }
 
 uint16_t f32_to_f16(float val) {
-    union {
-        float f32;
-        uint32_t u32;
-    } x{val};
-    return (static_cast<uint16_t>(x.u32 >> 16) & (1 << 15)) |
-           (((static_cast<uint16_t>(x.u32 >> 23) - 127 + 15) & mask_low(5)) << 10) |
-           (static_cast<uint16_t>(x.u32 >> 13) & mask_low(10));
+    uint32_t u32;
+    std::memcpy(&u32, &val, sizeof(u32));
+    uint16_t sign = (u32 >> 16) & (1 << 15);
+    int32_t exponent = static_cast<int32_t>((u32 >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = u32 & 0x7fffff;
+
+    if (((u32 >> 23) & 0xff) == 0xff) {
+        // inf or nan
+        return sign | (mask_low(5) << 10) | (mantissa ? 0x200 : 0);
+    }
+    if (exponent >= 31) {
+        // overflow to inf
+        return sign | (mask_low(5) << 10);
+    }
+    if (exponent <= 0) {
+        // subnormal or underflow to zero
+        if (exponent < -10) {
+            return sign;
+        }
+        mantissa |= 1 << 23;
+        auto shift = 14 - exponent;
+        uint32_t half = mantissa >> shift,
+                 rest = mantissa & ((1u << shift) - 1),
+                 halfway = 1u << (shift - 1);
+        // round to nearest even
+        if (rest > halfway || (rest == halfway && (half & 1))) {
+            ++half;
+        }
+        return sign | static_cast<uint16_t>(half);
+    }
+    uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13),
+             rest = mantissa & mask_low(13);
+    // round to nearest even, a carry into the exponent is still correct
+    if (rest > (1u << 12) || (rest == (1u << 12) && (half & 1))) {
+        ++half;
+    }
+    return sign | static_cast<uint16_t>(half);
+}
+
+float f8_to_f32(uint8_t code, int exponent, int mantissa) {
+    int bias = (1 << (exponent - 1)) - 1,
+        e = (code >> mantissa) & mask_low(exponent),
+        m = code & mask_low(mantissa);
+    float sign = code & 0x80 ? -1.0f : 1.0f;
+    if (e == mask_low(exponent)) {
+        // e5m2 keeps the top exponent for inf and nan as f16 does, e4m3
+        // only the code with every bit set for nan
+        if (exponent == 5) {
+            return m ? NAN : sign * INFINITY;
+        }
+        if (m == mask_low(mantissa)) {
+            return NAN;
+        }
+    }
+    if (e == 0) {
+        return sign * std::ldexp(float(m), 1 - bias - mantissa);
+    }
+    return sign * std::ldexp(float(m | (1 << mantissa)), e - bias - mantissa);
+}
+
+static std::array<float, 256> f8_values(int exponent, int mantissa) {
+    std::array<float, 256> values;
+    for (int code = 0; code < 256; ++code) {
+        values[code] = f8_to_f32(uint8_t(code), exponent, mantissa);
+    }
+    return values;
+}
+
+std::array<float, 256> const f8e4m3_values = f8_values(4, 3),
+                             f8e5m2_values = f8_values(5, 2);
+
+uint8_t f32_to_f8(float val, int exponent, int mantissa) {
+    uint8_t sign = std::signbit(val) ? 0x80 : 0;
+    if (std::isnan(val)) {
+        return sign | 0x7f;
+    }
+    auto a = std::fabs(val);
+    // e5m2 tops out at 57344, e4m3 at 448
+    uint32_t max_code = exponent == 5 ? 0x7b : 0x7e;
+    if (std::isinf(a)) {
+        return sign | max_code;
+    }
+    if (a == 0) {
+        return sign;
+    }
+    int bias = (1 << (exponent - 1)) - 1, e;
+    std::frexp(a, &e);
+    // below the smallest normal, the step between codes stays that of its exponent
+    auto unbiased = std::max(e - 1, 1 - bias);
+    // rounded in steps of the exponent, a carry into the next one is still correct
+    auto q = uint32_t(std::nearbyint(std::ldexp(a, mantissa - unbiased)));
+    auto code = (uint32_t(unbiased + bias) << mantissa) + q - (1u << mantissa);
+    return sign | uint8_t(std::min(code, max_code));
 }
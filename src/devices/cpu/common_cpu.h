@@ -1,8 +1,13 @@
 #ifndef __COMMON_CPU_H__
 #define __COMMON_CPU_H__
 
+#include "../../ops/utils.h"
+#include "data_type.h"
+#include <algorithm>
+#include <array>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
 
 // return a mask with the specified number of low bits set to 1
 constexpr static uint16_t mask_low(int bits) noexcept {
@@ -15,4 +20,136 @@ float f16_to_f32(uint16_t code);
 // convert single-precision float to half-precision float
 uint16_t f32_to_f16(float val);
 
-#endif // __COMMON_CPU_H__
+// convert brain float to single-precision float
+inline float bf16_to_f32(uint16_t code) {
+    uint32_t u32 = static_cast<uint32_t>(code) << 16;
+    float f32;
+    std::memcpy(&f32, &u32, sizeof(f32));
+    return f32;
+}
+
+// convert single-precision float to brain float, rounding to nearest even
+inline uint16_t f32_to_bf16(float val) {
+    uint32_t u32;
+    std::memcpy(&u32, &val, sizeof(u32));
+    if ((u32 & 0x7fffffff) > 0x7f800000) {
+        // keep nan quiet instead of rounding it to inf
+        return static_cast<uint16_t>((u32 >> 16) | 0x40);
+    }
+    u32 += 0x7fff + ((u32 >> 16) & 1);
+    return static_cast<uint16_t>(u32 >> 16);
+}
+
+// convert an 8-bit float of `exponent` and `mantissa` bits to single precision
+float f8_to_f32(uint8_t code, int exponent, int mantissa);
+
+// every code of an 8-bit float converted, so kernels only look one up
+extern std::array<float, 256> const f8e4m3_values, f8e5m2_values;
+
+// convert single precision to an 8-bit float, rounding to nearest even and
+// saturating at the largest finite value
+uint8_t f32_to_f8(float val, int exponent, int mantissa);
+
+// storage types of 16-bit floats, kept distinct so kernels can be templated on them
+struct f16_t {
+    uint16_t bits;
+};
+
+struct bf16_t {
+    uint16_t bits;
+};
+
+// and of 8-bit floats
+struct f8e4m3_t {
+    uint8_t bits;
+};
+
+struct f8e5m2_t {
+    uint8_t bits;
+};
+
+inline float to_f32(float x) { return x; }
+inline float to_f32(f16_t x) { return f16_to_f32(x.bits); }
+inline float to_f32(bf16_t x) { return bf16_to_f32(x.bits); }
+inline float to_f32(f8e4m3_t x) { return f8e4m3_values[x.bits]; }
+inline float to_f32(f8e5m2_t x) { return f8e5m2_values[x.bits]; }
+inline float to_f32(int8_t x) { return x; }
+
+template<class T>
+inline T from_f32(float x);
+template<>
+inline float from_f32<float>(float x) { return x; }
+template<>
+inline f16_t from_f32<f16_t>(float x) { return {f32_to_f16(x)}; }
+template<>
+inline bf16_t from_f32<bf16_t>(float x) { return {f32_to_bf16(x)}; }
+template<>
+inline f8e4m3_t from_f32<f8e4m3_t>(float x) { return {f32_to_f8(x, 4, 3)}; }
+template<>
+inline f8e5m2_t from_f32<f8e5m2_t>(float x) { return {f32_to_f8(x, 5, 2)}; }
+template<>
+inline int8_t from_f32<int8_t>(float x) { return int8_t(std::clamp(std::nearbyint(x), -127.0f, 127.0f)); }
+
+// the largest finite value of a storage type
+template<class T>
+inline float max_finite();
+template<>
+inline float max_finite<f8e4m3_t>() { return 448; }
+template<>
+inline float max_finite<f8e5m2_t>() { return 57344; }
+template<>
+inline float max_finite<int8_t>() { return 127; }
+
+// call `f` with a value of the cpu storage type matching the floating point `dt`
+template<class F>
+void dispatch_float(DataLayout dt, F &&f) {
+    if (dtype_eq(dt, F16)) {
+        f(f16_t{});
+    } else if (dtype_eq(dt, BF16)) {
+        f(bf16_t{});
+    } else if (dtype_eq(dt, F32)) {
+        f(float{});
+    } else {
+        PANIC(UnsupportedDataType);
+    }
+}
+
+// call `f` with a value of the cpu storage type matching the quantized `dt`,
+// I8 or an 8-bit float
+template<class F>
+void dispatch_quantized(DataLayout dt, F &&f) {
+    if (dtype_eq(dt, I8)) {
+        f(int8_t{});
+    } else if (dtype_eq(dt, F8E4M3)) {
+        f(f8e4m3_t{});
+    } else if (dtype_eq(dt, F8E5M2)) {
+        f(f8e5m2_t{});
+    } else {
+        PANIC(UnsupportedDataType);
+    }
+}
+
+inline bool is_quantized(DataLayout dt) {
+    return dtype_eq(dt, I8) || dtype_eq(dt, F8E4M3) || dtype_eq(dt, F8E5M2);
+}
+
+// independent partial sums, so the reduction can be vectorized
+constexpr static int DOT_LANES = 8;
+
+// sum of a[i] * b[i] for i in [0, k), accumulated in f32
+template<class A, class B>
+inline float dot(A const *a, B const *b, int64_t k) {
+    float acc[DOT_LANES] = {};
+    int64_t i = 0;
+    for (; i + DOT_LANES <= k; i += DOT_LANES) {
+        for (int l = 0; l < DOT_LANES; ++l) {
+            acc[l] += to_f32(a[i + l]) * to_f32(b[i + l]);
+        }
+    }
+    float sum = 0;
+    for (int l = 0; l < DOT_LANES; ++l) { sum += acc[l]; }
+    for (; i < k; ++i) { sum += to_f32(a[i]) * to_f32(b[i]); }
+    return sum;
+}
+
+#endif// __COMMON_CPU_H__
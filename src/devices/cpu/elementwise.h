@@ -0,0 +1,83 @@
+#ifndef __CPU_ELEMENTWISE_H__
+#define __CPU_ELEMENTWISE_H__
+
+#include "../../ops/utils.h"
+#include "common_cpu.h"
+#include "operators.h"
+#include "thread_pool.h"
+#include <algorithm>
+
+// number of elements converted to f32 and processed together by one worker
+constexpr static int64_t ELEMENTWISE_BLOCK = 256;
+
+// two equally shaped 2D tensors of the same float type whose rows are contiguous
+struct ElementwisePlan {
+    DataLayout dt;
+    int64_t rows, cols, blocks;
+    // byte strides between rows
+    int64_t stride_y, stride_x;
+};
+
+inline ElementwisePlan plan_elementwise(TensorLayout const *y, TensorLayout const *x) {
+    ASSERT(dtype_eq(y->dt, x->dt));
+    ASSERT_EQ(y->ndim, 2);
+    ASSERT_EQ(x->ndim, 2);
+    ASSERT_EQ(y->shape[0], x->shape[0]);
+    ASSERT_EQ(y->shape[1], x->shape[1]);
+    ASSERT_EQ(y->strides[1], y->dt.size);
+    ASSERT_EQ(x->strides[1], x->dt.size);
+
+    ElementwisePlan plan;
+    plan.dt = y->dt;
+    plan.rows = y->shape[0];
+    plan.cols = y->shape[1];
+    plan.blocks = ROUND_UP_DIV(plan.cols, ELEMENTWISE_BLOCK);
+    plan.stride_y = y->strides[0];
+    plan.stride_x = x->strides[0];
+    return plan;
+}
+
+// Calls `f(y_row, x_row, len)` for every block of the tensors.
+// Work is split into (row, block) items so that decode-sized inputs with a
+// single row are still spread across threads.
+template<class T, class F>
+void for_each_block(ElementwisePlan const &plan, void *y, void const *x, F const &f) {
+    parallel_for(plan.rows * plan.blocks, [&](int64_t items_begin, int64_t items_end) {
+        for (auto item = items_begin; item < items_end; ++item) {
+            auto i = item / plan.blocks,
+                 begin = item % plan.blocks * ELEMENTWISE_BLOCK,
+                 len = std::min(ELEMENTWISE_BLOCK, plan.cols - begin);
+            auto y_row = reinterpret_cast<T *>(reinterpret_cast<char *>(y) + i * plan.stride_y) + begin;
+            auto x_row = reinterpret_cast<T const *>(reinterpret_cast<char const *>(x) + i * plan.stride_x) + begin;
+            f(y_row, x_row, len);
+        }
+    });
+}
+
+// y = op(x). Each block is widened to f32 once, so the inner loop over `op`
+// is a plain f32 loop the compiler can vectorize.
+template<class T, class Op>
+void elementwise_map(ElementwisePlan const &plan, void *y, void const *x, Op op) {
+    for_each_block<T>(plan, y, x, [&](T *y_row, T const *x_row, int64_t len) {
+        float buf[ELEMENTWISE_BLOCK];
+        for (int64_t j = 0; j < len; ++j) { buf[j] = to_f32(x_row[j]); }
+        for (int64_t j = 0; j < len; ++j) { buf[j] = op(buf[j]); }
+        for (int64_t j = 0; j < len; ++j) { y_row[j] = from_f32<T>(buf[j]); }
+    });
+}
+
+// y = op(y, x)
+template<class T, class Op>
+void elementwise_update(ElementwisePlan const &plan, void *y, void const *x, Op op) {
+    for_each_block<T>(plan, y, x, [&](T *y_row, T const *x_row, int64_t len) {
+        float buf_y[ELEMENTWISE_BLOCK], buf_x[ELEMENTWISE_BLOCK];
+        for (int64_t j = 0; j < len; ++j) {
+            buf_y[j] = to_f32(y_row[j]);
+            buf_x[j] = to_f32(x_row[j]);
+        }
+        for (int64_t j = 0; j < len; ++j) { buf_y[j] = op(buf_y[j], buf_x[j]); }
+        for (int64_t j = 0; j < len; ++j) { y_row[j] = from_f32<T>(buf_y[j]); }
+    });
+}
+
+#endif// __CPU_ELEMENTWISE_H__
@@ -0,0 +1,134 @@
+#ifndef __CPU_NORM_H__
+#define __CPU_NORM_H__
+
+#include "../../ops/utils.h"
+#include "common_cpu.h"
+#include "operators.h"
+#include "thread_pool.h"
+#include <cmath>
+
+// Rows of a 2D tensor normalized one by one, read from x, or with a
+// residual from x plus the residual, which is written back to it first.
+struct NormPlan {
+    uint64_t n, d;
+    // byte strides between rows
+    int64_t stride_y, stride_x, stride_residual;
+    bool residual;
+};
+
+inline NormPlan plan_norm(TensorLayout const *y, TensorLayout const *x, TensorLayout const *w, TensorLayout const *residual) {
+    ASSERT_EQ(y->ndim, 2);
+    ASSERT_EQ(x->ndim, 2);
+    ASSERT_EQ(w->ndim, 1);
+
+    auto n = y->shape[0],
+         d = y->shape[1];
+
+    ASSERT_EQ(x->shape[0], n);
+    ASSERT_EQ(x->shape[1], d);
+    ASSERT_EQ(w->shape[0], d);
+    ASSERT(dtype_eq(y->dt, x->dt));
+    ASSERT_EQ(y->strides[1], y->dt.size);
+    ASSERT_EQ(x->strides[1], x->dt.size);
+    ASSERT_EQ(w->strides[0], w->dt.size);
+
+    NormPlan plan{n, d, y->strides[0], x->strides[0], 0, residual != nullptr};
+    if (residual) {
+        ASSERT_EQ(residual->ndim, 2);
+        ASSERT_EQ(residual->shape[0], n);
+        ASSERT_EQ(residual->shape[1], d);
+        ASSERT(dtype_eq(residual->dt, x->dt));
+        ASSERT_EQ(residual->strides[1], residual->dt.size);
+        plan.stride_residual = residual->strides[0];
+    }
+    return plan;
+}
+
+// 1 / the root mean square of a row, by which `rmsNorm` scales it
+template<class T>
+float rms_scale(T const *x, uint64_t d, float epsilon) {
+    return 1.0f / std::sqrt(dot(x, x, d) / d + epsilon);
+}
+
+// count, mean and sum of squared deviations of some numbers
+struct Moments {
+    float count, mean, m2;
+
+    float variance() const { return count ? m2 / count : 0; }
+};
+
+// the moments of two disjoint sets of numbers together
+inline Moments merge_moments(Moments const &a, Moments const &b) {
+    auto count = a.count + b.count;
+    if (count == 0) {
+        return a;
+    }
+    auto delta = b.mean - a.mean;
+    return {count, a.mean + delta * b.count / count, a.m2 + b.m2 + delta * delta * a.count * b.count / count};
+}
+
+// Welford's single pass over `d` numbers, on `DOT_LANES` independent lanes
+// merged at the end, so it vectorizes and stays exact for rows whose mean
+// is far from zero.
+template<class T>
+Moments moments(T const *x, uint64_t d) {
+    float mean[DOT_LANES] = {}, m2[DOT_LANES] = {};
+    uint64_t i = 0;
+    float count = 0;
+    for (; i + DOT_LANES <= d; i += DOT_LANES) {
+        // every lane has seen as many numbers
+        auto inv = 1.0f / ++count;
+        for (int l = 0; l < DOT_LANES; ++l) {
+            auto v = to_f32(x[i + l]),
+                 delta = v - mean[l];
+            mean[l] += delta * inv;
+            m2[l] += delta * (v - mean[l]);
+        }
+    }
+    Moments total{0, 0, 0};
+    for (int l = 0; l < DOT_LANES; ++l) {
+        total = merge_moments(total, {count, mean[l], m2[l]});
+    }
+    for (; i < d; ++i) {
+        total = merge_moments(total, {1, to_f32(x[i]), 0});
+    }
+    return total;
+}
+
+// Normalizes every row of x into y, as y = (x - shift) * scale * w + b
+// with (shift, scale) = `stats(row, d)` of the row and b optional. Rows
+// are spread over threads.
+template<class T, class W, class Stats>
+void normalize_rows(NormPlan const &plan, void *y, void const *x, void *residual, void const *w, void const *b, Stats const &stats) {
+    auto d = plan.d;
+    auto w_ = reinterpret_cast<W const *>(w);
+    auto b_ = reinterpret_cast<W const *>(b);
+
+    parallel_for(plan.n, [&](int64_t begin, int64_t end) {
+        for (auto i = begin; i < end; ++i) {
+            auto y_ = reinterpret_cast<T *>(reinterpret_cast<char *>(y) + i * plan.stride_y);
+            auto x_ = reinterpret_cast<T const *>(reinterpret_cast<char const *>(x) + i * plan.stride_x);
+            if (plan.residual) {
+                auto r_ = reinterpret_cast<T *>(reinterpret_cast<char *>(residual) + i * plan.stride_residual);
+                for (uint64_t j = 0; j < d; ++j) {
+                    r_[j] = from_f32<T>(to_f32(x_[j]) + to_f32(r_[j]));
+                }
+                // the sum as stored, as a separate add would leave it
+                x_ = r_;
+            }
+
+            auto [shift, scale] = stats(x_, d);
+            if (b_) {
+                for (uint64_t j = 0; j < d; ++j) {
+                    y_[j] = from_f32<T>((to_f32(x_[j]) - shift) * scale * to_f32(w_[j]) + to_f32(b_[j]));
+                }
+            } else {
+                for (uint64_t j = 0; j < d; ++j) {
+                    y_[j] = from_f32<T>((to_f32(x_[j]) - shift) * scale * to_f32(w_[j]));
+                }
+            }
+        }
+    });
+}
+
+#endif// __CPU_NORM_H__
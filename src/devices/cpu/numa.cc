@@ -0,0 +1,167 @@
+#include "numa.h"
+#include "../../ops/utils.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+std::vector<int> parse_cpu_list(char const *list) {
+    std::vector<int> cpus;
+    std::string s(list);
+    size_t pos = 0;
+    while (pos < s.size()) {
+        auto next = s.find(',', pos);
+        auto item = s.substr(pos, next == std::string::npos ? std::string::npos : next - pos);
+        auto dash = item.find('-');
+        if (!item.empty() && item[0] != '\n') {
+            int first = std::atoi(item.c_str()),
+                last = dash == std::string::npos ? first : std::atoi(item.c_str() + dash + 1);
+            for (int cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        }
+        if (next == std::string::npos) {
+            break;
+        }
+        pos = next + 1;
+    }
+    return cpus;
+}
+
+std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+        return cpus;
+    }
+#endif
+    for (int cpu = 0; cpu < int(std::max(1u, std::thread::hardware_concurrency())); ++cpu) {
+        cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+static std::string read_file(std::string const &path) {
+    std::ifstream file(path);
+    std::string content;
+    std::getline(file, content);
+    return content;
+}
+
+std::vector<std::vector<int>> const &numa_nodes() {
+    static auto nodes = [] {
+        auto allowed = allowed_cpus();
+        std::vector<std::vector<int>> nodes;
+        for (auto node : parse_cpu_list(read_file("/sys/devices/system/node/online").c_str())) {
+            std::vector<int> cpus;
+            for (auto cpu : parse_cpu_list(read_file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist").c_str())) {
+                if (std::find(allowed.begin(), allowed.end(), cpu) != allowed.end()) {
+                    cpus.push_back(cpu);
+                }
+            }
+            // memory-only nodes and nodes outside our affinity run no threads
+            if (!cpus.empty()) {
+                nodes.push_back(std::move(cpus));
+            }
+        }
+        if (nodes.empty()) {
+            nodes.push_back(std::move(allowed));
+        }
+        return nodes;
+    }();
+    return nodes;
+}
+
+int numa_node_of(int cpu) {
+    auto const &nodes = numa_nodes();
+    for (size_t node = 0; node < nodes.size(); ++node) {
+        if (std::find(nodes[node].begin(), nodes[node].end(), cpu) != nodes[node].end()) {
+            return int(node);
+        }
+    }
+    return 0;
+}
+
+static size_t page_size() {
+#ifdef __linux__
+    return size_t(sysconf(_SC_PAGESIZE));
+#else
+    return 4096;
+#endif
+}
+
+// Rank of `thread` among those first touching the pages of its node, and
+// their count: the pinned workers of the node. The calling thread is not
+// pinned, so it touches nothing unless it is alone on its node.
+static bool toucher(ThreadPool const &pool, int thread, int &rank, int &count) {
+    auto node = pool.node_of(thread);
+    auto begin = pool.node_begin(node), end = pool.node_begin(node + 1);
+    if (begin == 0 && end > 1) {
+        if (thread == 0) {
+            return false;
+        }
+        begin = 1;
+    }
+    rank = thread - begin;
+    count = end - begin;
+    return true;
+}
+
+void numa_place(void *dst, void const *src, size_t rows, size_t row_bytes, bool interleave) {
+    auto dst_ = static_cast<uint8_t *>(dst);
+    auto src_ = static_cast<uint8_t const *>(src);
+    auto fill = [=](size_t begin, size_t end) {
+        if (src_) {
+            std::memcpy(dst_ + begin, src_ + begin, end - begin);
+        } else {
+            std::memset(dst_ + begin, 0, end - begin);
+        }
+    };
+
+    // Rows of a node are those a plain split gives its threads, which are
+    // numbered consecutively; page p goes to node p % nodes when interleaved.
+    struct Context {
+        size_t rows, row_bytes, page;
+        bool interleave;
+        decltype(fill) const &f;
+    } context{rows, row_bytes, page_size(), interleave, fill};
+    auto &pool = ThreadPool::instance();
+    pool.run([](void *context, int thread, int threads) {
+        auto const &c = *static_cast<Context *>(context);
+        auto &pool = ThreadPool::instance();
+        int rank, count;
+        if (!toucher(pool, thread, rank, count)) {
+            return;
+        }
+        auto node = pool.node_of(thread);
+        if (!c.interleave) {
+            auto begin = c.rows * pool.node_begin(node) / threads,
+                 end = c.rows * pool.node_begin(node + 1) / threads;
+            c.f((begin + (end - begin) * rank / count) * c.row_bytes,
+                (begin + (end - begin) * (rank + 1) / count) * c.row_bytes);
+            return;
+        }
+        auto nodes = size_t(pool.nodes());
+        auto bytes = c.rows * c.row_bytes;
+        auto pages = ROUND_UP_DIV(bytes, c.page);
+        for (size_t p = node + nodes * rank; p < pages; p += nodes * count) {
+            c.f(p * c.page, std::min(bytes, (p + 1) * c.page));
+        }
+    },
+             &context, pool.threads());
+}
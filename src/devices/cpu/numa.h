@@ -0,0 +1,26 @@
+#ifndef __CPU_NUMA_H__
+#define __CPU_NUMA_H__
+
+#include <cstddef>
+#include <vector>
+
+// parse a cpu list such as "0-7,16-23"
+std::vector<int> parse_cpu_list(char const *list);
+
+// cpus this process may run on, honoring taskset and cgroup limits
+std::vector<int> allowed_cpus();
+
+// allowed cpus of every NUMA node that has any, read once from sysfs.
+// Hosts without NUMA information report a single node.
+std::vector<std::vector<int>> const &numa_nodes();
+
+// index into `numa_nodes()` of the node holding `cpu`, 0 when unknown
+int numa_node_of(int cpu);
+
+// Copy `rows` rows of `row_bytes` from `src` into `dst`, zero filling when
+// `src` is null. Each page is first touched by a worker pinned to the node it
+// should reside on, so `dst` must not have been touched before. Rows are
+// split across nodes like the threads are, or pages spread round-robin.
+void numa_place(void *dst, void const *src, size_t rows, size_t row_bytes, bool interleave);
+
+#endif// __CPU_NUMA_H__
@@ -0,0 +1,48 @@
+#ifndef __CPU_SEQLENS_H__
+#define __CPU_SEQLENS_H__
+
+#include "../../ops/utils.h"
+#include "arena.h"
+#include "operators.h"
+#include <algorithm>
+#include <cstdint>
+
+// Sequences of different lengths packed one after another, described by
+// the offsets of their first rows, cu_seqlens style: (sequences + 1) I32 or
+// I64 from 0 to the total, sequence s spanning [offsets[s], offsets[s + 1]).
+struct SeqOffsetsCpuLayout {
+    uint64_t sequences;
+    // byte stride and size of the elements
+    int64_t stride;
+    uint64_t size;
+};
+
+inline SeqOffsetsCpuLayout plan_seq_offsets(TensorLayout const *offsets) {
+    ASSERT_EQ(offsets->ndim, 1);
+    ASSERT(offsets->shape[0] >= 1);
+    ASSERT(dtype_eq(offsets->dt, I32) || dtype_eq(offsets->dt, I64));
+    return {offsets->shape[0] - 1, offsets->strides[0], offsets->dt.size};
+}
+
+// workspace bytes of the offsets of `read_seq_offsets`
+inline size_t seq_offsets_bytes(SeqOffsetsCpuLayout const &layout) {
+    return align_workspace((layout.sequences + 1) * sizeof(int64_t));
+}
+
+// The offsets widened into `offsets`, (sequences + 1) long, checked to rise
+// from 0, to `total` unless it is negative.
+inline void read_seq_offsets(SeqOffsetsCpuLayout const &layout, void const *data, int64_t *offsets, int64_t total = -1) {
+    for (uint64_t s = 0; s <= layout.sequences; ++s) {
+        auto p = reinterpret_cast<char const *>(data) + s * layout.stride;
+        offsets[s] = layout.size == 8 ? *reinterpret_cast<int64_t const *>(p) : *reinterpret_cast<int32_t const *>(p);
+        ASSERT(s == 0 ? offsets[s] == 0 : offsets[s] >= offsets[s - 1]);
+    }
+    ASSERT(total < 0 || offsets[layout.sequences] == total);
+}
+
+// the sequence holding row `i`, skipping empty ones
+inline uint64_t sequence_of(int64_t const *offsets, uint64_t sequences, int64_t i) {
+    return std::upper_bound(offsets, offsets + sequences + 1, i) - offsets - 1;
+}
+
+#endif// __CPU_SEQLENS_H__
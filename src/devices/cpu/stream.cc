@@ -0,0 +1,67 @@
+#include "stream.h"
+
+CpuStream::CpuStream() : _enqueued(0), _completed(0), _stop(false), _thread(&CpuStream::loop, this) {}
+
+CpuStream::~CpuStream() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _queued.notify_one();
+    _thread.join();
+}
+
+void CpuStream::enqueue(CpuCall call) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_capture) {
+            _capture->calls.push_back(std::move(call));
+            return;
+        }
+        _queue.push_back(std::move(call));
+        ++_enqueued;
+    }
+    _queued.notify_one();
+}
+
+uint64_t CpuStream::enqueued() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _enqueued;
+}
+
+bool CpuStream::completed(uint64_t position) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _completed >= position;
+}
+
+void CpuStream::wait(uint64_t position) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _done.wait(lock, [&] { return _completed >= position; });
+}
+
+void CpuStream::begin_capture() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _capture = std::make_unique<CpuGraph>();
+}
+
+CpuGraph *CpuStream::end_capture() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _capture.release();
+}
+
+void CpuStream::loop() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+        _queued.wait(lock, [&] { return _stop || !_queue.empty(); });
+        if (_queue.empty()) {
+            return;
+        }
+        auto call = std::move(_queue.front());
+        _queue.pop_front();
+        lock.unlock();
+        call();
+        lock.lock();
+        ++_completed;
+        _done.notify_all();
+    }
+}
@@ -0,0 +1,109 @@
+#ifndef __CPU_STREAM_H__
+#define __CPU_STREAM_H__
+
+#include "arena.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// An operator call with the data pointers it reads and writes kept beside
+// it, so that a captured call can be replayed on other data.
+struct CpuCall {
+    std::function<void(void *const *data)> run;
+    std::vector<void *> data;
+
+    void operator()() const { run(data.data()); }
+};
+
+// calls captured from a stream, replayed in order
+struct CpuGraph {
+    std::vector<CpuCall> calls;
+
+    void operator()() const {
+        for (auto const &call : calls) {
+            call();
+        }
+    }
+};
+
+// An ordered queue of operator calls, run one after another by a thread of
+// its own which hands the work of each call to the thread pool.
+class CpuStream {
+public:
+    CpuStream();
+    CpuStream(const CpuStream &) = delete;
+    // runs what is still queued first
+    ~CpuStream();
+
+    // queues the call, or adds it to the graph being captured
+    void enqueue(CpuCall call);
+
+    // number of calls enqueued so far, the position an event records
+    uint64_t enqueued();
+    bool completed(uint64_t position);
+    void wait(uint64_t position);
+    void synchronize() { wait(enqueued()); }
+
+    void begin_capture();
+    CpuGraph *end_capture();
+
+private:
+    void loop();
+
+    std::mutex _mutex;
+    std::condition_variable _queued, _done;
+    std::deque<CpuCall> _queue;
+    uint64_t _enqueued, _completed;
+    bool _stop;
+    std::unique_ptr<CpuGraph> _capture;
+    std::thread _thread;
+};
+
+// the position of a stream an event was last recorded at
+struct CpuEvent {
+    CpuStream *stream;
+    uint64_t position;
+};
+
+// Call `f(plan, data, workspace)` now, or on the cpu stream when `stream` is
+// not null, with the plan of the descriptor or else one `make_plan()` builds
+// for this call. `f` must reach the tensors only through `data`, which a
+// captured graph rebinds, as it does the workspace stored after them. A
+// queued call keeps its own copy of such a plan, so the tensor layouts need
+// not outlive the call, only the descriptor and the data do.
+template<class Plan, class Make, class F>
+void launch(std::optional<Plan> const &plan, Make const &make_plan, void *stream,
+            Workspace workspace, std::initializer_list<void *> data, F f) {
+    if (!stream) {
+        if (plan) {
+            f(*plan, data.begin(), workspace);
+        } else {
+            f(make_plan(), data.begin(), workspace);
+        }
+        return;
+    }
+    std::vector<void *> data_(data);
+    data_.push_back(workspace.data);
+    auto size = workspace.size;
+    auto n = data.size();
+    if (plan) {
+        static_cast<CpuStream *>(stream)->enqueue({[&plan = *plan, f, size, n](void *const *data) { f(plan, data, Workspace{data[n], size}); }, std::move(data_)});
+    } else {
+        static_cast<CpuStream *>(stream)->enqueue({[plan = make_plan(), f, size, n](void *const *data) { f(plan, data, Workspace{data[n], size}); }, std::move(data_)});
+    }
+}
+
+// `launch` of a call that needs no scratch memory, `f(plan, data)`
+template<class Plan, class Make, class F>
+void launch(std::optional<Plan> const &plan, Make const &make_plan, void *stream, std::initializer_list<void *> data, F f) {
+    launch(plan, make_plan, stream, Workspace{nullptr, 0}, data, [f](Plan const &plan, void *const *data, Workspace) { f(plan, data); });
+}
+
+#endif// __CPU_STREAM_H__
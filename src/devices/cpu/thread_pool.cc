@@ -0,0 +1,211 @@
+#include "thread_pool.h"
+#include "numa.h"
+#include <cstdlib>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CPU_RELAX() _mm_pause()
+#else
+#define CPU_RELAX() std::this_thread::yield()
+#endif
+
+// polls of the generation counter before an idle worker parks, tens of microseconds
+constexpr static int SPIN_ITERATIONS = 1 << 14;
+// polls between yields, so that spinning never starves the threads doing work
+// when there are more threads than cores
+constexpr static int YIELD_INTERVAL = 1 << 6;
+
+// the thread currently executing a task, nested `run` calls execute inline
+static thread_local bool in_task = false;
+
+constexpr static int STATE_BITS = 16;
+
+static uint64_t next_state(uint64_t state, int active) {
+    return ((state >> STATE_BITS) + 1) << STATE_BITS | uint64_t(active);
+}
+
+ThreadPool &ThreadPool::instance() {
+    static ThreadPool pool([] {
+        auto cores = parse_cpu_list(std::getenv("INFINI_CPU_CORES") ? std::getenv("INFINI_CPU_CORES") : "");
+        auto threads = std::getenv("INFINI_NUM_THREADS") ? std::atoi(std::getenv("INFINI_NUM_THREADS")) : 0;
+        return ThreadPool(threads, cores);
+    }());
+    return pool;
+}
+
+ThreadPool::ThreadPool(int threads, std::vector<int> cores)
+    : _threads(1), _spin(0), _task(nullptr), _context(nullptr), _stop(false),
+      _state(0), _pending(0), _parked(0) {
+    start(threads, std::move(cores));
+}
+
+ThreadPool::~ThreadPool() {
+    stop();
+}
+
+void ThreadPool::start(int threads, std::vector<int> cores) {
+    auto available = int(allowed_cpus().size());
+    if (threads <= 0) {
+        threads = cores.empty() ? available : int(cores.size());
+    }
+    _threads = std::clamp(threads, 1, (1 << STATE_BITS) - 1);
+    // an oversubscribed worker would only spin away the time slice of another
+    _spin = _threads <= available ? SPIN_ITERATIONS : 0;
+    _stop = false;
+
+    // the node of every thread and the cpus a worker is pinned to: the given
+    // cores, else the whole node when there are several, else none
+    auto const &nodes = numa_nodes();
+    std::vector<int> node(_threads);
+    std::vector<std::vector<int>> pin(_threads);
+    std::vector<int> spread;
+    for (auto const &cpus : nodes) {
+        spread.insert(spread.end(), cpus.begin(), cpus.end());
+    }
+    for (int i = 0; i < _threads; ++i) {
+        if (!cores.empty()) {
+            auto core = cores[i % cores.size()];
+            node[i] = numa_node_of(core);
+            pin[i] = {core};
+        } else if (nodes.size() > 1) {
+            node[i] = numa_node_of(spread[size_t(i) * spread.size() / _threads]);
+            pin[i] = nodes[node[i]];
+        }
+    }
+
+    // Threads of a node get consecutive indices, starting with the node of
+    // thread 0, so contiguous ranges of a split stay on one node. Thread 0 is
+    // whichever thread calls `run` and is never pinned, so it only counts as
+    // a thread of that node; `numa_place` leaves the first touch to workers.
+    std::vector<int> order(_threads);
+    for (int i = 0; i < _threads; ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int l, int r) {
+        return std::make_pair(node[l] != node[0], node[l]) < std::make_pair(node[r] != node[0], node[r]);
+    });
+    _index.assign(_threads, 0);
+    _node_of.assign(_threads, 0);
+    _node_begin.assign(1, 0);
+    for (int i = 0; i < _threads; ++i) {
+        if (i > 0 && node[order[i]] != node[order[i - 1]]) {
+            _node_begin.push_back(i);
+        }
+        _index[order[i]] = i;
+        _node_of[i] = int(_node_begin.size()) - 1;
+    }
+    _node_begin.push_back(_threads);
+
+    // taken here rather than by the workers, which may only start after the first dispatch
+    auto generation = _state.load(std::memory_order_relaxed) >> STATE_BITS;
+    for (int i = 1; i < _threads; ++i) {
+        _workers.emplace_back(&ThreadPool::work, this, i, pin[i], generation);
+    }
+}
+
+void ThreadPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(_park_mutex);
+        _stop = true;
+        _state.store(next_state(_state.load(), 0), std::memory_order_release);
+    }
+    _park.notify_all();
+    for (auto &worker : _workers) {
+        worker.join();
+    }
+    _workers.clear();
+    _threads = 1;
+}
+
+void ThreadPool::configure(int threads, std::vector<int> cores) {
+    std::lock_guard<std::mutex> lock(_dispatch);
+    stop();
+    start(threads, std::move(cores));
+}
+
+void ThreadPool::work(int id, std::vector<int> cpus, uint64_t seen) {
+#ifdef __linux__
+    if (!cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (auto cpu : cpus) {
+            CPU_SET(cpu, &set);
+        }
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+#endif
+    in_task = true;
+    auto index = _index[id];
+    while (true) {
+        auto state = _state.load(std::memory_order_acquire);
+        for (int i = 0; i < _spin && state >> STATE_BITS == seen; ++i) {
+            CPU_RELAX();
+            if (i % YIELD_INTERVAL == YIELD_INTERVAL - 1) {
+                std::this_thread::yield();
+            }
+            state = _state.load(std::memory_order_acquire);
+        }
+        if (state >> STATE_BITS == seen) {
+            std::unique_lock<std::mutex> lock(_park_mutex);
+            _parked.fetch_add(1, std::memory_order_relaxed);
+            _park.wait(lock, [&] { return _state.load(std::memory_order_acquire) >> STATE_BITS != seen; });
+            _parked.fetch_sub(1, std::memory_order_relaxed);
+            state = _state.load(std::memory_order_acquire);
+        }
+        seen = state >> STATE_BITS;
+        if (_stop) {
+            return;
+        }
+        // the dispatcher waits for every thread taking part, so the task is stable here
+        auto active = int(state & ((1 << STATE_BITS) - 1));
+        if (index < active) {
+            _task(_context, index, active);
+            _pending.fetch_sub(1, std::memory_order_release);
+        }
+    }
+}
+
+void ThreadPool::run(Task task, void *context, int threads, Prepare prepare) {
+    if (in_task || threads <= 1) {
+        if (prepare) {
+            prepare(context, threads);
+        }
+        for (int i = 0; i < threads; ++i) {
+            task(context, i, threads);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> dispatch(_dispatch);
+    threads = std::min(threads, _threads);
+    if (prepare) {
+        prepare(context, threads);
+    }
+    _task = task;
+    _context = context;
+    _pending.store(threads - 1, std::memory_order_relaxed);
+    {
+        // published under the park mutex so a worker about to park cannot miss it
+        std::lock_guard<std::mutex> lock(_park_mutex);
+        _state.store(next_state(_state.load(std::memory_order_relaxed), threads), std::memory_order_release);
+    }
+    if (_parked.load(std::memory_order_relaxed) > 0) {
+        _park.notify_all();
+    }
+
+    in_task = true;
+    task(context, 0, threads);
+    in_task = false;
+
+    for (int i = 0; _pending.load(std::memory_order_acquire) > 0; ++i) {
+        CPU_RELAX();
+        if (i % YIELD_INTERVAL == YIELD_INTERVAL - 1) {
+            std::this_thread::yield();
+        }
+    }
+}
@@ -0,0 +1,228 @@
+#ifndef __CPU_THREAD_POOL_H__
+#define __CPU_THREAD_POOL_H__
+
+#include "../../ops/utils.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Library-owned persistent workers shared by every cpu operator.
+//
+// The thread calling `run` takes part as thread 0, workers are threads
+// 1..n-1. Idle workers spin for a short while before parking, so back to
+// back operator calls are dispatched without a wake-up syscall.
+//
+// On hosts with several NUMA nodes, workers are bound to nodes and threads
+// of one node are numbered consecutively, so a contiguous split of work is
+// also a split by node. The calling thread counts as a thread of the first,
+// though it is not pinned there.
+class ThreadPool {
+public:
+    typedef void (*Task)(void *context, int thread, int threads);
+    typedef void (*Prepare)(void *context, int threads);
+
+    // the process-wide pool, configured from INFINI_NUM_THREADS and
+    // INFINI_CPU_CORES on first use
+    static ThreadPool &instance();
+
+    ThreadPool(int threads, std::vector<int> cores);
+    ThreadPool(const ThreadPool &) = delete;
+    ~ThreadPool();
+
+    // number of threads taking part in a `run`, including the caller
+    int threads() const { return _threads; }
+
+    // nodes spanned by the threads, numbered in the order of their threads
+    int nodes() const { return int(_node_begin.size()) - 1; }
+    int node_of(int thread) const { return _node_of[thread]; }
+    // first thread of a node, `node_begin(nodes())` is `threads()`
+    int node_begin(int node) const { return _node_begin[node]; }
+
+    // call `task(context, i, threads)` for every i in [0, threads) and wait for all of them;
+    // `threads` is capped at the pool size as of the dispatch, which `prepare(context, threads)`
+    // sees before any task starts, so state split per thread can be built for the actual count
+    void run(Task task, void *context, int threads, Prepare prepare = nullptr);
+
+    // restart the workers, pinning worker i to cores[i % cores.size()] when cores are given;
+    // threads <= 0 uses one thread per core
+    void configure(int threads, std::vector<int> cores);
+
+private:
+    void start(int threads, std::vector<int> cores);
+    void stop();
+    void work(int id, std::vector<int> cpus, uint64_t seen);
+
+    int _threads, _spin;
+    std::vector<std::thread> _workers;
+    // thread index taken by each worker, and the node of each thread index
+    std::vector<int> _index, _node_of, _node_begin;
+    // serializes dispatches from different caller threads
+    std::mutex _dispatch;
+
+    Task _task;
+    void *_context;
+    bool _stop;
+    // generation << 16 | threads taking part in it, read as one word so a worker
+    // left out of a generation never looks at the task of a later one
+    std::atomic<uint64_t> _state;
+    std::atomic<int> _pending;
+
+    std::mutex _park_mutex;
+    std::condition_variable _park;
+    std::atomic<int> _parked;
+};
+
+// Calls f(begin, end), or f(begin, end, thread) when f takes the index of the
+// thread running it, for instance to pick its slice of a workspace.
+template<class F>
+inline void call_range(F const &f, int64_t begin, int64_t end, int thread) {
+    if constexpr (std::is_invocable_v<F const &, int64_t, int64_t, int>) {
+        f(begin, end, thread);
+    } else {
+        f(begin, end);
+    }
+}
+
+// f(begin, end) over [0, n) split into one even range per thread, using at
+// most `max_threads` of them when it is positive
+template<class F>
+void parallel_for(int64_t n, F const &f, int max_threads = 0) {
+    if (n <= 0) {
+        return;
+    }
+    auto &pool = ThreadPool::instance();
+    auto threads = int(std::min<int64_t>(n, max_threads > 0 ? std::min(max_threads, pool.threads()) : pool.threads()));
+    struct Context {
+        int64_t n;
+        F const &f;
+    } context{n, f};
+    pool.run([](void *context, int thread, int threads) {
+        auto const &c = *static_cast<Context *>(context);
+        call_range(c.f, c.n * thread / threads, c.n * (thread + 1) / threads, thread);
+    },
+             &context, threads);
+}
+
+// A range of chunks packed as (begin << 32 | end), so that its owner taking
+// from the front and thieves taking from the back agree through one CAS.
+struct alignas(64) StealRange {
+    std::atomic<uint64_t> range;
+
+    static uint64_t pack(uint32_t begin, uint32_t end) { return uint64_t(begin) << 32 | end; }
+
+    bool pop_front(uint32_t &chunk) {
+        auto v = range.load(std::memory_order_relaxed);
+        while (true) {
+            uint32_t begin = v >> 32, end = uint32_t(v);
+            if (begin >= end) {
+                return false;
+            }
+            if (range.compare_exchange_weak(v, pack(begin + 1, end), std::memory_order_acq_rel)) {
+                chunk = begin;
+                return true;
+            }
+        }
+    }
+
+    // take the back half of the remaining chunks
+    bool steal(uint32_t &begin_, uint32_t &end_) {
+        auto v = range.load(std::memory_order_relaxed);
+        while (true) {
+            uint32_t begin = v >> 32, end = uint32_t(v);
+            if (begin >= end) {
+                return false;
+            }
+            auto mid = begin + (end - begin) / 2;
+            if (range.compare_exchange_weak(v, pack(begin, mid), std::memory_order_acq_rel)) {
+                begin_ = mid;
+                end_ = end;
+                return true;
+            }
+        }
+    }
+};
+
+// The ranges of `parallel_for_dynamic` calls from one thread, kept so that
+// none allocates once it has seen the pool size. `busy` while a call from
+// the thread is running, so that a nested one does not reuse them.
+struct StealRanges {
+    std::unique_ptr<StealRange[]> ranges;
+    int capacity = 0;
+    bool busy = false;
+};
+
+inline StealRanges &thread_steal_ranges() {
+    thread_local StealRanges ranges;
+    return ranges;
+}
+
+// f(begin, end) over chunks of `grain` items of [0, n). Every thread starts
+// with an even share of chunks and steals from others once it runs out,
+// which balances work of uneven cost such as causal attention rows.
+template<class F>
+void parallel_for_dynamic(int64_t n, int64_t grain, F const &f) {
+    if (n <= 0) {
+        return;
+    }
+    grain = std::max<int64_t>(grain, 1);
+    auto &pool = ThreadPool::instance();
+    auto chunks = (n + grain - 1) / grain;
+    auto threads = int(std::min<int64_t>(chunks, pool.threads()));
+    auto &owned = thread_steal_ranges();
+    // nested calls run inline on one thread anyway
+    if (owned.busy || threads <= 1) {
+        for (int64_t chunk = 0; chunk < chunks; ++chunk) {
+            call_range(f, chunk * grain, std::min(n, (chunk + 1) * grain), 0);
+        }
+        return;
+    }
+    // chunk indices are packed in 32 bits
+    ASSERT(chunks <= int64_t(UINT32_MAX));
+    // `run` uses fewer threads if the pool shrinks meanwhile, never more
+    if (owned.capacity < threads) {
+        owned.ranges.reset(new StealRange[threads]);
+        owned.capacity = threads;
+    }
+    struct Context {
+        int64_t n, grain, chunks;
+        F const &f;
+        StealRange *ranges;
+    } context{n, grain, chunks, f, owned.ranges.get()};
+    owned.busy = true;
+    pool.run([](void *context, int thread, int threads) {
+        auto const &c = *static_cast<Context *>(context);
+        auto &own = c.ranges[thread];
+        while (true) {
+            uint32_t chunk;
+            while (own.pop_front(chunk)) {
+                call_range(c.f, chunk * c.grain, std::min(c.n, (chunk + 1) * c.grain), thread);
+            }
+            uint32_t begin, end;
+            bool stolen = false;
+            for (int i = 1; i < threads && !stolen; ++i) {
+                stolen = c.ranges[(thread + i) % threads].steal(begin, end);
+            }
+            if (!stolen) {
+                return;
+            }
+            own.range.store(StealRange::pack(begin, end), std::memory_order_release);
+        }
+    },
+             &context, threads,
+             // split the chunks among the threads `run` actually uses
+             [](void *context, int threads) {
+                 auto const &c = *static_cast<Context *>(context);
+                 for (int i = 0; i < threads; ++i) {
+                     c.ranges[i].range.store(StealRange::pack(uint32_t(c.chunks * i / threads), uint32_t(c.chunks * (i + 1) / threads)), std::memory_order_relaxed);
+                 }
+             });
+    owned.busy = false;
+}
+
+#endif// __CPU_THREAD_POOL_H__
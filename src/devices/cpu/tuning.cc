@@ -0,0 +1,208 @@
+#include "tuning.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+static std::string cpu_model() {
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+        // x86 names the model, arm only its implementer and part
+        for (auto field : {"model name", "CPU part"}) {
+            if (line.compare(0, std::strlen(field), field) == 0) {
+                auto value = line.substr(line.find(':') + 1);
+                value.erase(0, value.find_first_not_of(" \t"));
+                return value;
+            }
+        }
+    }
+    return "unknown";
+}
+
+namespace {
+
+// Entries of this cpu model by key. A cache file holds one line per entry,
+// "model \t key \t values", after a line naming its version; lines of other
+// models are kept as they are, so hosts may share one file.
+struct TuningCache {
+    std::mutex mutex;
+    std::string model = cpu_model(), path;
+    std::map<std::string, std::vector<int>> entries;
+    std::vector<std::string> others;
+
+    TuningCache() {
+        if (auto env = std::getenv("INFINI_TUNING_CACHE")) {
+            path = env;
+        } else if (auto home = std::getenv("HOME")) {
+            path = std::string(home) + "/.cache/infini/tuning.txt";
+        }
+        if (!path.empty()) {
+            load(path);
+        }
+    }
+
+    int load(std::string const &file) {
+        std::ifstream in(file);
+        std::string line;
+        if (!in || !std::getline(in, line) || line != "infini-tuning " + std::to_string(TUNING_VERSION)) {
+            return -1;
+        }
+        entries.clear();
+        others.clear();
+        while (std::getline(in, line)) {
+            auto tab1 = line.find('\t'),
+                 tab2 = line.find('\t', tab1 + 1);
+            if (tab2 == std::string::npos) {
+                continue;
+            }
+            if (line.compare(0, tab1, model) != 0 || tab1 != model.size()) {
+                others.push_back(line);
+                continue;
+            }
+            std::istringstream values(line.substr(tab2 + 1));
+            std::vector<int> v;
+            for (int x; values >> x;) {
+                v.push_back(x);
+            }
+            entries[line.substr(tab1 + 1, tab2 - tab1 - 1)] = std::move(v);
+        }
+        return 0;
+    }
+
+    // Take in what other processes wrote to `file` since it was read, so
+    // that processes tuning at once keep each other's entries. Ours win for
+    // this model, the file for others, which only other hosts tune.
+    void merge(std::string const &file) {
+        auto ours = std::move(entries);
+        auto our_others = std::move(others);
+        entries.clear();
+        others.clear();
+        load(file);
+        for (auto &[key, values] : ours) {
+            entries[key] = std::move(values);
+        }
+        std::map<std::string, std::string> lines;
+        for (auto const *source : {&our_others, &others}) {
+            for (auto const &line : *source) {
+                lines[line.substr(0, line.find('\t', line.find('\t') + 1))] = line;
+            }
+        }
+        others.clear();
+        for (auto &[prefix, line] : lines) {
+            others.push_back(std::move(line));
+        }
+    }
+
+    int save(std::string const &file) {
+        std::error_code error;
+        auto parent = std::filesystem::path(file).parent_path();
+        if (!parent.empty()) {
+            std::filesystem::create_directories(parent, error);
+        }
+#ifndef _WIN32
+        // held from the merge to the rename, so that no process replaces
+        // the file between another one reading and replacing it
+        auto lock = open((file + ".lock").c_str(), O_RDWR | O_CREAT, 0644);
+        if (lock >= 0) {
+            flock(lock, LOCK_EX);
+        }
+#endif
+        merge(file);
+        auto result = write(file);
+#ifndef _WIN32
+        if (lock >= 0) {
+            flock(lock, LOCK_UN);
+            close(lock);
+        }
+#endif
+        return result;
+    }
+
+    int write(std::string const &file) const {
+        // write aside and rename, so a reader never sees half a file
+        auto temp = file + ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+        {
+            std::ofstream out(temp);
+            out << "infini-tuning " << TUNING_VERSION << '\n';
+            for (auto const &line : others) {
+                out << line << '\n';
+            }
+            for (auto const &[key, values] : entries) {
+                out << model << '\t' << key << '\t';
+                for (size_t i = 0; i < values.size(); ++i) {
+                    out << (i ? " " : "") << values[i];
+                }
+                out << '\n';
+            }
+            if (!out) {
+                std::remove(temp.c_str());
+                return -1;
+            }
+        }
+        return std::rename(temp.c_str(), file.c_str()) == 0 ? 0 : -1;
+    }
+};
+
+}// namespace
+
+static TuningCache &cache() {
+    static TuningCache cache;
+    return cache;
+}
+
+static std::atomic<bool> autotuning_ = [] {
+    auto env = std::getenv("INFINI_AUTOTUNE");
+    return env && std::strcmp(env, "0") != 0;
+}();
+
+bool autotuning() {
+    return autotuning_.load(std::memory_order_relaxed);
+}
+
+void set_autotuning(bool enabled) {
+    autotuning_.store(enabled);
+}
+
+std::optional<std::vector<int>> tuning_lookup(std::string const &key) {
+    auto &c = cache();
+    std::lock_guard<std::mutex> lock(c.mutex);
+    auto it = c.entries.find(key);
+    if (it == c.entries.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+void tuning_store(std::string const &key, std::vector<int> const &values) {
+    auto &c = cache();
+    std::lock_guard<std::mutex> lock(c.mutex);
+    c.entries[key] = values;
+    if (!c.path.empty()) {
+        c.save(c.path);
+    }
+}
+
+int tuning_load(std::string const &path) {
+    auto &c = cache();
+    std::lock_guard<std::mutex> lock(c.mutex);
+    c.path = path;
+    return c.load(path);
+}
+
+int tuning_save(std::string const &path) {
+    auto &c = cache();
+    std::lock_guard<std::mutex> lock(c.mutex);
+    return c.save(path);
+}
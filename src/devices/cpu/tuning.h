@@ -0,0 +1,72 @@
+#ifndef __CPU_TUNING_H__
+#define __CPU_TUNING_H__
+
+#include <algorithm>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Bumped whenever the values tuned for a key change meaning, so that
+// caches written before are dropped instead of misread.
+constexpr static int TUNING_VERSION = 1;
+
+// whether planning benchmarks the kernel configs of layouts not yet tuned
+bool autotuning();
+void set_autotuning(bool enabled);
+
+// the values tuned for `key` on this cpu model, if any
+std::optional<std::vector<int>> tuning_lookup(std::string const &key);
+
+// record values tuned for `key`, and rewrite the cache file if there is one,
+// merged under a file lock with what other processes wrote to it
+void tuning_store(std::string const &key, std::vector<int> const &values);
+
+// Read, or write, the cache file, entries of every cpu model included. A
+// load switches the file later results are written to. Return 0 on success.
+int tuning_load(std::string const &path);
+int tuning_save(std::string const &path);
+
+// seconds the fastest of `runs` calls of `f` takes, after one to warm up
+template<class F>
+double time_best(F const &f, int runs = 3) {
+    using clock = std::chrono::steady_clock;
+    f();
+    double best = 1e30;
+    for (int i = 0; i < runs; ++i) {
+        auto begin = clock::now();
+        f();
+        best = std::min(best, std::chrono::duration<double>(clock::now() - begin).count());
+    }
+    return best;
+}
+
+// Coordinate descent from `values`: each value in turn becomes the fastest
+// of its `choices` with the others kept, until a pass changes none of them.
+// `seconds(values)` times one configuration.
+template<class F>
+std::vector<int> tune(std::vector<int> values, std::vector<std::vector<int>> const &choices, F const &seconds) {
+    auto best = seconds(values);
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t i = 0; i < values.size(); ++i) {
+            for (auto choice : choices[i]) {
+                if (choice == values[i]) {
+                    continue;
+                }
+                auto candidate = values;
+                candidate[i] = choice;
+                auto time = seconds(candidate);
+                // a few percent better, so noise does not keep it going
+                if (time < best * 0.97) {
+                    best = time;
+                    values = candidate;
+                    changed = true;
+                }
+            }
+        }
+    }
+    return values;
+}
+
+#endif// __CPU_TUNING_H__
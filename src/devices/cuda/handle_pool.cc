@@ -1,4 +1,5 @@
 #include "handle_pool.h"
+#include <mutex>
 #include <vector>
 #include <cuda_runtime.h>
 
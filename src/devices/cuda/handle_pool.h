@@ -11,11 +11,14 @@ void use_cublas(cudaStream_t stream, T const &f) {
     auto &pool = get_cublas_pool();
     auto handle = pool.pop();
     if (!handle) {
-        cublasCreate(&(*handle));
+        cublasCreate(&handle.emplace());
     }
     cublasSetStream(*handle, (cudaStream_t) stream);
     f(*handle);
-    pool.push(std::move(*handle));
+    // more handles than the pool holds were in use at once
+    if (!pool.push(std::move(*handle))) {
+        cublasDestroy(*handle);
+    }
 }
 
 #endif // __CUDA_HANDLE_POOL_H__
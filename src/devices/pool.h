@@ -2,49 +2,99 @@
 #define __POOL_H__
 
 #include <atomic>
-#include <mutex>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <optional>
 
+// A lock-free pool holding at most `capacity` values. All of its nodes are
+// allocated up front, so `push` and `pop` never allocate. Nodes move between
+// a stack of free nodes and a stack of used ones; each stack head packs a
+// node index with a counter bumped on every change, which keeps a pop that
+// raced with a pop and push of the same node from succeeding (ABA).
 template<class T>
 class Pool {
 public:
-    Pool() : _head(nullptr) {}
+    explicit Pool(size_t capacity = 64)
+        : _nodes(new Node[capacity]), _capacity(capacity), _used(pack(NIL, 0)), _free(pack(NIL, 0)) {
+        for (size_t i = 0; i < capacity; ++i) {
+            _nodes[i].next.store(i + 1 < capacity ? uint32_t(i + 1) : NIL, std::memory_order_relaxed);
+        }
+        _free.store(pack(capacity ? 0 : NIL, 0), std::memory_order_relaxed);
+    }
 
     Pool(const Pool &) = delete;
 
-    Pool(Pool &&pool) noexcept : _head(pool._head.exchange(nullptr)) {}
+    Pool(Pool &&pool) noexcept
+        : _nodes(std::move(pool._nodes)), _capacity(pool._capacity),
+          _used(pool._used.exchange(pack(NIL, 0))), _free(pool._free.exchange(pack(NIL, 0))) {
+        pool._capacity = 0;
+    }
 
     ~Pool() {
         while (this->pop()) {}
     }
 
-    void push(T &&val) const {
-        Node<T> *new_node = new Node<T>(std::move(val));
-        new_node->next = _head.load();
-        while (!_head.compare_exchange_weak(new_node->next, new_node));
+    size_t capacity() const { return _capacity; }
+
+    // Returns false, leaving `val` with the caller, when the pool is full.
+    bool push(T &&val) const {
+        auto i = take(_free);
+        if (i == NIL) {
+            return false;
+        }
+        _nodes[i].data.emplace(std::move(val));
+        give(_used, i);
+        return true;
     }
 
     std::optional<T> pop() const {
-        Node<T> *top = _head.load();
-        Node<T> *new_head = nullptr;
-        do {
-            if (!top) {
-                return std::nullopt;
-            }
-            new_head = top->next;
-        } while (!_head.compare_exchange_weak(top, new_head));
-        return {std::move(top->data)};
+        auto i = take(_used);
+        if (i == NIL) {
+            return std::nullopt;
+        }
+        std::optional<T> val(std::move(_nodes[i].data));
+        _nodes[i].data.reset();
+        give(_free, i);
+        return val;
     }
 
 private:
-    template<class U>
+    constexpr static uint32_t NIL = UINT32_MAX;
+
     struct Node {
-        U data;
-        Node<U> *next;
-        Node(U &&data) : data(data), next(nullptr) {}
+        std::optional<T> data;
+        std::atomic<uint32_t> next;
     };
 
-    mutable std::atomic<Node<T> *> _head;
+    // index in the low half, change counter in the high half
+    static uint64_t pack(uint32_t index, uint64_t tag) { return tag << 32 | index; }
+    static uint32_t index(uint64_t head) { return uint32_t(head); }
+    static uint64_t tag(uint64_t head) { return head >> 32; }
+
+    uint32_t take(std::atomic<uint64_t> &stack) const {
+        auto head = stack.load(std::memory_order_acquire);
+        while (index(head) != NIL) {
+            // may read a node already taken by another thread, in which case
+            // the tag has moved on and the exchange fails
+            auto next = _nodes[index(head)].next.load(std::memory_order_relaxed);
+            if (stack.compare_exchange_weak(head, pack(next, tag(head) + 1), std::memory_order_acquire, std::memory_order_acquire)) {
+                break;
+            }
+        }
+        return index(head);
+    }
+
+    void give(std::atomic<uint64_t> &stack, uint32_t i) const {
+        auto head = stack.load(std::memory_order_relaxed);
+        do {
+            _nodes[i].next.store(index(head), std::memory_order_relaxed);
+        } while (!stack.compare_exchange_weak(head, pack(i, tag(head) + 1), std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    std::unique_ptr<Node[]> _nodes;
+    size_t _capacity;
+    mutable std::atomic<uint64_t> _used, _free;
 };
 
 #endif // __POOL_H__
@@ -7,7 +7,7 @@ void test_rms_norm() {
     struct TensorLayout l;
     Tensor t = {&l, NULL};
     Tensor t2 = {&l, NULL};
-    rotaryEmbedding(descriptor, t, t2, 10000.0, NULL);
+    rotaryEmbedding(descriptor, NULL, 0, t, t2, 10000.0, NULL);
     destroyRotaryEmbeddingDescriptor(descriptor);
 }
 
@@ -0,0 +1,104 @@
+#include "activation_cpu.h"
+#include "../../../devices/cpu/stream.h"
+#include "../../utils.h"
+#include <cmath>
+
+struct Silu {
+    float operator()(float x) const {
+        return x / (1.0f + std::exp(-x));
+    }
+};
+
+struct GeluTanh {
+    float operator()(float x) const {
+        constexpr float k0 = 0.7978845608028654f,// sqrt(2 / pi)
+            k1 = 0.044715f;
+        return 0.5f * x * (1.0f + std::tanh(k0 * (x + k1 * x * x * x)));
+    }
+};
+
+struct GeluErf {
+    float operator()(float x) const {
+        constexpr float k = 0.7071067811865476f;// 1 / sqrt(2)
+        return 0.5f * x * (1.0f + std::erf(x * k));
+    }
+};
+
+struct Relu {
+    float operator()(float x) const {
+        return x > 0.0f ? x : 0.0f;
+    }
+};
+
+template<class Act>
+struct Gated {
+    Act act;
+    float operator()(float gate, float up) const {
+        return act(gate) * up;
+    }
+};
+
+// instantiate `f` with the functor selected by `type`
+template<class F>
+void with_activation(ActivationType type, F &&f) {
+    switch (type) {
+        case ActSilu:
+            f(Silu{});
+            break;
+        case ActGeluTanh:
+            f(GeluTanh{});
+            break;
+        case ActGeluErf:
+            f(GeluErf{});
+            break;
+        case ActRelu:
+            f(Relu{});
+            break;
+        default:
+            PANIC(UnsupportedActivationType);
+    }
+}
+
+template<class T, class Act>
+static void unary(ElementwisePlan const &plan, void *y, void const *x) {
+    elementwise_map<T>(plan, y, x, Act{});
+}
+
+template<class T, class Act>
+static void gated(ElementwisePlan const &plan, void *y, void const *x) {
+    elementwise_update<T>(plan, y, x, Gated<Act>{});
+}
+
+ActivationCpuPlan plan_activation_cpu(ActivationType type, TensorLayout const *y, TensorLayout const *x) {
+    ActivationCpuPlan plan;
+    plan.elementwise = plan_elementwise(y, x);
+    dispatch_float(y->dt, [&](auto t) {
+        with_activation(type, [&](auto act) {
+            using T = decltype(t);
+            using Act = decltype(act);
+            plan.unary = unary<T, Act>;
+            plan.gated = gated<T, Act>;
+        });
+    });
+    return plan;
+}
+
+ActivationCpuDescriptor *create_activation_cpu_descriptor(Device device, ActivationType type, ActivationConfig const *config) {
+    auto descriptor = new ActivationCpuDescriptor{device, type};
+    if (config) {
+        descriptor->plan = plan_activation_cpu(type, config->y, config->x);
+    }
+    return descriptor;
+}
+
+void activation_cpu(ActivationCpuDescriptor const *descriptor, Tensor y, Tensor x, void *stream) {
+    launch(
+        descriptor->plan, [&] { return plan_activation_cpu(descriptor->type, y.layout, x.layout); }, stream, {y.data, x.data},
+        [](ActivationCpuPlan const &plan, void *const *data) { plan.unary(plan.elementwise, data[0], data[1]); });
+}
+
+void gated_activation_cpu(ActivationCpuDescriptor const *descriptor, Tensor gate, Tensor up, void *stream) {
+    launch(
+        descriptor->plan, [&] { return plan_activation_cpu(descriptor->type, gate.layout, up.layout); }, stream, {gate.data, up.data},
+        [](ActivationCpuPlan const &plan, void *const *data) { plan.gated(plan.elementwise, data[0], data[1]); });
+}
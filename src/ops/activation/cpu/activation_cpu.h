@@ -0,0 +1,33 @@
+#ifndef __CPU_ACTIVATION_H__
+#define __CPU_ACTIVATION_H__
+
+#include "../../../devices/cpu/elementwise.h"
+#include "operators.h"
+#include "ops/activation/activation.h"
+#include <optional>
+
+typedef void (*ActivationCpuKernel)(ElementwisePlan const &plan, void *y, void const *x);
+
+struct ActivationCpuPlan {
+    ElementwisePlan elementwise;
+    // y = act(x)
+    ActivationCpuKernel unary;
+    // y = act(y) * x
+    ActivationCpuKernel gated;
+};
+
+struct ActivationCpuDescriptor {
+    Device device;
+    ActivationType type;
+    std::optional<ActivationCpuPlan> plan;
+};
+
+ActivationCpuPlan plan_activation_cpu(ActivationType type, TensorLayout const *y, TensorLayout const *x);
+
+ActivationCpuDescriptor *create_activation_cpu_descriptor(Device device, ActivationType type, ActivationConfig const *config);
+
+void activation_cpu(ActivationCpuDescriptor const *descriptor, Tensor y, Tensor x, void *stream);
+
+void gated_activation_cpu(ActivationCpuDescriptor const *descriptor, Tensor gate, Tensor up, void *stream);
+
+#endif// __CPU_ACTIVATION_H__
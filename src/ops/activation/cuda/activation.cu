@@ -0,0 +1,122 @@
+#include "../../utils.h"
+#include "activation.cuh"
+#include <cuda_fp16.h>
+
+struct Silu {
+    __forceinline__ __device__ float operator()(float x) const {
+        return fdividef(x, 1 + expf(-x));
+    }
+};
+
+struct GeluTanh {
+    __forceinline__ __device__ float operator()(float x) const {
+        return 0.5f * x * (1 + tanhf(0.7978845608028654f * (x + 0.044715f * x * x * x)));
+    }
+};
+
+struct GeluErf {
+    __forceinline__ __device__ float operator()(float x) const {
+        return 0.5f * x * (1 + erff(x * 0.7071067811865476f));
+    }
+};
+
+struct Relu {
+    __forceinline__ __device__ float operator()(float x) const {
+        return fmaxf(x, 0);
+    }
+};
+
+template<class Tdata, class Act>
+static __global__ void unary(
+    Tdata *__restrict__ y_,
+    int const stride_y,
+    Tdata const *__restrict__ x_,
+    int const stride_x,
+    unsigned int const cols,
+    Act act) {
+    auto j = blockIdx.x * blockDim.x + threadIdx.x;
+    if (j >= cols) { return; }
+    auto x = float(x_[blockIdx.y * stride_x + j]);
+    y_[blockIdx.y * stride_y + j] = Tdata(act(x));
+}
+
+template<class Tdata, class Act>
+static __global__ void gated(
+    Tdata *__restrict__ gate_,
+    int const stride_gate,
+    Tdata const *__restrict__ up_,
+    int const stride_up,
+    unsigned int const cols,
+    Act act) {
+    auto j = blockIdx.x * blockDim.x + threadIdx.x;
+    if (j >= cols) { return; }
+    auto &gate = gate_[blockIdx.y * stride_gate + j];
+    auto x = float(gate),
+         y = float(up_[blockIdx.y * stride_up + j]);
+    gate = Tdata(act(x) * y);
+}
+
+constexpr static int BLOCK_SIZE = 256;
+
+template<class F>
+static void with_activation(ActivationType type, F &&f) {
+    switch (type) {
+        case ActSilu:
+            f(Silu{});
+            break;
+        case ActGeluTanh:
+            f(GeluTanh{});
+            break;
+        case ActGeluErf:
+            f(GeluErf{});
+            break;
+        case ActRelu:
+            f(Relu{});
+            break;
+        default:
+            PANIC(UnsupportedActivationType);
+    }
+}
+
+static void check_operands(Tensor a, Tensor b) {
+    ASSERT_EQ(a.layout->ndim, 2);
+    ASSERT_EQ(b.layout->ndim, 2);
+    ASSERT_EQ(a.layout->shape[0], b.layout->shape[0]);
+    ASSERT_EQ(a.layout->shape[1], b.layout->shape[1]);
+    ASSERT_EQ(a.layout->strides[1], 2);
+    ASSERT_EQ(b.layout->strides[1], 2);
+}
+
+void activation_nv_gpu_f16(ActivationType type, Tensor y, Tensor x, void *stream) {
+    check_operands(y, x);
+
+    auto rows = y.layout->shape[0],
+         cols = y.layout->shape[1];
+    auto grid_dims = dim3(ROUND_UP_DIV(cols, BLOCK_SIZE), rows);
+
+    auto y_ptr = reinterpret_cast<half *>(y.data);
+    auto x_ptr = reinterpret_cast<half const *>(x.data);
+    auto cuda_stream = reinterpret_cast<cudaStream_t>(stream);
+
+    with_activation(type, [&](auto act) {
+        unary<<<grid_dims, BLOCK_SIZE, 0, cuda_stream>>>(
+            y_ptr, y.layout->strides[0] / 2, x_ptr, x.layout->strides[0] / 2, cols, act);
+    });
+}
+
+void gated_activation_nv_gpu_f16(ActivationType type, Tensor gate, Tensor up, void *stream) {
+    check_operands(gate, up);
+
+    auto rows = gate.layout->shape[0],
+         cols = gate.layout->shape[1];
+    auto grid_dims = dim3(ROUND_UP_DIV(cols, BLOCK_SIZE), rows);
+
+    auto gate_ptr = reinterpret_cast<half *>(gate.data);
+    auto up_ptr = reinterpret_cast<half const *>(up.data);
+    auto cuda_stream = reinterpret_cast<cudaStream_t>(stream);
+
+    with_activation(type, [&](auto act) {
+        gated<<<grid_dims, BLOCK_SIZE, 0, cuda_stream>>>(
+            gate_ptr, gate.layout->strides[0] / 2, up_ptr, up.layout->strides[0] / 2, cols, act);
+    });
+}
@@ -0,0 +1,16 @@
+#ifndef __NV_GPU_ACTIVATION_H__
+#define __NV_GPU_ACTIVATION_H__
+
+#include "operators.h"
+#include "ops/activation/activation.h"
+
+struct ActivationCudaDescriptor {
+    Device device;
+    ActivationType type;
+};
+
+void activation_nv_gpu_f16(ActivationType type, Tensor y, Tensor x, void *stream);
+
+void gated_activation_nv_gpu_f16(ActivationType type, Tensor gate, Tensor up, void *stream);
+
+#endif// __NV_GPU_ACTIVATION_H__
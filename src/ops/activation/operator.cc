@@ -0,0 +1,92 @@
+#include "../profile.h"
+#include "../utils.h"
+#include "ops/activation/activation.h"
+
+#ifdef ENABLE_CPU
+#include "cpu/activation_cpu.h"
+#endif
+#ifdef ENABLE_NV_GPU
+#include "cuda/activation.cuh"
+#endif
+
+struct ActivationDescriptor {
+    Device device;
+    ActivationType type;
+};
+
+__C void *createActivationDescriptor(Device device, ActivationType type, void *config) {
+    switch (device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            return (ActivationDescriptor *) create_activation_cpu_descriptor(device, type, (ActivationConfig const *) config);
+#endif
+#ifdef ENABLE_NV_GPU
+        case DevNvGpu:
+            return (ActivationDescriptor *) (new ActivationCudaDescriptor{device, type});
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+    return nullptr;
+}
+
+__C void destroyActivationDescriptor(ActivationDescriptor *descriptor) {
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            delete (ActivationCpuDescriptor *) (descriptor);
+            break;
+#endif
+#ifdef ENABLE_NV_GPU
+        case DevNvGpu:
+            delete (ActivationCudaDescriptor *) (descriptor);
+            break;
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+}
+
+__C void getActivationWorkspaceSize(ActivationDescriptor *descriptor, uint64_t *size) {
+    *size = 0;
+}
+
+__C void activation(ActivationDescriptor *descriptor, void *workspace, uint64_t workspace_size, Tensor y, Tensor x, void *stream) {
+    ProfileScope profile("activation", [&] {
+        return OpCost{shape_bucket(y.layout), tensor_bytes(y.layout) + tensor_bytes(x.layout), 8 * tensor_elements(y.layout)};
+    });
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            activation_cpu((ActivationCpuDescriptor *) descriptor, y, x, stream);
+            break;
+#endif
+#ifdef ENABLE_NV_GPU
+        case DevNvGpu:
+            activation_nv_gpu_f16(descriptor->type, y, x, stream);
+            break;
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+}
+
+__C void gatedActivation(ActivationDescriptor *descriptor, void *workspace, uint64_t workspace_size, Tensor gate, Tensor up, void *stream) {
+    ProfileScope profile("gated_activation", [&] {
+        return OpCost{shape_bucket(gate.layout), 2 * tensor_bytes(gate.layout) + tensor_bytes(up.layout), 9 * tensor_elements(gate.layout)};
+    });
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            gated_activation_cpu((ActivationCpuDescriptor *) descriptor, gate, up, stream);
+            break;
+#endif
+#ifdef ENABLE_NV_GPU
+        case DevNvGpu:
+            gated_activation_nv_gpu_f16(descriptor->type, gate, up, stream);
+            break;
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+}
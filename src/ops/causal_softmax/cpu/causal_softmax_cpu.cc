@@ -1,43 +1,130 @@
 #include "causal_softmax_cpu.h"
 #include "../../../devices/cpu/common_cpu.h"
+#include "../../../devices/cpu/stream.h"
+#include "../../../devices/cpu/thread_pool.h"
 #include "../../utils.h"
 #include <algorithm>
 
-void causal_softmax_cpu_f16(Tensor y) {
-    uint64_t ndim = y.layout->ndim;
-    ASSERT(ndim == 2 || ndim == 3);
-    uint64_t total_seq_len = y.layout->shape[ndim - 1];
-    uint64_t seq_len = y.layout->shape[ndim - 2];
-    uint64_t batch_size = 1;
-    uint64_t stride_j = y.layout->strides[ndim - 1] / 2;
-    uint64_t stride_i = y.layout->strides[ndim - 2] / 2;
-    uint64_t stride_b = 0;
-    if (ndim == 3)
-        stride_b = y.layout->strides[ndim - 3] / 2;
-    for (size_t i = 0; i < ndim - 2; i++) {
-        batch_size *= y.layout->shape[i];
-    }
-    auto y_ptr = reinterpret_cast<uint16_t *>(y.data);
-    for (size_t b = 0; b < batch_size; b++) {
-        for (size_t i = 0; i < seq_len; i++) {
-            uint64_t offset = b * stride_b + i * stride_i;
-            float max_val = f16_to_f32(y_ptr[offset]);
-            for (size_t j = 1; j < total_seq_len; j++) {
-                if (j <= total_seq_len - seq_len + i) {
-                    max_val = std::max(max_val, f16_to_f32(y_ptr[offset + j * stride_j]));
-                } else {
-                    y_ptr[offset + j * stride_j] = 0;
-                }
-            }
-            float sum = 0.;
-            for (size_t j = 0; j <= total_seq_len - seq_len + i; j++) {
-                float new_val = std::exp(f16_to_f32(y_ptr[offset + j * stride_j]) - max_val);
-                sum += new_val;
-            }
-            for (size_t j = 0; j <= total_seq_len - seq_len + i; j++) {
-                float new_val = std::exp(f16_to_f32(y_ptr[offset + j * stride_j]) - max_val) / sum;
-                y_ptr[offset + j * stride_j] = f32_to_f16(new_val);
+// The softmax of the first `valid` of the `columns` elements of a row, the
+// others zeroed. It is evaluated in f32 whatever the storage type, so long
+// rows do not overflow the intermediate sum even when stored as f16. `exp_`
+// keeps the exponentials of the row, so each is computed once.
+template<class T>
+static void softmax_row(T *y_, uint64_t valid, uint64_t columns, int64_t stride_j, float *exp_) {
+    for (size_t j = valid; j < columns; j++) {
+        y_[j * stride_j] = from_f32<T>(0);
+    }
+    if (valid == 0) {
+        return;
+    }
+    float max_val = to_f32(y_[0]);
+    for (size_t j = 1; j < valid; j++) {
+        max_val = std::max(max_val, to_f32(y_[j * stride_j]));
+    }
+    float sum = 0.;
+    for (size_t j = 0; j < valid; j++) {
+        exp_[j] = std::exp(to_f32(y_[j * stride_j]) - max_val);
+        sum += exp_[j];
+    }
+    for (size_t j = 0; j < valid; j++) {
+        y_[j * stride_j] = from_f32<T>(exp_[j] / sum);
+    }
+}
+
+// every thread keeps the exponentials of its row in its slice of the
+// workspace, which starts with the offsets of packed sequences
+template<class T>
+static void causal_softmax(CausalSoftmaxCpuPlan const &plan, void *y, void const *cu_seqlens_q, void const *cu_seqlens_k,
+                           Workspace const &workspace) {
+    auto seq_len = plan.seq_len,
+         total_seq_len = plan.total_seq_len;
+    auto y_ptr = reinterpret_cast<T *>(y);
+    auto base = static_cast<char *>(workspace.get(plan.seq_bytes + plan.row_bytes * ThreadPool::instance().threads()));
+    auto scratch = base + plan.seq_bytes;
+    // the first row of every packed sequence, and how many keys it has before its first query
+    auto sequences = plan.cu_seqlens_q.sequences;
+    int64_t *q_offsets = nullptr, *past = nullptr;
+    if (plan.varlen) {
+        auto offsets_bytes = seq_offsets_bytes(plan.cu_seqlens_q);
+        q_offsets = reinterpret_cast<int64_t *>(base);
+        past = reinterpret_cast<int64_t *>(base + offsets_bytes);
+        read_seq_offsets(plan.cu_seqlens_q, cu_seqlens_q, q_offsets, seq_len);
+        auto k_offsets = q_offsets;
+        if (plan.varlen_k) {
+            k_offsets = reinterpret_cast<int64_t *>(base + 2 * offsets_bytes);
+            read_seq_offsets(plan.cu_seqlens_k, cu_seqlens_k, k_offsets);
+        }
+        for (uint64_t s = 0; s < sequences; ++s) {
+            auto keys = k_offsets[s + 1] - k_offsets[s];
+            past[s] = keys - (q_offsets[s + 1] - q_offsets[s]);
+            ASSERT(past[s] >= 0 && uint64_t(keys) <= total_seq_len);
+        }
+    }
+
+    // rows get longer towards the end of every batch, so idle threads steal
+    parallel_for_dynamic(plan.batch_size * seq_len, 1, [&](int64_t begin, int64_t end, int thread) {
+        auto exp_ = reinterpret_cast<float *>(scratch + thread * plan.row_bytes);
+        for (auto row = begin; row < end; ++row) {
+            auto b = row / seq_len,
+                 i = row % seq_len;
+            // the last token attends to every position, each earlier token to one less
+            auto valid = total_seq_len - seq_len + i + 1;
+            if (plan.varlen) {
+                auto s = sequence_of(q_offsets, sequences, i);
+                valid = past[s] + (i - q_offsets[s]) + 1;
             }
+            softmax_row(y_ptr + b * plan.stride_b + i * plan.stride_i, valid, total_seq_len, plan.stride_j, exp_);
         }
+    });
+}
+
+CausalSoftmaxCpuPlan plan_causal_softmax_cpu(TensorLayout const *y, TensorLayout const *cu_seqlens_q, TensorLayout const *cu_seqlens_k) {
+    uint64_t ndim = y->ndim;
+    ASSERT(ndim == 2 || ndim == 3);
+
+    CausalSoftmaxCpuPlan plan{};
+    plan.batch_size = ndim == 3 ? y->shape[0] : 1;
+    plan.seq_len = y->shape[ndim - 2];
+    plan.total_seq_len = y->shape[ndim - 1];
+    plan.varlen = cu_seqlens_q != nullptr;
+    plan.varlen_k = cu_seqlens_k != nullptr;
+    if (plan.varlen) {
+        plan.cu_seqlens_q = plan_seq_offsets(cu_seqlens_q);
+        if (plan.varlen_k) {
+            plan.cu_seqlens_k = plan_seq_offsets(cu_seqlens_k);
+            ASSERT_EQ(plan.cu_seqlens_k.sequences, plan.cu_seqlens_q.sequences);
+        }
+    } else {
+        ASSERT(!plan.varlen_k);
+        ASSERT(plan.total_seq_len >= plan.seq_len);
     }
+    plan.stride_b = ndim == 3 ? y->strides[0] / y->dt.size : 0;
+    plan.stride_i = y->strides[ndim - 2] / y->dt.size;
+    plan.stride_j = y->strides[ndim - 1] / y->dt.size;
+    plan.row_bytes = align_workspace(plan.total_seq_len * sizeof(float));
+    plan.seq_bytes = plan.varlen ? (plan.varlen_k ? 3 : 2) * seq_offsets_bytes(plan.cu_seqlens_q) : 0;
+    dispatch_float(y->dt, [&](auto t) {
+        plan.kernel = causal_softmax<decltype(t)>;
+    });
+    return plan;
+}
+
+CausalSoftmaxCpuDescriptor *create_causal_softmax_cpu_descriptor(Device device, CausalSoftmaxConfig const *config) {
+    auto descriptor = new CausalSoftmaxCpuDescriptor{device};
+    if (config) {
+        descriptor->plan = plan_causal_softmax_cpu(config->y, config->cu_seqlens_q, config->cu_seqlens_k);
+    }
+    return descriptor;
+}
+
+uint64_t get_causal_softmax_cpu_workspace_size(CausalSoftmaxCpuDescriptor const *descriptor) {
+    return descriptor->plan ? descriptor->plan->seq_bytes + descriptor->plan->row_bytes * ThreadPool::instance().threads() : 0;
+}
+
+void causal_softmax_cpu(CausalSoftmaxCpuDescriptor const *descriptor, void *workspace, uint64_t workspace_size, Tensor y,
+                        Tensor cu_seqlens_q, Tensor cu_seqlens_k, void *stream) {
+    launch(
+        descriptor->plan, [&] { return plan_causal_softmax_cpu(y.layout, cu_seqlens_q.layout, cu_seqlens_k.layout); }, stream,
+        Workspace{workspace, workspace_size}, {y.data, cu_seqlens_q.data, cu_seqlens_k.data},
+        [](CausalSoftmaxCpuPlan const &plan, void *const *data, Workspace const &workspace) { plan.kernel(plan, data[0], data[1], data[2], workspace); });
 }
@@ -1,11 +1,41 @@
 #ifndef __CPU_CAUSAL_SOFTMAX_H__
 #define __CPU_CAUSAL_SOFTMAX_H__
 
+#include "../../../devices/cpu/arena.h"
+#include "../../../devices/cpu/seqlens.h"
 #include "operators.h"
+#include "ops/causal_softmax/causal_softmax.h"
+#include <optional>
+
+struct CausalSoftmaxCpuPlan;
+typedef void (*CausalSoftmaxCpuKernel)(CausalSoftmaxCpuPlan const &plan, void *y, void const *cu_seqlens_q, void const *cu_seqlens_k,
+                                       Workspace const &workspace);
+
+struct CausalSoftmaxCpuPlan {
+    uint64_t batch_size, seq_len, total_seq_len;
+    // strides in elements
+    int64_t stride_b, stride_i, stride_j;
+    // whether the rows are of packed sequences, and whether these have keys of their own count
+    bool varlen, varlen_k;
+    SeqOffsetsCpuLayout cu_seqlens_q, cu_seqlens_k;
+    // workspace of each thread, a row in f32, after that of the offsets of
+    // packed sequences and of the keys before their first queries
+    size_t row_bytes, seq_bytes;
+    CausalSoftmaxCpuKernel kernel;
+};
+
 typedef struct CausalSoftmaxCpuDescriptor {
     Device device;
+    std::optional<CausalSoftmaxCpuPlan> plan;
 } CausalSoftmaxCpuDescriptor;
 
-void causal_softmax_cpu_f16(Tensor);
+CausalSoftmaxCpuPlan plan_causal_softmax_cpu(TensorLayout const *y, TensorLayout const *cu_seqlens_q, TensorLayout const *cu_seqlens_k);
+
+CausalSoftmaxCpuDescriptor *create_causal_softmax_cpu_descriptor(Device device, CausalSoftmaxConfig const *config);
+
+uint64_t get_causal_softmax_cpu_workspace_size(CausalSoftmaxCpuDescriptor const *descriptor);
+
+void causal_softmax_cpu(CausalSoftmaxCpuDescriptor const *descriptor, void *workspace, uint64_t workspace_size, Tensor y,
+                        Tensor cu_seqlens_q, Tensor cu_seqlens_k, void *stream);
 
 #endif
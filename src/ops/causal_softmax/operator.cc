@@ -1,3 +1,4 @@
+#include "../profile.h"
 #include "../utils.h"
 #include "ops/causal_softmax/causal_softmax.h"
 
@@ -21,7 +22,7 @@ __C CausalSoftmaxDescriptor *createCausalSoftmaxDescriptor(Device device, void *
     switch (device) {
 #ifdef ENABLE_CPU
         case DevCpu:
-            return (CausalSoftmaxDescriptor *) (new CausalSoftmaxCpuDescriptor{device});
+            return (CausalSoftmaxDescriptor *) create_causal_softmax_cpu_descriptor(device, (CausalSoftmaxConfig const *) config);
 #endif
 #ifdef ENABLE_NV_GPU
         case DevNvGpu: {
@@ -63,11 +64,26 @@ __C void destroyCausalSoftmaxDescriptor(CausalSoftmaxDescriptor *descriptor) {
     }
 }
 
-__C void causalSoftmax(CausalSoftmaxDescriptor *descriptor, Tensor y, void *stream) {
+__C void getCausalSoftmaxWorkspaceSize(CausalSoftmaxDescriptor *descriptor, uint64_t *size) {
     switch (descriptor->device) {
 #ifdef ENABLE_CPU
         case DevCpu:
-            causal_softmax_cpu_f16(y);
+            *size = get_causal_softmax_cpu_workspace_size((CausalSoftmaxCpuDescriptor *) descriptor);
+            break;
+#endif
+        default:
+            *size = 0;
+    }
+}
+
+__C void causalSoftmax(CausalSoftmaxDescriptor *descriptor, void *workspace, uint64_t workspace_size, Tensor y, void *stream) {
+    ProfileScope profile("causal_softmax", [&] {
+        return OpCost{shape_bucket(y.layout), 2 * tensor_bytes(y.layout), 4 * tensor_elements(y.layout)};
+    });
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            causal_softmax_cpu((CausalSoftmaxCpuDescriptor *) descriptor, workspace, workspace_size, y, Tensor{nullptr, nullptr}, Tensor{nullptr, nullptr}, stream);
             break;
 #endif
 #ifdef ENABLE_NV_GPU
@@ -85,3 +101,19 @@ __C void causalSoftmax(CausalSoftmaxDescriptor *descriptor, Tensor y, void *stre
             PANIC(UnsupportedDevice);
     }
 }
+
+__C void causalSoftmaxVarlen(CausalSoftmaxDescriptor *descriptor, void *workspace, uint64_t workspace_size, Tensor y,
+                             Tensor cu_seqlens_q, Tensor cu_seqlens_k, void *stream) {
+    ProfileScope profile("causal_softmax_varlen", [&] {
+        return OpCost{shape_bucket(y.layout), 2 * tensor_bytes(y.layout), 4 * tensor_elements(y.layout)};
+    });
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            causal_softmax_cpu((CausalSoftmaxCpuDescriptor *) descriptor, workspace, workspace_size, y, cu_seqlens_q, cu_seqlens_k, stream);
+            break;
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+}
@@ -0,0 +1,106 @@
+#include "embedding_cpu.h"
+#include "../../../devices/cpu/common_cpu.h"
+#include "../../../devices/cpu/stream.h"
+#include "../../../devices/cpu/thread_pool.h"
+#include "../../utils.h"
+#include <algorithm>
+
+// fewest elements of a row one worker takes when rows are split up
+constexpr static uint64_t EMBEDDING_MIN_CHUNK = 1024;
+
+static uint64_t row_of(EmbeddingCpuPlan const &plan, void const *indices, uint64_t i) {
+    auto index = reinterpret_cast<char const *>(indices) + i * plan.index_stride;
+    auto row = plan.index_size == 8 ? *reinterpret_cast<int64_t const *>(index)
+                                    : int64_t(*reinterpret_cast<int32_t const *>(index));
+    ASSERT(row >= 0 && uint64_t(row) < plan.vocab);
+    return uint64_t(row);
+}
+
+// Calls `f(y_row, table_row, row, begin, end)` for the columns [begin, end)
+// of every output row, rows split into chunks only when there are fewer of
+// them than threads.
+template<class F>
+static void for_each_chunk(EmbeddingCpuPlan const &plan, void *y, void const *table, void const *indices, F const &f) {
+    if (plan.n == 0) {
+        return;
+    }
+    auto threads = uint64_t(ThreadPool::instance().threads());
+    auto chunks = std::clamp<uint64_t>(ROUND_UP_DIV(threads, plan.n), 1, std::max<uint64_t>(plan.hidden / EMBEDDING_MIN_CHUNK, 1));
+    auto chunk = ROUND_UP_DIV(plan.hidden, chunks);
+    parallel_for(plan.n * chunks, [&](int64_t items_begin, int64_t items_end) {
+        for (auto item = uint64_t(items_begin); item < uint64_t(items_end); ++item) {
+            auto i = item / chunks,
+                 begin = item % chunks * chunk,
+                 end = std::min(begin + chunk, plan.hidden);
+            auto row = row_of(plan, indices, i);
+            f(reinterpret_cast<char *>(y) + i * plan.y_stride,
+              reinterpret_cast<char const *>(table) + row * plan.table_stride,
+              row, begin, end);
+        }
+    });
+}
+
+static void gather(EmbeddingCpuPlan const &plan, void *y, void const *table, void const *indices, void const *) {
+    auto size = plan.element_size;
+    for_each_chunk(plan, y, table, indices, [size](char *y_row, char const *table_row, uint64_t, uint64_t begin, uint64_t end) {
+        std::memcpy(y_row + begin * size, table_row + begin * size, (end - begin) * size);
+    });
+}
+
+template<class T, class S>
+static void gather_dequantize(EmbeddingCpuPlan const &plan, void *y, void const *table, void const *indices, void const *scales) {
+    for_each_chunk(plan, y, table, indices, [&](char *y_row, char const *table_row, uint64_t row, uint64_t begin, uint64_t end) {
+        auto scale = to_f32(*reinterpret_cast<S const *>(reinterpret_cast<char const *>(scales) + row * plan.scale_stride));
+        auto y_ = reinterpret_cast<T *>(y_row);
+        auto q = reinterpret_cast<int8_t const *>(table_row);
+        for (auto k = begin; k < end; ++k) {
+            y_[k] = from_f32<T>(float(q[k]) * scale);
+        }
+    });
+}
+
+EmbeddingCpuPlan plan_embedding_cpu(TensorLayout const *y, TensorLayout const *table, TensorLayout const *indices, TensorLayout const *scales) {
+    ASSERT_EQ(y->ndim, 2);
+    ASSERT_EQ(table->ndim, 2);
+    ASSERT_EQ(indices->ndim, 1);
+    ASSERT_EQ(indices->shape[0], y->shape[0]);
+    ASSERT_EQ(table->shape[1], y->shape[1]);
+    ASSERT_EQ(y->strides[1], y->dt.size);
+    ASSERT_EQ(table->strides[1], table->dt.size);
+    ASSERT(dtype_eq(indices->dt, I32) || dtype_eq(indices->dt, I64));
+
+    EmbeddingCpuPlan plan{y->shape[0], y->shape[1], table->shape[0],
+                          y->strides[0], table->strides[0], indices->strides[0], 0,
+                          indices->dt.size, y->dt.size};
+    if (dtype_eq(table->dt, I8)) {
+        ASSERT(scales != nullptr);
+        ASSERT_EQ(scales->ndim, 1);
+        ASSERT_EQ(scales->shape[0], table->shape[0]);
+        plan.scale_stride = scales->strides[0];
+        dispatch_float(y->dt, [&](auto t) {
+            dispatch_float(scales->dt, [&](auto s) {
+                plan.kernel = gather_dequantize<decltype(t), decltype(s)>;
+            });
+        });
+    } else {
+        ASSERT(dtype_eq(table->dt, y->dt));
+        dispatch_float(y->dt, [](auto) {});
+        plan.kernel = gather;
+    }
+    return plan;
+}
+
+EmbeddingCpuDescriptor *create_embedding_cpu_descriptor(Device device, EmbeddingConfig const *config) {
+    auto descriptor = new EmbeddingCpuDescriptor{device};
+    if (config) {
+        descriptor->plan = plan_embedding_cpu(config->y, config->table, config->indices, config->scales);
+    }
+    return descriptor;
+}
+
+void embedding_cpu(EmbeddingCpuDescriptor const *descriptor, Tensor y, Tensor table, Tensor indices, Tensor scales, void *stream) {
+    launch(
+        descriptor->plan, [&] { return plan_embedding_cpu(y.layout, table.layout, indices.layout, scales.layout); }, stream,
+        {y.data, table.data, indices.data, scales.data},
+        [](EmbeddingCpuPlan const &plan, void *const *data) { plan.kernel(plan, data[0], data[1], data[2], data[3]); });
+}
@@ -0,0 +1,31 @@
+#ifndef __CPU_EMBEDDING_H__
+#define __CPU_EMBEDDING_H__
+
+#include "operators.h"
+#include "ops/embedding/embedding.h"
+#include <optional>
+
+struct EmbeddingCpuPlan;
+typedef void (*EmbeddingCpuKernel)(EmbeddingCpuPlan const &plan, void *y, void const *table, void const *indices, void const *scales);
+
+struct EmbeddingCpuPlan {
+    uint64_t n, hidden, vocab;
+    // byte strides of the rows of y and of the table, and of indices and scales
+    int64_t y_stride, table_stride, index_stride, scale_stride;
+    // bytes of an index, 4 or 8, and of an element of y
+    uint64_t index_size, element_size;
+    EmbeddingCpuKernel kernel;
+};
+
+struct EmbeddingCpuDescriptor {
+    Device device;
+    std::optional<EmbeddingCpuPlan> plan;
+};
+
+EmbeddingCpuPlan plan_embedding_cpu(TensorLayout const *y, TensorLayout const *table, TensorLayout const *indices, TensorLayout const *scales);
+
+EmbeddingCpuDescriptor *create_embedding_cpu_descriptor(Device device, EmbeddingConfig const *config);
+
+void embedding_cpu(EmbeddingCpuDescriptor const *descriptor, Tensor y, Tensor table, Tensor indices, Tensor scales, void *stream);
+
+#endif// __CPU_EMBEDDING_H__
@@ -0,0 +1,55 @@
+#include "../profile.h"
+#include "../utils.h"
+#include "ops/embedding/embedding.h"
+
+#ifdef ENABLE_CPU
+#include "cpu/embedding_cpu.h"
+#endif
+
+struct EmbeddingDescriptor {
+    Device device;
+};
+
+__C void *createEmbeddingDescriptor(Device device, void *config) {
+    switch (device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            return (EmbeddingDescriptor *) create_embedding_cpu_descriptor(device, (EmbeddingConfig const *) config);
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+    return nullptr;
+}
+
+__C void destroyEmbeddingDescriptor(EmbeddingDescriptor *descriptor) {
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            delete (EmbeddingCpuDescriptor *) (descriptor);
+            break;
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+}
+
+__C void getEmbeddingWorkspaceSize(EmbeddingDescriptor *descriptor, uint64_t *size) {
+    *size = 0;
+}
+
+__C void embedding(EmbeddingDescriptor *descriptor, void *workspace, uint64_t workspace_size, Tensor y, Tensor table, Tensor indices, Tensor scales, void *stream) {
+    ProfileScope profile("embedding", [&] {
+        auto rows = double(y.layout->shape[0]);
+        return OpCost{shape_bucket(y.layout), tensor_bytes(y.layout) + rows * table.layout->shape[1] * table.layout->dt.size + tensor_bytes(indices.layout), 0};
+    });
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            embedding_cpu((EmbeddingCpuDescriptor *) descriptor, y, table, indices, scales, stream);
+            break;
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+}
@@ -0,0 +1,204 @@
+#include "kv_cache_append_cpu.h"
+#include "../../../devices/cpu/stream.h"
+#include "../../../devices/cpu/thread_pool.h"
+#include "../../rotary_embedding/cpu/rotary_embedding_cpu.h"
+#include "../../utils.h"
+
+// longest row a quantized cache converts on the stack
+constexpr static uint64_t KV_MAX_HEAD_DIM = 1024;
+
+static char *at(void *base, KVCacheCpuLayout const &layout, uint64_t block, uint64_t s, uint64_t h) {
+    return reinterpret_cast<char *>(base) + s / block * layout.block_stride + s % block * layout.slot_stride + h * layout.head_stride;
+}
+
+// Calls `f(src, dst, i, h, s, is_v)` for the row of head `h` of token `i`
+// of k or v and slot `s` of the cache it goes to. Every such row is a
+// separate item, so a decode step of one token still spreads over threads.
+template<class T, class F>
+static void for_each_row(KVCacheAppendCpuPlan const &plan, void *k_cache, void *v_cache, void const *k, void const *v, void const *slots, F const &f) {
+    auto heads = plan.heads;
+    parallel_for(plan.tokens * heads * 2, [&](int64_t begin, int64_t end) {
+        for (auto item = begin; item < end; ++item) {
+            uint64_t i = item / (heads * 2),
+                     h = item / 2 % heads;
+            auto is_v = item % 2 == 1;
+
+            auto slot_ = reinterpret_cast<char const *>(slots) + i * plan.slot_stride;
+            auto slot = plan.slot_size == 8 ? *reinterpret_cast<int64_t const *>(slot_)
+                                            : int64_t(*reinterpret_cast<int32_t const *>(slot_));
+            if (slot < 0) {
+                continue;
+            }
+            auto s = uint64_t(slot) % plan.capacity;
+
+            auto const &rows = is_v ? plan.v : plan.k;
+            auto src = reinterpret_cast<T const *>(reinterpret_cast<char const *>(is_v ? v : k) + i * rows.token_stride + h * rows.head_stride);
+            auto dst = at(is_v ? v_cache : k_cache, is_v ? plan.v_cache : plan.k_cache, plan.block, s, h);
+            f(src, dst, i, h, s, is_v);
+        }
+    });
+}
+
+static unsigned int position(KVCacheAppendCpuPlan const &plan, void const *pos, uint64_t i) {
+    return *reinterpret_cast<unsigned int const *>(reinterpret_cast<char const *>(pos) + i * plan.pos_stride);
+}
+
+template<class T>
+static void kv_cache_append(KVCacheAppendCpuPlan const &plan, void *k_cache, void *v_cache, void *, void *,
+                            void const *k, void const *v, void const *slots, void const *pos, float theta) {
+    for_each_row<T>(plan, k_cache, v_cache, k, v, slots, [&](T const *src, char *dst, uint64_t i, uint64_t, uint64_t, bool is_v) {
+        if (!is_v && plan.rotary) {
+            rotate_pairs(reinterpret_cast<T *>(dst), src, plan.dh / 2, position(plan, pos, i), theta);
+        } else {
+            std::memcpy(dst, src, plan.dh * sizeof(T));
+        }
+    });
+}
+
+// a row widened to f32, rotated when it is one of k, then scaled into `Q`
+template<class T, class Q>
+static void kv_cache_append_quantized(KVCacheAppendCpuPlan const &plan, void *k_cache, void *v_cache, void *k_scales, void *v_scales,
+                                      void const *k, void const *v, void const *slots, void const *pos, float theta) {
+    auto dh = plan.dh;
+    for_each_row<T>(plan, k_cache, v_cache, k, v, slots, [&](T const *src, char *dst, uint64_t i, uint64_t h, uint64_t s, bool is_v) {
+        float row[KV_MAX_HEAD_DIM];
+        for (uint64_t j = 0; j < dh; ++j) {
+            row[j] = to_f32(src[j]);
+        }
+        if (!is_v && plan.rotary) {
+            rotate_pairs(row, row, dh / 2, position(plan, pos, i), theta);
+        }
+
+        float scale = 1;
+        if (plan.scaled) {
+            auto scale_ = reinterpret_cast<float *>(at(is_v ? v_scales : k_scales, is_v ? plan.v_scales : plan.k_scales, plan.block, s, h));
+            if (plan.dynamic) {
+                float max = 0;
+                for (uint64_t j = 0; j < dh; ++j) {
+                    max = std::max(max, std::fabs(row[j]));
+                }
+                *scale_ = max / max_finite<Q>();
+            }
+            scale = *scale_;
+        }
+        auto inv = scale == 0 ? 0 : 1 / scale;
+        auto q = reinterpret_cast<Q *>(dst);
+        for (uint64_t j = 0; j < dh; ++j) {
+            q[j] = from_f32<Q>(row[j] * inv);
+        }
+    });
+}
+
+static KVCacheCpuLayout plan_cache(TensorLayout const *cache, uint64_t heads, uint64_t dh, uint64_t &capacity, uint64_t &block) {
+    ASSERT(cache->ndim == 3 || cache->ndim == 4);
+    auto paged = cache->ndim == 4;
+    auto n = cache->ndim;
+    ASSERT_EQ(cache->shape[n - 3], heads);
+    ASSERT_EQ(cache->shape[n - 1], dh);
+    ASSERT_EQ(cache->strides[n - 1], cache->dt.size);
+    block = cache->shape[n - 2];
+    capacity = paged ? cache->shape[0] * block : block;
+    return {paged ? cache->strides[0] : 0, cache->strides[n - 2], cache->strides[n - 3]};
+}
+
+// scales of every head, or of every slot and head laid out as the cache is
+static KVCacheCpuLayout plan_scales(TensorLayout const *scales, TensorLayout const *cache, bool &dynamic) {
+    ASSERT(dtype_eq(scales->dt, F32));
+    dynamic = scales->ndim != 1;
+    if (!dynamic) {
+        ASSERT_EQ(scales->shape[0], cache->shape[cache->ndim - 3]);
+        return {0, 0, scales->strides[0]};
+    }
+    ASSERT_EQ(scales->ndim, cache->ndim - 1);
+    for (uint64_t i = 0; i < scales->ndim; ++i) {
+        ASSERT_EQ(scales->shape[i], cache->shape[i]);
+    }
+    auto n = scales->ndim;
+    return {cache->ndim == 4 ? scales->strides[0] : 0, scales->strides[n - 1], scales->strides[n - 2]};
+}
+
+static KVRowsCpuLayout plan_rows(TensorLayout const *x, uint64_t tokens, uint64_t heads, uint64_t dh) {
+    ASSERT_EQ(x->ndim, 3);
+    ASSERT_EQ(x->shape[0], tokens);
+    ASSERT_EQ(x->shape[1], heads);
+    ASSERT_EQ(x->shape[2], dh);
+    ASSERT_EQ(x->strides[2], x->dt.size);
+    return {x->strides[0], x->strides[1]};
+}
+
+KVCacheAppendCpuPlan plan_kv_cache_append_cpu(TensorLayout const *k_cache, TensorLayout const *v_cache,
+                                              TensorLayout const *k_scales, TensorLayout const *v_scales,
+                                              TensorLayout const *k, TensorLayout const *v, TensorLayout const *slots, TensorLayout const *pos) {
+    ASSERT_EQ(k->ndim, 3);
+    ASSERT(dtype_eq(k->dt, v->dt));
+    ASSERT(dtype_eq(k_cache->dt, v_cache->dt));
+    KVCacheAppendCpuPlan plan{};
+    plan.tokens = k->shape[0];
+    plan.heads = k->shape[1];
+    plan.dh = k->shape[2];
+    plan.k = plan_rows(k, plan.tokens, plan.heads, plan.dh);
+    plan.v = plan_rows(v, plan.tokens, plan.heads, plan.dh);
+    plan.k_cache = plan_cache(k_cache, plan.heads, plan.dh, plan.capacity, plan.block);
+    uint64_t capacity, block;
+    plan.v_cache = plan_cache(v_cache, plan.heads, plan.dh, capacity, block);
+    ASSERT_EQ(capacity, plan.capacity);
+    ASSERT_EQ(block, plan.block);
+
+    ASSERT_EQ(slots->ndim, 1);
+    ASSERT_EQ(slots->shape[0], plan.tokens);
+    ASSERT(dtype_eq(slots->dt, I32) || dtype_eq(slots->dt, I64));
+    plan.slot_stride = slots->strides[0];
+    plan.slot_size = slots->dt.size;
+    if (pos) {
+        ASSERT_EQ(pos->ndim, 1);
+        ASSERT_EQ(pos->shape[0], plan.tokens);
+        ASSERT_EQ(pos->dt.size, 4);
+        ASSERT_EQ(plan.dh % 2, 0);
+        plan.pos_stride = pos->strides[0];
+        plan.rotary = true;
+    }
+
+    if (dtype_eq(k_cache->dt, k->dt)) {
+        dispatch_float(k->dt, [&](auto data) {
+            plan.kernel = kv_cache_append<decltype(data)>;
+        });
+        return plan;
+    }
+    ASSERT(plan.dh <= KV_MAX_HEAD_DIM);
+    // integers have no range of their own to fit a row into
+    ASSERT(k_scales || !dtype_eq(k_cache->dt, I8));
+    ASSERT_EQ(k_scales == nullptr, v_scales == nullptr);
+    if (k_scales) {
+        bool v_dynamic;
+        plan.scaled = true;
+        plan.k_scales = plan_scales(k_scales, k_cache, plan.dynamic);
+        plan.v_scales = plan_scales(v_scales, v_cache, v_dynamic);
+        ASSERT_EQ(plan.dynamic, v_dynamic);
+    }
+    dispatch_float(k->dt, [&](auto data) {
+        dispatch_quantized(k_cache->dt, [&](auto quantized) {
+            plan.kernel = kv_cache_append_quantized<decltype(data), decltype(quantized)>;
+        });
+    });
+    return plan;
+}
+
+KVCacheAppendCpuDescriptor *create_kv_cache_append_cpu_descriptor(Device device, KVCacheAppendConfig const *config) {
+    auto descriptor = new KVCacheAppendCpuDescriptor{device};
+    if (config) {
+        descriptor->plan = plan_kv_cache_append_cpu(config->k_cache, config->v_cache, config->k_scales, config->v_scales,
+                                                    config->k, config->v, config->slots, config->pos);
+    }
+    return descriptor;
+}
+
+void kv_cache_append_cpu(KVCacheAppendCpuDescriptor const *descriptor, Tensor k_cache, Tensor v_cache, Tensor k_scales, Tensor v_scales,
+                         Tensor k, Tensor v, Tensor slots, Tensor pos, float theta, void *stream) {
+    launch(
+        descriptor->plan,
+        [&] { return plan_kv_cache_append_cpu(k_cache.layout, v_cache.layout, k_scales.layout, v_scales.layout, k.layout, v.layout, slots.layout, pos.layout); },
+        stream, {k_cache.data, v_cache.data, k_scales.data, v_scales.data, k.data, v.data, slots.data, pos.data},
+        [theta](KVCacheAppendCpuPlan const &plan, void *const *data) {
+            plan.kernel(plan, data[0], data[1], data[2], data[3], data[4], data[5], data[6], data[7], theta);
+        });
+}
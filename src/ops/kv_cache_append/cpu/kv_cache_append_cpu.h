@@ -0,0 +1,54 @@
+#ifndef __CPU_KV_CACHE_APPEND_H__
+#define __CPU_KV_CACHE_APPEND_H__
+
+#include "operators.h"
+#include "ops/kv_cache_append/kv_cache_append.h"
+#include <optional>
+
+// byte strides of a cache, or of its scales: slot s of head h is at
+// s / block * block_stride + s % block * slot_stride + h * head_stride
+struct KVCacheCpuLayout {
+    int64_t block_stride, slot_stride, head_stride;
+};
+
+// byte strides of the new keys or values
+struct KVRowsCpuLayout {
+    int64_t token_stride, head_stride;
+};
+
+struct KVCacheAppendCpuPlan;
+typedef void (*KVCacheAppendCpuKernel)(KVCacheAppendCpuPlan const &plan, void *k_cache, void *v_cache, void *k_scales, void *v_scales,
+                                       void const *k, void const *v, void const *slots, void const *pos, float theta);
+
+struct KVCacheAppendCpuPlan {
+    uint64_t tokens, heads, dh;
+    // slots of the cache, and of one of its blocks
+    uint64_t capacity, block;
+    KVCacheCpuLayout k_cache, v_cache;
+    KVRowsCpuLayout k, v;
+    // of a quantized cache with scales, set by every append when `dynamic`
+    // and fixed per head when not
+    bool scaled, dynamic;
+    KVCacheCpuLayout k_scales, v_scales;
+    // byte strides of slots and pos, and bytes of a slot
+    int64_t slot_stride, pos_stride;
+    uint64_t slot_size;
+    bool rotary;
+    KVCacheAppendCpuKernel kernel;
+};
+
+struct KVCacheAppendCpuDescriptor {
+    Device device;
+    std::optional<KVCacheAppendCpuPlan> plan;
+};
+
+KVCacheAppendCpuPlan plan_kv_cache_append_cpu(TensorLayout const *k_cache, TensorLayout const *v_cache,
+                                              TensorLayout const *k_scales, TensorLayout const *v_scales,
+                                              TensorLayout const *k, TensorLayout const *v, TensorLayout const *slots, TensorLayout const *pos);
+
+KVCacheAppendCpuDescriptor *create_kv_cache_append_cpu_descriptor(Device device, KVCacheAppendConfig const *config);
+
+void kv_cache_append_cpu(KVCacheAppendCpuDescriptor const *descriptor, Tensor k_cache, Tensor v_cache, Tensor k_scales, Tensor v_scales,
+                         Tensor k, Tensor v, Tensor slots, Tensor pos, float theta, void *stream);
+
+#endif// __CPU_KV_CACHE_APPEND_H__
@@ -0,0 +1,58 @@
+#include "../profile.h"
+#include "../utils.h"
+#include "ops/kv_cache_append/kv_cache_append.h"
+
+#ifdef ENABLE_CPU
+#include "cpu/kv_cache_append_cpu.h"
+#endif
+
+struct KVCacheAppendDescriptor {
+    Device device;
+};
+
+__C void *createKVCacheAppendDescriptor(Device device, void *config) {
+    switch (device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            return (KVCacheAppendDescriptor *) create_kv_cache_append_cpu_descriptor(device, (KVCacheAppendConfig const *) config);
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+    return nullptr;
+}
+
+__C void destroyKVCacheAppendDescriptor(KVCacheAppendDescriptor *descriptor) {
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            delete (KVCacheAppendCpuDescriptor *) (descriptor);
+            break;
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+}
+
+__C void getKVCacheAppendWorkspaceSize(KVCacheAppendDescriptor *descriptor, uint64_t *size) {
+    *size = 0;
+}
+
+__C void kvCacheAppend(KVCacheAppendDescriptor *descriptor, void *workspace, uint64_t workspace_size,
+                       Tensor k_cache, Tensor v_cache, Tensor k_scales, Tensor v_scales,
+                       Tensor k, Tensor v, Tensor slots, Tensor pos, float theta, void *stream) {
+    ProfileScope profile("kv_cache_append", [&] {
+        // the caches take a row of each token, in their own type
+        auto rows = tensor_elements(k.layout) + tensor_elements(v.layout);
+        return OpCost{shape_bucket(k.layout), tensor_bytes(k.layout) + tensor_bytes(v.layout) + rows * k_cache.layout->dt.size + tensor_bytes(slots.layout), 0};
+    });
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            kv_cache_append_cpu((KVCacheAppendCpuDescriptor *) descriptor, k_cache, v_cache, k_scales, v_scales, k, v, slots, pos, theta, stream);
+            break;
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+}
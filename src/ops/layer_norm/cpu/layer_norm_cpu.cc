@@ -0,0 +1,43 @@
+#include "layer_norm_cpu.h"
+#include "../../../devices/cpu/stream.h"
+#include <utility>
+
+template<class Tdata, class Tweight>
+static void layer_norm(LayerNormCpuPlan const &plan, void *y, void const *x, void const *w, void const *b, void *residual, float epsilon) {
+    normalize_rows<Tdata, Tweight>(plan.norm, y, x, residual, w, plan.bias ? b : nullptr, [epsilon](Tdata const *x_, uint64_t d) {
+        auto m = moments(x_, d);
+        return std::pair(m.mean, 1.0f / std::sqrt(m.variance() + epsilon));
+    });
+}
+
+LayerNormCpuPlan plan_layer_norm_cpu(TensorLayout const *y, TensorLayout const *x, TensorLayout const *w, TensorLayout const *b, TensorLayout const *residual) {
+    LayerNormCpuPlan plan{plan_norm(y, x, w, residual), b != nullptr};
+    if (b) {
+        ASSERT(dtype_eq(b->dt, w->dt));
+        ASSERT_EQ(b->ndim, 1);
+        ASSERT_EQ(b->shape[0], w->shape[0]);
+        ASSERT_EQ(b->strides[0], b->dt.size);
+    }
+    // the weight and bias may be stored in a wider type than the activations
+    dispatch_float(y->dt, [&](auto data) {
+        dispatch_float(w->dt, [&](auto weight) {
+            plan.kernel = layer_norm<decltype(data), decltype(weight)>;
+        });
+    });
+    return plan;
+}
+
+LayerNormCpuDescriptor *create_layer_norm_cpu_descriptor(Device device, LayerNormConfig const *config) {
+    auto descriptor = new LayerNormCpuDescriptor{device};
+    if (config) {
+        descriptor->plan = plan_layer_norm_cpu(config->y, config->x, config->w, config->b, config->residual);
+    }
+    return descriptor;
+}
+
+void layer_norm_cpu(LayerNormCpuDescriptor const *descriptor, Tensor y, Tensor x, Tensor w, Tensor b, Tensor residual, float epsilon, void *stream) {
+    launch(
+        descriptor->plan, [&] { return plan_layer_norm_cpu(y.layout, x.layout, w.layout, b.layout, residual.layout); }, stream,
+        {y.data, x.data, w.data, b.data, residual.data},
+        [epsilon](LayerNormCpuPlan const &plan, void *const *data) { plan.kernel(plan, data[0], data[1], data[2], data[3], data[4], epsilon); });
+}
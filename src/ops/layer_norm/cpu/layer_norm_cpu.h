@@ -0,0 +1,29 @@
+#ifndef __CPU_LAYER_NORM_H__
+#define __CPU_LAYER_NORM_H__
+
+#include "../../../devices/cpu/norm.h"
+#include "operators.h"
+#include "ops/layer_norm/layer_norm.h"
+#include <optional>
+
+struct LayerNormCpuPlan;
+typedef void (*LayerNormCpuKernel)(LayerNormCpuPlan const &plan, void *y, void const *x, void const *w, void const *b, void *residual, float epsilon);
+
+struct LayerNormCpuPlan {
+    NormPlan norm;
+    bool bias;
+    LayerNormCpuKernel kernel;
+};
+
+struct LayerNormCpuDescriptor {
+    Device device;
+    std::optional<LayerNormCpuPlan> plan;
+};
+
+LayerNormCpuPlan plan_layer_norm_cpu(TensorLayout const *y, TensorLayout const *x, TensorLayout const *w, TensorLayout const *b, TensorLayout const *residual);
+
+LayerNormCpuDescriptor *create_layer_norm_cpu_descriptor(Device device, LayerNormConfig const *config);
+
+void layer_norm_cpu(LayerNormCpuDescriptor const *descriptor, Tensor y, Tensor x, Tensor w, Tensor b, Tensor residual, float epsilon, void *stream);
+
+#endif// __CPU_LAYER_NORM_H__
@@ -0,0 +1,61 @@
+#include "../profile.h"
+#include "../utils.h"
+#include "ops/layer_norm/layer_norm.h"
+
+#ifdef ENABLE_CPU
+#include "cpu/layer_norm_cpu.h"
+#endif
+
+struct LayerNormDescriptor {
+    Device device;
+};
+
+__C void *createLayerNormDescriptor(Device device, void *config) {
+    switch (device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            return (LayerNormDescriptor *) create_layer_norm_cpu_descriptor(device, (LayerNormConfig const *) config);
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+    return nullptr;
+}
+
+__C void destroyLayerNormDescriptor(LayerNormDescriptor *descriptor) {
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            delete (LayerNormCpuDescriptor *) (descriptor);
+            break;
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+}
+
+__C void getLayerNormWorkspaceSize(LayerNormDescriptor *descriptor, uint64_t *size) {
+    *size = 0;
+}
+
+__C void layerNorm(LayerNormDescriptor *descriptor, void *workspace, uint64_t workspace_size, Tensor y, Tensor x, Tensor w, Tensor b, Tensor residual, float epsilon, void *stream) {
+    ProfileScope profile("layer_norm", [&] {
+        auto bytes = tensor_bytes(y.layout) + tensor_bytes(x.layout) + tensor_bytes(w.layout);
+        if (b.layout) {
+            bytes += tensor_bytes(b.layout);
+        }
+        if (residual.layout) {
+            bytes += 2 * tensor_bytes(residual.layout);
+        }
+        return OpCost{shape_bucket(y.layout), bytes, 8 * tensor_elements(x.layout)};
+    });
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            layer_norm_cpu((LayerNormCpuDescriptor *) descriptor, y, x, w, b, residual, epsilon, stream);
+            break;
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+}
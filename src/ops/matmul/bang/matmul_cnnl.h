@@ -19,8 +19,10 @@ inline void setMatrixTensorEx(cnnlTensorDescriptor_t desc, const BlasMatrix &mat
     int cols = matrix.cols;
     int row_stride = matrix.row_stride;
     int col_stride = matrix.col_stride;
+    // cnnl takes one batch dimension
+    ASSERT(matrix.batch_ndim <= 1);
 
-    if (ndim == 3) {
+    if (ndim >= 3) {
         std::vector<int> dim_size = {batch, rows, cols};
         std::vector<int> dim_stride = {stride, row_stride, col_stride};
         cnnlSetTensorDescriptorEx(desc, CNNL_LAYOUT_ARRAY, CNNL_DTYPE_HALF,
@@ -6,37 +6,45 @@
 #include <algorithm>
 #include <stdint.h>
 
+// most batch dimensions a matmul operand may have
+constexpr static int MAX_BATCH_DIMS = 8;
+
 typedef struct BlasMatrix {
     int ndim;
+    // matrices of the batch that are distinct, and the stride between them
+    // when the batch has at most one dimension
     int batch;
     int64_t stride;
     int rows;
     int cols;
     int row_stride;
     int col_stride;
+    // The batch dimensions, outermost first, with their element strides. A
+    // `MatmulInfo` aligns those of its operands to those of c, which a
+    // matrix repeated along a dimension has a stride of 0 in.
+    int batch_ndim;
+    int batch_shape[MAX_BATCH_DIMS];
+    int64_t batch_strides[MAX_BATCH_DIMS];
 
     BlasMatrix() {}
 
     BlasMatrix(TensorLayout *layout) {
-        if (layout->ndim == 2) {
-            this->ndim = 2;
-            this->batch = 1;
-            this->stride = 0;
-            this->rows = layout->shape[0];
-            this->cols = layout->shape[1];
-            this->row_stride = layout->strides[0] / layout->dt.size;
-            this->col_stride = layout->strides[1] / layout->dt.size;
-        } else if (layout->ndim == 3) {
-            this->ndim = 3;
-            this->batch = layout->shape[0];
-            this->stride = this->batch == 1 ? 0 : layout->strides[0] / layout->dt.size;
-            this->rows = layout->shape[1];
-            this->cols = layout->shape[2];
-            this->row_stride = layout->strides[1] / layout->dt.size;
-            this->col_stride = layout->strides[2] / layout->dt.size;
-        } else {
+        if (layout->ndim < 2 || layout->ndim > 2 + MAX_BATCH_DIMS) {
             PANIC(InvalidMatrixShape);
         }
+        this->ndim = layout->ndim;
+        this->batch_ndim = this->ndim - 2;
+        this->batch = 1;
+        for (int i = 0; i < this->batch_ndim; ++i) {
+            this->batch_shape[i] = layout->shape[i];
+            this->batch_strides[i] = layout->shape[i] == 1 ? 0 : layout->strides[i] / layout->dt.size;
+            this->batch *= layout->shape[i];
+        }
+        this->stride = this->batch_ndim == 1 ? this->batch_strides[0] : 0;
+        this->rows = layout->shape[this->ndim - 2];
+        this->cols = layout->shape[this->ndim - 1];
+        this->row_stride = layout->strides[this->ndim - 2] / layout->dt.size;
+        this->col_stride = layout->strides[this->ndim - 1] / layout->dt.size;
 
         if (this->row_stride != 1 && this->col_stride != 1) {
             ASSERT(false);
@@ -44,8 +52,17 @@ typedef struct BlasMatrix {
         }
     }
 
-    bool match_batch(int batch) const {
-        return this->batch == batch || this->batch == 1;
+    // element offset of matrix `i` of the batch, counted row major
+    int64_t offset(int64_t i) const {
+        if (this->batch_ndim == 1) {
+            return i * this->batch_strides[0];
+        }
+        int64_t offset = 0;
+        for (int d = this->batch_ndim; d-- > 0;) {
+            offset += i % this->batch_shape[d] * this->batch_strides[d];
+            i /= this->batch_shape[d];
+        }
+        return offset;
     }
 
     void transpose() {
@@ -73,36 +90,118 @@ struct MatmulInfo {
 
     int m, n, k, batch;
 
-    MatmulInfo(Tensor c, Tensor a, Tensor b, bool col_major = true) {
-        a_matrix = BlasMatrix(a.layout);
-        b_matrix = BlasMatrix(b.layout);
-        c_matrix = BlasMatrix(c.layout);
+    // whether a and b were swapped to make c match the requested majorness
+    bool is_transed = false;
 
-        a_ptr = a.data;
-        b_ptr = b.data;
-        c_ptr = c.data;
+    MatmulInfo() {}
+
+    MatmulInfo(TensorLayout *c, TensorLayout *a, TensorLayout *b, bool col_major = true) {
+        a_matrix = BlasMatrix(a);
+        b_matrix = BlasMatrix(b);
+        c_matrix = BlasMatrix(c);
+
+        a_ptr = nullptr;
+        b_ptr = nullptr;
+        c_ptr = nullptr;
 
         ASSERT_EQ(c_matrix.rows, a_matrix.rows);// m
         ASSERT_EQ(c_matrix.cols, b_matrix.cols);// n
         ASSERT_EQ(a_matrix.cols, b_matrix.rows);// k
 
-        batch = c_matrix.batch;
-        if (!a_matrix.match_batch(batch) || !b_matrix.match_batch(batch)) {
-            PANIC(InvalidBatchSize);
-        }
+        broadcast_batch();
 
         if ((col_major && c_matrix.col_stride == 1) || (!col_major && c_matrix.row_stride == 1)) {
             c_matrix.transpose();
             b_matrix.transpose();
             a_matrix.transpose();
             std::swap(a_matrix, b_matrix);
-            std::swap(a_ptr, b_ptr);
+            is_transed = true;
         }
 
         m = c_matrix.rows;
         n = c_matrix.cols;
         k = a_matrix.cols;
     }
+
+    MatmulInfo(Tensor c, Tensor a, Tensor b, bool col_major = true) : MatmulInfo(c.layout, a.layout, b.layout, col_major) {
+        bind(c.data, a.data, b.data);
+    }
+
+    // Align the batch dimensions of a and b to those of c as numpy
+    // broadcasts them, missing or of length 1 where they repeat, so that
+    // keys of (batch, kv_heads, 1, ...) serve queries of (batch, kv_heads,
+    // group, ...) as they are. Dimensions of length 1 are then dropped, and
+    // neighbours all three step through evenly merged, leaving a 3-D batch
+    // one dimension as before.
+    void broadcast_batch() {
+        BlasMatrix *matrices[]{&a_matrix, &b_matrix, &c_matrix};
+        auto ndim = c_matrix.batch_ndim;
+        int shape[MAX_BATCH_DIMS];
+        int64_t strides[3][MAX_BATCH_DIMS];
+        for (int i = 0; i < 3; ++i) {
+            auto &x = *matrices[i];
+            if (x.batch_ndim > ndim) {
+                PANIC(InvalidBatchSize);
+            }
+            for (int d = 0; d < ndim; ++d) {
+                auto d_ = d - (ndim - x.batch_ndim);
+                if (d_ < 0 || x.batch_shape[d_] == 1) {
+                    strides[i][d] = 0;
+                } else if (x.batch_shape[d_] == c_matrix.batch_shape[d]) {
+                    strides[i][d] = x.batch_strides[d_];
+                } else {
+                    PANIC(InvalidBatchSize);
+                }
+            }
+        }
+
+        int merged = 0;
+        for (int d = 0; d < ndim; ++d) {
+            auto length = c_matrix.batch_shape[d];
+            if (length == 1) {
+                continue;
+            }
+            auto follows = merged > 0;
+            for (int i = 0; i < 3 && follows; ++i) {
+                follows = strides[i][merged - 1] == strides[i][d] * length;
+            }
+            if (follows) {
+                shape[merged - 1] *= length;
+                for (int i = 0; i < 3; ++i) {
+                    strides[i][merged - 1] = strides[i][d];
+                }
+            } else {
+                shape[merged] = length;
+                for (int i = 0; i < 3; ++i) {
+                    strides[i][merged] = strides[i][d];
+                }
+                ++merged;
+            }
+        }
+
+        batch = 1;
+        for (int d = 0; d < merged; ++d) {
+            batch *= shape[d];
+        }
+        for (int i = 0; i < 3; ++i) {
+            auto &x = *matrices[i];
+            x.batch_ndim = merged;
+            x.batch = 1;
+            for (int d = 0; d < merged; ++d) {
+                x.batch_shape[d] = shape[d];
+                x.batch_strides[d] = strides[i][d];
+                x.batch *= strides[i][d] ? shape[d] : 1;
+            }
+            x.stride = merged == 1 ? strides[i][0] : 0;
+        }
+    }
+
+    // attach the data of the tensors this info was derived from
+    void bind(void *c, void const *a, void const *b) {
+        c_ptr = c;
+        a_ptr = is_transed ? b : a;
+        b_ptr = is_transed ? a : b;
+    }
 };
 
 #endif// __BLAS_H__
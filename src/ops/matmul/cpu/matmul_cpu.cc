@@ -1,24 +1,564 @@
 #include "matmul_cpu.h"
 #include "../../../devices/cpu/common_cpu.h"
+#include "../../../devices/cpu/stream.h"
+#include "../../../devices/cpu/thread_pool.h"
+#include "../../../devices/cpu/tuning.h"
 #include "../../utils.h"
-#include "../blas.h"
-#include <cmath>
-
-void matmul_cpu_f16(Tensor c, float beta, Tensor a, Tensor b, float alpha) {
-    auto info = MatmulInfo(c, a, b);
-
-    for (int i = 0; i < info.batch; ++i) {
-        for (int m_ = 0; m_ < info.m; ++m_) {
-            for (int n_ = 0; n_ < info.n; ++n_) {
-                auto c_ = reinterpret_cast<uint16_t *>(info.c_ptr) + i * info.c_matrix.stride + m_ * info.c_matrix.row_stride + n_ * info.c_matrix.col_stride;
-                float sum = 0;
-                for (int k_ = 0; k_ < info.k; ++k_) {
-                    auto a_ = reinterpret_cast<uint16_t const *>(info.a_ptr) + i * info.a_matrix.stride + m_ * info.a_matrix.row_stride + k_ * info.a_matrix.col_stride;
-                    auto b_ = reinterpret_cast<uint16_t const *>(info.b_ptr) + i * info.b_matrix.stride + n_ * info.b_matrix.col_stride + k_ * info.b_matrix.row_stride;
-                    sum += f16_to_f32(*a_) * f16_to_f32(*b_);
+#include <algorithm>
+#include <string>
+
+// bytes of b a task should keep hot in cache while sweeping its rows of a
+constexpr static int B_PANEL_BYTES = 256 * 1024;
+// rows of a a task sweeps over its panel
+constexpr static int A_BLOCK_ROWS = 16;
+
+template<class T>
+static inline void store(T *c, float beta, float alpha, float sum) {
+    *c = from_f32<T>(beta == 0 ? alpha * sum : beta * to_f32(*c) + alpha * sum);
+}
+
+// `f(thread, i, m0, m1, n0, n1)` for every tile of every batch, spread over threads.
+// Tiles of the larger operand are outermost, so each thread, and with it each
+// NUMA node, reads a contiguous slice of the weight.
+template<class F>
+static void for_each_tile(MatmulCpuPlan const &plan, MatmulInfo const &info, F const &f) {
+    auto inner_tiles = plan.m_outer ? plan.n_tiles : plan.m_tiles;
+    parallel_for(plan.tasks, [&](int64_t tasks_begin, int64_t tasks_end, int thread) {
+        for (int64_t task = tasks_begin; task < tasks_end; ++task) {
+            int outer = task / (info.batch * inner_tiles),
+                i = task / inner_tiles % info.batch,
+                inner = task % inner_tiles;
+            auto m0 = (plan.m_outer ? outer : inner) * plan.m_block,
+                 n0 = (plan.m_outer ? inner : outer) * plan.n_block;
+            f(thread, i, m0, std::min(m0 + plan.m_block, info.m), n0, std::min(n0 + plan.n_block, info.n));
+        }
+    },
+                 plan.threads);
+}
+
+// a and b both contiguous along k, which covers activations times
+// transposed weights; c, a and b each of their own type, as `info` has
+// them, summed in f32
+template<class C, class A, class B>
+static void matmul_dot(MatmulCpuPlan const &plan, MatmulInfo const &info, void const *, float beta, float alpha, Workspace const &) {
+    auto a = info.a_matrix, b = info.b_matrix, c = info.c_matrix;
+    for_each_tile(plan, info, [&](int, int i, int m0, int m1, int n0, int n1) {
+        auto a_ = reinterpret_cast<A const *>(info.a_ptr) + a.offset(i);
+        auto b_ = reinterpret_cast<B const *>(info.b_ptr) + b.offset(i);
+        auto c_ = reinterpret_cast<C *>(info.c_ptr) + c.offset(i);
+        for (int m_ = m0; m_ < m1; ++m_) {
+            for (int n_ = n0; n_ < n1; ++n_) {
+                auto sum = dot(a_ + m_ * a.row_stride, b_ + n_ * b.col_stride, info.k);
+                store(c_ + m_ * c.row_stride + n_ * c.col_stride, beta, alpha, sum);
+            }
+        }
+    });
+}
+
+// what a thread keeps at the start of its slice of the workspace
+struct PackedTiles {
+    // tile whose rows of a, and panel of b, were copied last
+    int64_t a_key, b_key;
+};
+
+// a or b strided along k, as with row major weights: every thread copies
+// the rows of a and the panel of b of its tile into its slice of the
+// workspace, contiguous along k, and runs the dot kernel on the copies. A
+// panel is copied once for all the consecutive tiles of a thread sharing it.
+// The copies keep the types of a and b.
+template<class C, class A, class B>
+static void matmul_packed(MatmulCpuPlan const &plan, MatmulInfo const &info, void const *, float beta, float alpha, Workspace const &workspace) {
+    auto a = info.a_matrix, b = info.b_matrix, c = info.c_matrix;
+    auto k = info.k;
+    auto pack_a = a.col_stride != 1,
+         pack_b = b.row_stride != 1;
+    auto a_bytes = align_workspace(pack_a ? size_t(plan.m_block) * k * sizeof(A) : 0);
+    auto threads = ThreadPool::instance().threads();
+    auto scratch = static_cast<char *>(workspace.get(plan.pack_bytes * threads));
+    for (int thread = 0; thread < threads; ++thread) {
+        *reinterpret_cast<PackedTiles *>(scratch + thread * plan.pack_bytes) = {-1, -1};
+    }
+
+    for_each_tile(plan, info, [&](int thread, int i, int m0, int m1, int n0, int n1) {
+        auto slice = scratch + thread * plan.pack_bytes;
+        auto &packed = *reinterpret_cast<PackedTiles *>(slice);
+        auto a_pack = reinterpret_cast<A *>(slice + WORKSPACE_ALIGNMENT);
+        auto b_pack = reinterpret_cast<B *>(slice + WORKSPACE_ALIGNMENT + a_bytes);
+        auto a_ = reinterpret_cast<A const *>(info.a_ptr) + a.offset(i);
+        auto b_ = reinterpret_cast<B const *>(info.b_ptr) + b.offset(i);
+        auto c_ = reinterpret_cast<C *>(info.c_ptr) + c.offset(i);
+
+        // a strided along k is contiguous along m, so it is read k by k, and likewise b along n
+        int64_t a_key = a.offset(i) * info.m + m0,
+                b_key = b.offset(i) * info.n + n0;
+        if (pack_a && packed.a_key != a_key) {
+            for (int k_ = 0; k_ < k; ++k_) {
+                for (int m_ = m0; m_ < m1; ++m_) {
+                    a_pack[(m_ - m0) * k + k_] = a_[m_ * a.row_stride + k_ * a.col_stride];
+                }
+            }
+            packed.a_key = a_key;
+        }
+        if (pack_b && packed.b_key != b_key) {
+            for (int k_ = 0; k_ < k; ++k_) {
+                for (int n_ = n0; n_ < n1; ++n_) {
+                    b_pack[(n_ - n0) * k + k_] = b_[n_ * b.col_stride + k_ * b.row_stride];
                 }
-                *c_ = f32_to_f16(beta * f16_to_f32(*c_) + alpha * sum);
+            }
+            packed.b_key = b_key;
+        }
+
+        for (int m_ = m0; m_ < m1; ++m_) {
+            auto a_row = pack_a ? a_pack + (m_ - m0) * k : a_ + m_ * a.row_stride;
+            for (int n_ = n0; n_ < n1; ++n_) {
+                auto b_col = pack_b ? b_pack + (n_ - n0) * k : b_ + n_ * b.col_stride;
+                store(c_ + m_ * c.row_stride + n_ * c.col_stride, beta, alpha, dot(a_row, b_col, k));
+            }
+        }
+    });
+}
+
+// Rows r0 to r1 of a matrix k long, as f32 contiguous along k, each
+// element times its scale. `scale` points at that of the first element.
+template<class S>
+static void pack_scaled(float *dst, S const *src, int r0, int r1, int k, int r_stride, int k_stride,
+                        float const *scale, int64_t scale_r_stride, int64_t scale_k_stride) {
+    // read along whichever way the source is contiguous
+    if (k_stride == 1) {
+        for (int r = r0; r < r1; ++r) {
+            for (int k_ = 0; k_ < k; ++k_) {
+                dst[(r - r0) * k + k_] = to_f32(src[r * r_stride + k_]) * scale[r * scale_r_stride + k_ * scale_k_stride];
+            }
+        }
+    } else {
+        for (int k_ = 0; k_ < k; ++k_) {
+            for (int r = r0; r < r1; ++r) {
+                dst[(r - r0) * k + k_] = to_f32(src[r * r_stride + k_ * k_stride]) * scale[r * scale_r_stride + k_ * scale_k_stride];
             }
         }
     }
 }
+
+// scale of every element of a quantized operand given none
+constexpr static float UNSCALED = 1;
+
+// b quantized to `Q`, or a once `info` swapped them: as `matmul_packed`,
+// but both operands are always copied, as f32 and the quantized one scaled
+// on the way, so the 8-bit data is read once per panel and never widened
+// in memory as a whole. The other operand is of `T` and c of `C`.
+template<class C, class T, class Q>
+static void matmul_dequant(MatmulCpuPlan const &plan, MatmulInfo const &info, void const *scales, float beta, float alpha, Workspace const &workspace) {
+    auto a = info.a_matrix, b = info.b_matrix, c = info.c_matrix;
+    auto k = info.k;
+    auto s = plan.scales;
+    auto scales_ = plan.scaled ? static_cast<float const *>(scales) : &UNSCALED;
+    auto a_bytes = align_workspace(size_t(plan.m_block) * k * sizeof(float));
+    auto threads = ThreadPool::instance().threads();
+    auto scratch = static_cast<char *>(workspace.get(plan.pack_bytes * threads));
+    for (int thread = 0; thread < threads; ++thread) {
+        *reinterpret_cast<PackedTiles *>(scratch + thread * plan.pack_bytes) = {-1, -1};
+    }
+
+    for_each_tile(plan, info, [&](int thread, int i, int m0, int m1, int n0, int n1) {
+        auto slice = scratch + thread * plan.pack_bytes;
+        auto &packed = *reinterpret_cast<PackedTiles *>(slice);
+        auto a_pack = reinterpret_cast<float *>(slice + WORKSPACE_ALIGNMENT);
+        auto b_pack = reinterpret_cast<float *>(slice + WORKSPACE_ALIGNMENT + a_bytes);
+        auto scale = scales_ + i * s.stride;
+        auto c_ = reinterpret_cast<C *>(info.c_ptr) + c.offset(i);
+
+        int64_t a_key = a.offset(i) * info.m + m0,
+                b_key = b.offset(i) * info.n + n0;
+        if (packed.a_key != a_key) {
+            if (info.is_transed) {
+                pack_scaled(a_pack, reinterpret_cast<Q const *>(info.a_ptr) + a.offset(i), m0, m1, k, a.row_stride, a.col_stride,
+                            scale, s.row_stride, s.col_stride);
+            } else {
+                pack_scaled(a_pack, reinterpret_cast<T const *>(info.a_ptr) + a.offset(i), m0, m1, k, a.row_stride, a.col_stride,
+                            &UNSCALED, 0, 0);
+            }
+            packed.a_key = a_key;
+        }
+        if (packed.b_key != b_key) {
+            if (info.is_transed) {
+                pack_scaled(b_pack, reinterpret_cast<T const *>(info.b_ptr) + b.offset(i), n0, n1, k, b.col_stride, b.row_stride,
+                            &UNSCALED, 0, 0);
+            } else {
+                pack_scaled(b_pack, reinterpret_cast<Q const *>(info.b_ptr) + b.offset(i), n0, n1, k, b.col_stride, b.row_stride,
+                            scale, s.col_stride, s.row_stride);
+            }
+            packed.b_key = b_key;
+        }
+
+        for (int m_ = m0; m_ < m1; ++m_) {
+            for (int n_ = n0; n_ < n1; ++n_) {
+                store(c_ + m_ * c.row_stride + n_ * c.col_stride, beta, alpha, dot(a_pack + (m_ - m0) * k, b_pack + (n_ - n0) * k, k));
+            }
+        }
+    });
+}
+
+// a task of a grouped matmul: rows [m0, m1) of group g, which all share
+// matrix `matrix` of b, and columns [n0, n1)
+struct GroupedTile {
+    uint32_t g, matrix;
+    int64_t m0, m1;
+    int64_t n0, n1;
+};
+
+// Tiles are at most those of the panels of the plan, or twice what
+// narrowing stops short of: a halved panel at most doubles them.
+static uint64_t grouped_tiles(MatmulGroupedCpuPlan const &plan, int threads) {
+    return std::max<uint64_t>(plan.max_tiles, 8 * uint64_t(threads));
+}
+
+static size_t grouped_workspace_size(MatmulGroupedCpuPlan const &plan, int threads) {
+    return plan.pack_bytes * threads + plan.offsets_bytes + align_workspace(grouped_tiles(plan, threads) * sizeof(GroupedTile));
+}
+
+// Every group cut into tiles, columns of one panel after another so that
+// a thread running consecutive tiles copies each panel of b once, then all
+// the tiles spread over threads in even contiguous ranges. Rows and panels
+// are copied as in `matmul_packed` when strided along k.
+template<class T>
+static void matmul_grouped(MatmulGroupedCpuPlan const &plan, void *c, void const *a, void const *b, void const *cu_seqlens,
+                           void const *b_index, float beta, float alpha, Workspace const &workspace) {
+    auto groups = plan.cu_seqlens.sequences;
+    int64_t n = plan.n, k = plan.k;
+    auto threads = ThreadPool::instance().threads();
+    // the packing slices of the threads, then the group offsets and the tiles
+    auto scratch = static_cast<char *>(workspace.get(grouped_workspace_size(plan, threads)));
+    auto offsets = reinterpret_cast<int64_t *>(scratch + plan.pack_bytes * threads);
+    auto tiles = reinterpret_cast<GroupedTile *>(scratch + plan.pack_bytes * threads + plan.offsets_bytes);
+    read_seq_offsets(plan.cu_seqlens, cu_seqlens, offsets, plan.rows);
+
+    // panels narrowed until every thread has a few tiles to balance
+    auto tiles_of = [&](int64_t n_block) {
+        int64_t tiles = 0;
+        for (uint64_t g = 0; g < groups; ++g) {
+            tiles += ROUND_UP_DIV(offsets[g + 1] - offsets[g], plan.m_block) * ROUND_UP_DIV(n, n_block);
+        }
+        return tiles;
+    };
+    int64_t n_block = plan.n_block;
+    while (n_block > 1 && tiles_of(n_block) < 4 * threads) {
+        n_block = ROUND_UP_DIV(n_block, 2);
+    }
+    int64_t count = 0;
+    ASSERT(uint64_t(tiles_of(n_block)) <= grouped_tiles(plan, threads));
+    for (uint64_t g = 0; g < groups; ++g) {
+        uint64_t matrix = g;
+        if (plan.indexed) {
+            auto index = reinterpret_cast<char const *>(b_index) + g * plan.index_stride;
+            matrix = plan.index_size == 8 ? *reinterpret_cast<int64_t const *>(index) : *reinterpret_cast<int32_t const *>(index);
+        }
+        ASSERT(matrix < plan.matrices);
+        for (int64_t n0 = 0; n0 < n; n0 += n_block) {
+            for (auto m0 = offsets[g]; m0 < offsets[g + 1]; m0 += plan.m_block) {
+                tiles[count++] = {uint32_t(g), uint32_t(matrix), m0, std::min<int64_t>(m0 + plan.m_block, offsets[g + 1]), n0, std::min(n0 + n_block, n)};
+            }
+        }
+    }
+
+    auto pack_a = plan.a_col_stride != 1,
+         pack_b = plan.b_row_stride != 1;
+    auto a_bytes = align_workspace(pack_a ? size_t(plan.m_block) * k * sizeof(T) : 0);
+    for (int thread = 0; thread < threads; ++thread) {
+        *reinterpret_cast<PackedTiles *>(scratch + thread * plan.pack_bytes) = {-1, -1};
+    }
+
+    auto a_ = reinterpret_cast<T const *>(a);
+    auto c_ = reinterpret_cast<T *>(c);
+    parallel_for(count, [&](int64_t begin, int64_t end, int thread) {
+        auto slice = scratch + thread * plan.pack_bytes;
+        auto &packed = *reinterpret_cast<PackedTiles *>(slice);
+        auto a_pack = reinterpret_cast<T *>(slice + WORKSPACE_ALIGNMENT);
+        auto b_pack = reinterpret_cast<T *>(slice + WORKSPACE_ALIGNMENT + a_bytes);
+        for (auto task = begin; task < end; ++task) {
+            auto const &tile = tiles[task];
+            auto b_ = reinterpret_cast<T const *>(b) + tile.matrix * plan.b_stride;
+            // rows belong to one group only, so their first is key enough
+            int64_t b_key = int64_t(tile.g) * n + tile.n0;
+            if (pack_a && packed.a_key != tile.m0) {
+                for (int64_t k_ = 0; k_ < k; ++k_) {
+                    for (auto m_ = tile.m0; m_ < tile.m1; ++m_) {
+                        a_pack[(m_ - tile.m0) * k + k_] = a_[m_ * plan.a_row_stride + k_ * plan.a_col_stride];
+                    }
+                }
+                packed.a_key = tile.m0;
+            }
+            if (pack_b && packed.b_key != b_key) {
+                for (int64_t k_ = 0; k_ < k; ++k_) {
+                    for (auto n_ = tile.n0; n_ < tile.n1; ++n_) {
+                        b_pack[(n_ - tile.n0) * k + k_] = b_[n_ * plan.b_col_stride + k_ * plan.b_row_stride];
+                    }
+                }
+                packed.b_key = b_key;
+            }
+
+            for (auto m_ = tile.m0; m_ < tile.m1; ++m_) {
+                auto a_row = pack_a ? a_pack + (m_ - tile.m0) * k : a_ + m_ * plan.a_row_stride;
+                for (auto n_ = tile.n0; n_ < tile.n1; ++n_) {
+                    auto b_col = pack_b ? b_pack + (n_ - tile.n0) * k : b_ + n_ * plan.b_col_stride;
+                    store(c_ + m_ * plan.c_row_stride + n_ * plan.c_col_stride, beta, alpha, dot(a_row, b_col, k));
+                }
+            }
+        }
+    });
+}
+
+// The choices of a plan the autotuner makes, in the order the tuning cache
+// stores them: rows of a task, bytes of its panel of b, whether m tiles are
+// outermost, and threads.
+enum MatmulCpuChoice {
+    M_BLOCK,
+    PANEL_BYTES,
+    M_OUTER,
+    THREADS,
+    CHOICES,
+};
+
+// strides of `scales` against the quantized `b`, broadcast along every
+// dimension it has 1 of, and turned as `info` turned b; a batch of one
+// dimension at most, which b shares with c
+static MatmulCpuScales plan_scales(TensorLayout const *scales, TensorLayout const *b, MatmulInfo const &info) {
+    ASSERT(dtype_eq(scales->dt, F32));
+    ASSERT_EQ(scales->ndim, b->ndim);
+    ASSERT(b->ndim <= 3 && info.c_matrix.batch_ndim <= 1);
+    int64_t strides[3]{};
+    for (uint64_t i = 0; i < scales->ndim; ++i) {
+        ASSERT(scales->shape[i] == b->shape[i] || scales->shape[i] == 1);
+        strides[3 - scales->ndim + i] = scales->shape[i] == 1 ? 0 : scales->strides[i] / int64_t(sizeof(float));
+    }
+    return info.is_transed ? MatmulCpuScales{strides[0], strides[2], strides[1]}
+                           : MatmulCpuScales{strides[0], strides[1], strides[2]};
+}
+
+static MatmulCpuPlan plan_matmul_cpu(TensorLayout *c, TensorLayout *a, TensorLayout *b, TensorLayout *b_scales, std::vector<int> const &choices) {
+    auto quantized = is_quantized(b->dt);
+    // integers have no range of their own
+    ASSERT(b_scales || !dtype_eq(b->dt, I8));
+    ASSERT(quantized || !b_scales);
+
+    MatmulCpuPlan plan;
+    plan.info = MatmulInfo(c, a, b);
+    auto const &info = plan.info;
+    auto contiguous_k = info.a_matrix.col_stride == 1 && info.b_matrix.row_stride == 1;
+    plan.scaled = b_scales != nullptr;
+    plan.scales = b_scales ? plan_scales(b_scales, b, info) : MatmulCpuScales{0, 0, 0};
+
+    // the kernels take a and b as `info` has them, swapped or not
+    auto a_dt = info.is_transed ? b->dt : a->dt,
+         b_dt = info.is_transed ? a->dt : b->dt;
+    dispatch_float(c->dt, [&](auto c_) {
+        using C = decltype(c_);
+        if (quantized) {
+            dispatch_float(a->dt, [&](auto t) {
+                dispatch_quantized(b->dt, [&](auto q) {
+                    plan.kernel = matmul_dequant<C, decltype(t), decltype(q)>;
+                });
+            });
+        } else {
+            dispatch_float(a_dt, [&](auto a_) {
+                dispatch_float(b_dt, [&](auto b_) {
+                    using A = decltype(a_);
+                    using B = decltype(b_);
+                    plan.kernel = contiguous_k ? matmul_dot<C, A, B> : matmul_packed<C, A, B>;
+                });
+            });
+        }
+    });
+
+    // a task sweeps some rows of a over a panel of b that fits in cache,
+    // panels are narrowed until every thread has a few tasks to balance
+    plan.threads = std::clamp(choices[THREADS], 1, ThreadPool::instance().threads());
+    plan.m_block = std::clamp(choices[M_BLOCK], 1, std::max(1, info.m));
+    plan.m_tiles = ROUND_UP_DIV(info.m, plan.m_block);
+    // a quantized panel is read in its own type but copied as f32
+    auto a_size = quantized ? int(sizeof(float)) : int(a_dt.size),
+         b_size = quantized ? int(sizeof(float)) : int(b_dt.size);
+    plan.n_block = std::clamp(choices[PANEL_BYTES] / std::max(1, info.k * b_size), 1, std::max(1, info.n));
+    while (plan.n_block > 1 && info.batch * plan.m_tiles * ROUND_UP_DIV(info.n, plan.n_block) < 4 * plan.threads) {
+        plan.n_block = ROUND_UP_DIV(plan.n_block, 2);
+    }
+    plan.n_tiles = ROUND_UP_DIV(info.n, plan.n_block);
+    plan.tasks = info.batch * plan.m_tiles * plan.n_tiles;
+    plan.m_outer = choices[M_OUTER];
+    plan.pack_bytes = 0;
+    if (quantized) {
+        plan.pack_bytes = WORKSPACE_ALIGNMENT +
+                          align_workspace(size_t(plan.m_block) * info.k * a_size) +
+                          align_workspace(size_t(plan.n_block) * info.k * b_size);
+    } else if (!contiguous_k) {
+        plan.pack_bytes = WORKSPACE_ALIGNMENT +
+                          align_workspace(info.a_matrix.col_stride != 1 ? size_t(plan.m_block) * info.k * a_size : 0) +
+                          align_workspace(info.b_matrix.row_stride != 1 ? size_t(plan.n_block) * info.k * b_size : 0);
+    }
+    return plan;
+}
+
+// choices made without tuning
+static std::vector<int> default_choices(MatmulInfo const &info) {
+    std::vector<int> choices(CHOICES);
+    choices[M_BLOCK] = A_BLOCK_ROWS;
+    choices[PANEL_BYTES] = B_PANEL_BYTES;
+    choices[M_OUTER] = int64_t(info.m) * info.a_matrix.batch > int64_t(info.n) * info.b_matrix.batch;
+    choices[THREADS] = ThreadPool::instance().threads();
+    return choices;
+}
+
+MatmulCpuPlan plan_matmul_cpu(TensorLayout *c, TensorLayout *a, TensorLayout *b, TensorLayout *b_scales) {
+    return plan_matmul_cpu(c, a, b, b_scales, default_choices(MatmulInfo(c, a, b)));
+}
+
+static char const *dt_name(DataLayout dt) {
+    return dtype_eq(dt, F32)      ? "f32"
+           : dtype_eq(dt, F16)    ? "f16"
+           : dtype_eq(dt, BF16)   ? "bf16"
+           : dtype_eq(dt, I8)     ? "i8"
+           : dtype_eq(dt, F8E4M3) ? "e4m3"
+                                  : "e5m2";
+}
+
+// "matmul f16 1x1x4096x4096 kk t8": batch, m, n, k, whether a and b are
+// contiguous along k, and threads, which with the data types fix a plan;
+// "matmul f16.i8 ..." for a b of another type, "matmul f32.f16.f16 ..."
+// when a differs from c too
+static std::string tuning_key(TensorLayout *c, TensorLayout *a, TensorLayout *b, MatmulInfo const &info) {
+    std::string dt = dt_name(c->dt);
+    if (!dtype_eq(c->dt, a->dt)) {
+        dt = dt + '.' + dt_name(a->dt) + '.' + dt_name(b->dt);
+    } else if (!dtype_eq(c->dt, b->dt)) {
+        dt = dt + '.' + dt_name(b->dt);
+    }
+    return "matmul " + dt + ' ' +
+           std::to_string(info.batch) + 'x' + std::to_string(info.m) + 'x' + std::to_string(info.n) + 'x' + std::to_string(info.k) + ' ' +
+           (info.a_matrix.col_stride == 1 ? 'k' : 'm') + (info.b_matrix.row_stride == 1 ? 'k' : 'n') +
+           " t" + std::to_string(ThreadPool::instance().threads());
+}
+
+// bytes from the first element of a tensor to past its last
+static size_t span_bytes(TensorLayout const *layout) {
+    size_t span = layout->dt.size;
+    for (uint64_t i = 0; i < layout->ndim; ++i) {
+        span += (layout->shape[i] - 1) * size_t(layout->strides[i]);
+    }
+    return span;
+}
+
+// the fastest choices for these layouts, timed on scratch tensors
+static std::vector<int> tune_matmul_cpu(TensorLayout *c, TensorLayout *a, TensorLayout *b, TensorLayout *b_scales) {
+    MatmulInfo info(c, a, b);
+    std::vector<char> c_data(span_bytes(c)), a_data(span_bytes(a)), b_data(span_bytes(b)),
+        scales_data(b_scales ? span_bytes(b_scales) : 0);
+    info.bind(c_data.data(), a_data.data(), b_data.data());
+
+    std::vector<std::vector<int>> candidates(CHOICES);
+    candidates[M_BLOCK] = {1, 4, 8, 16, 32, 64};
+    candidates[PANEL_BYTES] = {32 << 10, 64 << 10, 128 << 10, 256 << 10, 512 << 10, 1 << 20};
+    candidates[M_OUTER] = {0, 1};
+    for (int threads = ThreadPool::instance().threads(); threads > 0; threads /= 2) {
+        candidates[THREADS].push_back(threads);
+    }
+    return tune(default_choices(info), candidates, [&](std::vector<int> const &choices) {
+        auto plan = plan_matmul_cpu(c, a, b, b_scales, choices);
+        return time_best([&] { plan.kernel(plan, info, scales_data.data(), 0, 1, Workspace{nullptr, 0}); });
+    });
+}
+
+MatmulCpuDescriptor *create_matmul_cpu_descriptor(Device device, MatmulConfig const *config) {
+    auto descriptor = new MatmulCpuDescriptor{device};
+    if (config && config->cu_seqlens) {
+        descriptor->grouped = plan_matmul_grouped_cpu(config->c, config->a, config->b, config->cu_seqlens, config->b_index);
+    } else if (config) {
+        auto key = tuning_key(config->c, config->a, config->b, MatmulInfo(config->c, config->a, config->b));
+        auto choices = tuning_lookup(key);
+        if ((!choices || choices->size() != CHOICES) && autotuning()) {
+            choices = tune_matmul_cpu(config->c, config->a, config->b, config->b_scales);
+            tuning_store(key, *choices);
+        }
+        descriptor->plan = choices && choices->size() == CHOICES
+                               ? plan_matmul_cpu(config->c, config->a, config->b, config->b_scales, *choices)
+                               : plan_matmul_cpu(config->c, config->a, config->b, config->b_scales);
+    }
+    return descriptor;
+}
+
+MatmulGroupedCpuPlan plan_matmul_grouped_cpu(TensorLayout const *c, TensorLayout const *a, TensorLayout const *b,
+                                             TensorLayout const *cu_seqlens, TensorLayout const *b_index) {
+    ASSERT_EQ(c->ndim, 2);
+    ASSERT_EQ(a->ndim, 2);
+    ASSERT_EQ(b->ndim, 3);
+    ASSERT(dtype_eq(c->dt, a->dt));
+    ASSERT(dtype_eq(c->dt, b->dt));
+    auto size = int64_t(c->dt.size);
+
+    MatmulGroupedCpuPlan plan{};
+    plan.rows = c->shape[0];
+    plan.n = c->shape[1];
+    plan.k = a->shape[1];
+    plan.matrices = b->shape[0];
+    ASSERT_EQ(a->shape[0], plan.rows);
+    ASSERT_EQ(b->shape[1], plan.k);
+    ASSERT_EQ(b->shape[2], plan.n);
+    plan.c_row_stride = c->strides[0] / size;
+    plan.c_col_stride = c->strides[1] / size;
+    plan.a_row_stride = a->strides[0] / size;
+    plan.a_col_stride = a->strides[1] / size;
+    plan.b_stride = b->strides[0] / size;
+    plan.b_row_stride = b->strides[1] / size;
+    plan.b_col_stride = b->strides[2] / size;
+
+    plan.cu_seqlens = plan_seq_offsets(cu_seqlens);
+    plan.offsets_bytes = seq_offsets_bytes(plan.cu_seqlens);
+    plan.indexed = b_index != nullptr;
+    if (b_index) {
+        ASSERT_EQ(b_index->ndim, 1);
+        ASSERT_EQ(b_index->shape[0], plan.cu_seqlens.sequences);
+        ASSERT(dtype_eq(b_index->dt, I32) || dtype_eq(b_index->dt, I64));
+        plan.index_stride = b_index->strides[0];
+        plan.index_size = b_index->dt.size;
+    } else {
+        ASSERT_EQ(plan.cu_seqlens.sequences, plan.matrices);
+    }
+
+    plan.m_block = A_BLOCK_ROWS;
+    plan.n_block = std::clamp(B_PANEL_BYTES / std::max(1, int(plan.k * size)), 1, std::max(1, int(plan.n)));
+    plan.max_tiles = (ROUND_UP_DIV(plan.rows, uint64_t(plan.m_block)) + plan.cu_seqlens.sequences) * ROUND_UP_DIV(plan.n, uint64_t(plan.n_block));
+    plan.pack_bytes = WORKSPACE_ALIGNMENT +
+                      align_workspace(plan.a_col_stride != 1 ? size_t(plan.m_block) * plan.k * size : 0) +
+                      align_workspace(plan.b_row_stride != 1 ? size_t(plan.n_block) * plan.k * size : 0);
+    dispatch_float(c->dt, [&](auto t) {
+        plan.kernel = matmul_grouped<decltype(t)>;
+    });
+    return plan;
+}
+
+uint64_t get_matmul_cpu_workspace_size(MatmulCpuDescriptor const *descriptor) {
+    auto threads = ThreadPool::instance().threads();
+    return descriptor->plan      ? descriptor->plan->pack_bytes * threads
+           : descriptor->grouped ? grouped_workspace_size(*descriptor->grouped, threads)
+                                 : 0;
+}
+
+void matmul_cpu(MatmulCpuDescriptor const *descriptor, void *workspace, uint64_t workspace_size,
+                Tensor c, float beta, Tensor a, Tensor b, Tensor b_scales, float alpha, void *stream) {
+    launch(
+        descriptor->plan, [&] { return plan_matmul_cpu(c.layout, a.layout, b.layout, b_scales.layout); }, stream,
+        Workspace{workspace, workspace_size}, {c.data, a.data, b.data, b_scales.data},
+        [beta, alpha](MatmulCpuPlan const &plan, void *const *data, Workspace const &workspace) {
+            auto info = plan.info;
+            info.bind(data[0], data[1], data[2]);
+            plan.kernel(plan, info, data[3], beta, alpha, workspace);
+        });
+}
+
+void matmul_grouped_cpu(MatmulCpuDescriptor const *descriptor, void *workspace, uint64_t workspace_size,
+                        Tensor c, float beta, Tensor a, Tensor b, Tensor cu_seqlens, Tensor b_index, float alpha, void *stream) {
+    launch(
+        descriptor->grouped, [&] { return plan_matmul_grouped_cpu(c.layout, a.layout, b.layout, cu_seqlens.layout, b_index.layout); }, stream,
+        Workspace{workspace, workspace_size}, {c.data, a.data, b.data, cu_seqlens.data, b_index.data},
+        [beta, alpha](MatmulGroupedCpuPlan const &plan, void *const *data, Workspace const &workspace) {
+            plan.kernel(plan, data[0], data[1], data[2], data[3], data[4], beta, alpha, workspace);
+        });
+}
@@ -1,11 +1,84 @@
 #ifndef __CPU_MATMUL_H__
 #define __CPU_MATMUL_H__
 
+#include "../../../devices/cpu/arena.h"
+#include "../../../devices/cpu/seqlens.h"
+#include "../blas.h"
 #include "operators.h"
+#include "ops/matmul/matmul.h"
+#include <optional>
+
+struct MatmulCpuPlan;
+typedef void (*MatmulCpuKernel)(MatmulCpuPlan const &plan, MatmulInfo const &info, void const *scales,
+                                float beta, float alpha, Workspace const &workspace);
+
+// element strides of the scales of a quantized b, or of a once `info`
+// swapped them, oriented as that matrix is; 0 along shared dimensions
+struct MatmulCpuScales {
+    int64_t stride, row_stride, col_stride;
+};
+
+// everything a matmul call needs besides the data, derived from the layouts once
+struct MatmulCpuPlan {
+    MatmulInfo info;
+    MatmulCpuKernel kernel;
+    // tile of c computed by one task
+    int m_block, n_block;
+    int m_tiles, n_tiles, tasks;
+    // whether tasks walk m tiles in the outer loop, set when a is the larger operand
+    bool m_outer;
+    // threads the tasks are spread over
+    int threads;
+    // workspace of each thread for copies of operands strided along k
+    size_t pack_bytes;
+    // whether scales multiply the quantized operand
+    bool scaled;
+    MatmulCpuScales scales;
+};
+
+struct MatmulGroupedCpuPlan;
+typedef void (*MatmulGroupedCpuKernel)(MatmulGroupedCpuPlan const &plan, void *c, void const *a, void const *b, void const *cu_seqlens,
+                                       void const *b_index, float beta, float alpha, Workspace const &workspace);
+
+// everything a grouped matmul call needs besides the data and the groups,
+// which are only known once the offsets are read
+struct MatmulGroupedCpuPlan {
+    uint64_t rows, n, k, matrices;
+    // element strides of c and a, and of b between matrices too
+    int64_t c_row_stride, c_col_stride, a_row_stride, a_col_stride, b_stride, b_row_stride, b_col_stride;
+    SeqOffsetsCpuLayout cu_seqlens;
+    // whether groups pick their matrix of b, and the byte stride and size of the indices
+    bool indexed;
+    int64_t index_stride;
+    uint64_t index_size;
+    // largest tile of c computed by one task, panels narrowed when groups are few
+    int m_block, n_block;
+    // tiles of these panels at most, however the rows are grouped
+    uint64_t max_tiles;
+    // workspace of each thread, followed by the group offsets and the tiles
+    size_t pack_bytes, offsets_bytes;
+    MatmulGroupedCpuKernel kernel;
+};
+
 typedef struct MatmulCpuDescriptor {
     Device device;
+    std::optional<MatmulCpuPlan> plan;
+    std::optional<MatmulGroupedCpuPlan> grouped;
 } MatmulCpuDescriptor;
 
-void matmul_cpu_f16(Tensor c, float beta, Tensor a, Tensor b, float alpha);
+MatmulCpuPlan plan_matmul_cpu(TensorLayout *c, TensorLayout *a, TensorLayout *b, TensorLayout *b_scales);
+
+MatmulGroupedCpuPlan plan_matmul_grouped_cpu(TensorLayout const *c, TensorLayout const *a, TensorLayout const *b,
+                                             TensorLayout const *cu_seqlens, TensorLayout const *b_index);
+
+MatmulCpuDescriptor *create_matmul_cpu_descriptor(Device device, MatmulConfig const *config);
+
+uint64_t get_matmul_cpu_workspace_size(MatmulCpuDescriptor const *descriptor);
+
+void matmul_cpu(MatmulCpuDescriptor const *descriptor, void *workspace, uint64_t workspace_size,
+                Tensor c, float beta, Tensor a, Tensor b, Tensor b_scales, float alpha, void *stream);
+
+void matmul_grouped_cpu(MatmulCpuDescriptor const *descriptor, void *workspace, uint64_t workspace_size,
+                        Tensor c, float beta, Tensor a, Tensor b, Tensor cu_seqlens, Tensor b_index, float alpha, void *stream);
 
 #endif// __CPU_MATMUL_H__
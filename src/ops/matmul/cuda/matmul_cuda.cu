@@ -3,21 +3,35 @@
 #include "../blas.h"
 #include "matmul_cuda.h"
 #include <cublas_v2.h>
-#include <cuda_fp16.h>
 
 MatmulCudaDescriptor::MatmulCudaDescriptor(Device device) {
     this->device = device;
     get_cublas_pool();
 }
 
-void matmul_nv_gpu_f16(Tensor c, float beta, Tensor a, Tensor b, float alpha, void *stream) {
-    auto info = MatmulInfo(c, a, b);
+static cudaDataType cuda_data_type(DataLayout dt) {
+    if (dtype_eq(dt, F16)) {
+        return CUDA_R_16F;
+    } else if (dtype_eq(dt, BF16)) {
+        return CUDA_R_16BF;
+    } else if (dtype_eq(dt, F32)) {
+        return CUDA_R_32F;
+    }
+    PANIC(UnsupportedDataType);
+    return CUDA_R_32F;
+}
 
-    auto alpha_f16 = __float2half(alpha);
-    auto beta_f16 = __float2half(beta);
+void matmul_nv_gpu(Tensor c, float beta, Tensor a, Tensor b, float alpha, void *stream) {
+    auto info = MatmulInfo(c, a, b);
+    // a strided batch is one dimension
+    ASSERT(info.c_matrix.batch_ndim <= 1);
+    // cublas multiplies inputs of one type, into c of that type or F32
+    ASSERT(dtype_eq(a.layout->dt, b.layout->dt));
 
     auto op_a = info.a_matrix.row_stride == 1 ? CUBLAS_OP_N : CUBLAS_OP_T;
     auto op_b = info.b_matrix.row_stride == 1 ? CUBLAS_OP_N : CUBLAS_OP_T;
+    auto input_type = cuda_data_type(a.layout->dt),
+         output_type = cuda_data_type(c.layout->dt);
 
     use_cublas((cudaStream_t) stream,
                [&](cublasHandle_t handle) { cublasGemmStridedBatchedEx(
@@ -27,21 +41,21 @@ void matmul_nv_gpu_f16(Tensor c, float beta, Tensor a, Tensor b, float alpha, vo
                                                 info.m,
                                                 info.n,
                                                 info.k,
-                                                &alpha_f16,
+                                                &alpha,
                                                 info.a_ptr,
-                                                CUDA_R_16F,
+                                                input_type,
                                                 info.a_matrix.ld(),
                                                 info.a_matrix.stride,
                                                 info.b_ptr,
-                                                CUDA_R_16F,
+                                                input_type,
                                                 info.b_matrix.ld(),
                                                 info.b_matrix.stride,
-                                                &beta_f16,
+                                                &beta,
                                                 info.c_ptr,
-                                                CUDA_R_16F,
+                                                output_type,
                                                 info.c_matrix.ld(),
                                                 info.c_matrix.stride,
                                                 info.batch,
-                                                CUBLAS_COMPUTE_16F,
+                                                CUBLAS_COMPUTE_32F,
                                                 CUBLAS_GEMM_DEFAULT_TENSOR_OP); });
 }
@@ -8,6 +8,6 @@ typedef struct MatmulCudaDescriptor {
     MatmulCudaDescriptor(Device device);
 } MatmulCudaDescriptor;
 
-void matmul_nv_gpu_f16(Tensor c, float beta, Tensor a, Tensor b, float alpha, void *stream);
+void matmul_nv_gpu(Tensor c, float beta, Tensor a, Tensor b, float alpha, void *stream);
 
 #endif// __NV_GPU_MATMUL_H__
@@ -1,3 +1,4 @@
+#include "../profile.h"
 #include "../utils.h"
 #include "ops/matmul/matmul.h"
 
@@ -20,7 +21,7 @@ __C MatmulDescriptor *createMatmulDescriptor(Device device, void *config) {
     switch (device) {
 #ifdef ENABLE_CPU
         case DevCpu:
-            return (MatmulDescriptor *) (new MatmulCpuDescriptor{device});
+            return (MatmulDescriptor *) create_matmul_cpu_descriptor(device, (MatmulConfig const *) config);
 #endif
 #ifdef ENABLE_NV_GPU
         case DevNvGpu: {
@@ -61,16 +62,34 @@ __C void destroyMatmulDescriptor(MatmulDescriptor *descriptor) {
     }
 }
 
-__C void matmul(MatmulDescriptor *descriptor, Tensor c, float beta, Tensor a, Tensor b, float alpha, void *stream) {
+__C void getMatmulWorkspaceSize(MatmulDescriptor *descriptor, uint64_t *size) {
     switch (descriptor->device) {
 #ifdef ENABLE_CPU
         case DevCpu:
-            matmul_cpu_f16(c, beta, a, b, alpha);
+            *size = get_matmul_cpu_workspace_size((MatmulCpuDescriptor *) descriptor);
+            break;
+#endif
+        default:
+            *size = 0;
+    }
+}
+
+__C void matmul(MatmulDescriptor *descriptor, void *workspace, uint64_t workspace_size, Tensor c, float beta, Tensor a, Tensor b, float alpha, void *stream) {
+    ProfileScope profile("matmul", [&] {
+        auto k = a.layout->shape[a.layout->ndim - 1];
+        return OpCost{shape_bucket(c.layout) + " k" + std::to_string(pow2_bucket(k)),
+                      tensor_bytes(a.layout) + tensor_bytes(b.layout) + (beta == 0 ? 1 : 2) * tensor_bytes(c.layout),
+                      2.0 * tensor_elements(c.layout) * k};
+    });
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            matmul_cpu((MatmulCpuDescriptor *) descriptor, workspace, workspace_size, c, beta, a, b, Tensor{nullptr, nullptr}, alpha, stream);
             break;
 #endif
 #ifdef ENABLE_NV_GPU
         case DevNvGpu:
-            matmul_nv_gpu_f16(c, beta, a, b, alpha, stream);
+            matmul_nv_gpu(c, beta, a, b, alpha, stream);
             break;
 #endif
 #ifdef ENABLE_CAMBRICON_MLU
@@ -82,3 +101,42 @@ __C void matmul(MatmulDescriptor *descriptor, Tensor c, float beta, Tensor a, Te
             PANIC(UnsupportedDevice);
     }
 }
+
+__C void matmulDequant(MatmulDescriptor *descriptor, void *workspace, uint64_t workspace_size,
+                       Tensor c, float beta, Tensor a, Tensor b, Tensor b_scales, float alpha, void *stream) {
+    ProfileScope profile("matmul_dequant", [&] {
+        auto k = a.layout->shape[a.layout->ndim - 1];
+        return OpCost{shape_bucket(c.layout) + " k" + std::to_string(pow2_bucket(k)),
+                      tensor_bytes(a.layout) + tensor_bytes(b.layout) + (b_scales.layout ? tensor_bytes(b_scales.layout) : 0) +
+                          (beta == 0 ? 1 : 2) * tensor_bytes(c.layout),
+                      2.0 * tensor_elements(c.layout) * k};
+    });
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            matmul_cpu((MatmulCpuDescriptor *) descriptor, workspace, workspace_size, c, beta, a, b, b_scales, alpha, stream);
+            break;
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+}
+
+__C void matmulGrouped(MatmulDescriptor *descriptor, void *workspace, uint64_t workspace_size,
+                       Tensor c, float beta, Tensor a, Tensor b, Tensor cu_seqlens, Tensor b_index, float alpha, void *stream) {
+    ProfileScope profile("matmul_grouped", [&] {
+        auto k = a.layout->shape[1];
+        return OpCost{shape_bucket(c.layout) + " k" + std::to_string(pow2_bucket(k)) + " g" + std::to_string(pow2_bucket(cu_seqlens.layout->shape[0] - 1)),
+                      tensor_bytes(a.layout) + tensor_bytes(b.layout) + (beta == 0 ? 1 : 2) * tensor_bytes(c.layout),
+                      2.0 * tensor_elements(c.layout) * k};
+    });
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            matmul_grouped_cpu((MatmulCpuDescriptor *) descriptor, workspace, workspace_size, c, beta, a, b, cu_seqlens, b_index, alpha, stream);
+            break;
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+}
@@ -0,0 +1,280 @@
+#include "moe_cpu.h"
+#include "../../../devices/cpu/common_cpu.h"
+#include "../../../devices/cpu/stream.h"
+#include "../../../devices/cpu/thread_pool.h"
+#include "../../utils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+// elements of a row combined at a time, their sums kept in registers
+constexpr static uint64_t MOE_COMBINE_BLOCK = 256;
+
+template<class T>
+static T *row(void *base, int64_t stride, uint64_t i) {
+    return reinterpret_cast<T *>(reinterpret_cast<char *>(base) + i * stride);
+}
+
+template<class T>
+static T const *row(void const *base, int64_t stride, uint64_t i) {
+    return reinterpret_cast<T const *>(reinterpret_cast<char const *>(base) + i * stride);
+}
+
+static int64_t load_index(MoeIndexCpuLayout const &layout, void const *base, uint64_t t, uint64_t j) {
+    auto p = reinterpret_cast<char const *>(base) + t * layout.row_stride + j * layout.col_stride;
+    return layout.size == 8 ? *reinterpret_cast<int64_t const *>(p) : *reinterpret_cast<int32_t const *>(p);
+}
+
+static void store_index(MoeIndexCpuLayout const &layout, void *base, uint64_t t, uint64_t j, int64_t value) {
+    auto p = reinterpret_cast<char *>(base) + t * layout.row_stride + j * layout.col_stride;
+    if (layout.size == 8) {
+        *reinterpret_cast<int64_t *>(p) = value;
+    } else {
+        *reinterpret_cast<int32_t *>(p) = int32_t(value);
+    }
+}
+
+static MoeIndexCpuLayout plan_indices(TensorLayout const *layout, uint64_t tokens, uint64_t k) {
+    ASSERT_EQ(layout->ndim, 2);
+    ASSERT_EQ(layout->shape[0], tokens);
+    ASSERT_EQ(layout->shape[1], k);
+    ASSERT(dtype_eq(layout->dt, I32) || dtype_eq(layout->dt, I64));
+    return {layout->strides[0], layout->strides[1], layout->dt.size};
+}
+
+// The best k logits of every row are kept sorted as it is scanned, an
+// insertion each; k is small, so this beats a heap. Only a second pass
+// over the row exponentiates, for the softmax denominator.
+template<class T>
+static void moe_gate(MoeGateCpuPlan const &plan, void *weights, void *experts, void const *logits, bool normalize) {
+    parallel_for(plan.tokens, [&](int64_t begin, int64_t end) {
+        uint64_t best[MOE_MAX_TOP_K];
+        float best_logits[MOE_MAX_TOP_K];
+        for (auto t = begin; t < end; ++t) {
+            auto l = row<T>(logits, plan.logit_stride, t);
+            uint64_t kept = 0;
+            for (uint64_t e = 0; e < plan.experts; ++e) {
+                auto v = to_f32(l[e]);
+                // strictly better than the last kept, so equal logits keep their order
+                if (kept == plan.k && !(v > best_logits[kept - 1])) {
+                    continue;
+                }
+                auto i = kept < plan.k ? kept++ : kept - 1;
+                for (; i > 0 && best_logits[i - 1] < v; --i) {
+                    best[i] = best[i - 1];
+                    best_logits[i] = best_logits[i - 1];
+                }
+                best[i] = e;
+                best_logits[i] = v;
+            }
+
+            auto max = best_logits[0];
+            float sum = 0;
+            if (normalize) {
+                for (uint64_t j = 0; j < plan.k; ++j) {
+                    sum += std::exp(best_logits[j] - max);
+                }
+            } else {
+                for (uint64_t e = 0; e < plan.experts; ++e) {
+                    sum += std::exp(to_f32(l[e]) - max);
+                }
+            }
+            for (uint64_t j = 0; j < plan.k; ++j) {
+                *row<float>(row<char>(weights, plan.weight_row_stride, t), plan.weight_col_stride, j) = std::exp(best_logits[j] - max) / sum;
+                store_index(plan.indices, experts, t, j, int64_t(best[j]));
+            }
+        }
+    });
+}
+
+static uint64_t moe_permute_shares(MoePermuteCpuPlan const &plan) {
+    return std::clamp<uint64_t>(plan.tokens, 1, ThreadPool::instance().threads());
+}
+
+// A counting sort: each share of the tokens counts its rows by expert,
+// then writes them from the offset of its share within its expert, which
+// the counts of every share give. Rows of an expert stay in token order
+// however the tokens are shared out.
+static void moe_permute(MoePermuteCpuPlan const &plan, void *permuted, void *cu_seqlens, void *positions, void const *x, void const *experts,
+                        Workspace const &workspace) {
+    auto shares = moe_permute_shares(plan);
+    auto counts = static_cast<int64_t *>(workspace.get(shares * plan.experts * sizeof(int64_t)));
+    auto share_begin = [&](uint64_t s) { return plan.tokens * s / shares; };
+
+    parallel_for(shares, [&](int64_t begin, int64_t end) {
+        for (auto s = uint64_t(begin); s < uint64_t(end); ++s) {
+            auto count = counts + s * plan.experts;
+            std::fill(count, count + plan.experts, 0);
+            for (auto t = share_begin(s); t < share_begin(s + 1); ++t) {
+                for (uint64_t j = 0; j < plan.k; ++j) {
+                    auto e = load_index(plan.experts_layout, experts, t, j);
+                    ASSERT(e >= 0 && uint64_t(e) < plan.experts);
+                    ++count[e];
+                }
+            }
+        }
+    });
+
+    int64_t offset = 0;
+    for (uint64_t e = 0; e < plan.experts; ++e) {
+        store_index({0, plan.offset_stride, plan.offset_size}, cu_seqlens, 0, e, offset);
+        for (uint64_t s = 0; s < shares; ++s) {
+            auto count = counts[s * plan.experts + e];
+            counts[s * plan.experts + e] = offset;
+            offset += count;
+        }
+    }
+    store_index({0, plan.offset_stride, plan.offset_size}, cu_seqlens, 0, plan.experts, offset);
+
+    parallel_for(shares, [&](int64_t begin, int64_t end) {
+        for (auto s = uint64_t(begin); s < uint64_t(end); ++s) {
+            auto next = counts + s * plan.experts;
+            for (auto t = share_begin(s); t < share_begin(s + 1); ++t) {
+                for (uint64_t j = 0; j < plan.k; ++j) {
+                    auto position = next[load_index(plan.experts_layout, experts, t, j)]++;
+                    store_index(plan.positions, positions, t, j, position);
+                    std::memcpy(row<char>(permuted, plan.permuted_stride, position), row<char>(x, plan.x_stride, t), plan.row_bytes);
+                }
+            }
+        }
+    });
+}
+
+template<class T>
+static void moe_unpermute(MoeUnpermuteCpuPlan const &plan, void *y, void const *permuted, void const *positions, void const *weights) {
+    parallel_for(plan.tokens, [&](int64_t begin, int64_t end) {
+        T const *rows[MOE_MAX_TOP_K];
+        float w[MOE_MAX_TOP_K], sum[MOE_COMBINE_BLOCK];
+        for (auto t = begin; t < end; ++t) {
+            for (uint64_t j = 0; j < plan.k; ++j) {
+                auto position = load_index(plan.positions, positions, t, j);
+                ASSERT(position >= 0 && uint64_t(position) < plan.rows);
+                rows[j] = row<T>(permuted, plan.permuted_stride, position);
+                w[j] = *row<float>(row<char>(weights, plan.weight_row_stride, t), plan.weight_col_stride, j);
+            }
+            auto y_ = row<T>(y, plan.y_stride, t);
+            for (uint64_t block = 0; block < plan.d; block += MOE_COMBINE_BLOCK) {
+                auto n = std::min(MOE_COMBINE_BLOCK, plan.d - block);
+                std::fill(sum, sum + n, 0.0f);
+                for (uint64_t j = 0; j < plan.k; ++j) {
+                    auto r = rows[j] + block;
+                    for (uint64_t i = 0; i < n; ++i) {
+                        sum[i] += w[j] * to_f32(r[i]);
+                    }
+                }
+                for (uint64_t i = 0; i < n; ++i) {
+                    y_[block + i] = from_f32<T>(sum[i]);
+                }
+            }
+        }
+    });
+}
+
+MoeGateCpuPlan plan_moe_gate_cpu(TensorLayout const *weights, TensorLayout const *experts, TensorLayout const *logits) {
+    ASSERT_EQ(logits->ndim, 2);
+    ASSERT_EQ(weights->ndim, 2);
+    auto tokens = logits->shape[0],
+         k = weights->shape[1];
+    ASSERT_EQ(weights->shape[0], tokens);
+    ASSERT(k >= 1 && k <= std::min(logits->shape[1], MOE_MAX_TOP_K));
+    ASSERT(dtype_eq(weights->dt, F32));
+    ASSERT_EQ(logits->strides[1], logits->dt.size);
+
+    MoeGateCpuPlan plan{tokens, logits->shape[1], k, logits->strides[0], weights->strides[0], weights->strides[1], plan_indices(experts, tokens, k)};
+    dispatch_float(logits->dt, [&](auto t) {
+        plan.kernel = moe_gate<decltype(t)>;
+    });
+    return plan;
+}
+
+MoePermuteCpuPlan plan_moe_permute_cpu(TensorLayout const *permuted, TensorLayout const *cu_seqlens, TensorLayout const *positions,
+                                       TensorLayout const *x, TensorLayout const *experts) {
+    ASSERT_EQ(x->ndim, 2);
+    ASSERT_EQ(permuted->ndim, 2);
+    ASSERT_EQ(experts->ndim, 2);
+    ASSERT_EQ(cu_seqlens->ndim, 1);
+    auto tokens = x->shape[0],
+         k = experts->shape[1];
+    ASSERT_EQ(permuted->shape[0], tokens * k);
+    ASSERT_EQ(permuted->shape[1], x->shape[1]);
+    ASSERT(dtype_eq(permuted->dt, x->dt));
+    ASSERT_EQ(x->strides[1], x->dt.size);
+    ASSERT_EQ(permuted->strides[1], permuted->dt.size);
+    ASSERT(cu_seqlens->shape[0] >= 2);
+    ASSERT(dtype_eq(cu_seqlens->dt, I32) || dtype_eq(cu_seqlens->dt, I64));
+
+    return {tokens, cu_seqlens->shape[0] - 1, k, x->shape[1] * x->dt.size,
+            x->strides[0], permuted->strides[0], cu_seqlens->strides[0], cu_seqlens->dt.size,
+            plan_indices(experts, tokens, k), plan_indices(positions, tokens, k)};
+}
+
+MoeUnpermuteCpuPlan plan_moe_unpermute_cpu(TensorLayout const *y, TensorLayout const *permuted, TensorLayout const *positions, TensorLayout const *weights) {
+    ASSERT_EQ(y->ndim, 2);
+    ASSERT_EQ(permuted->ndim, 2);
+    ASSERT_EQ(weights->ndim, 2);
+    auto tokens = y->shape[0],
+         k = weights->shape[1];
+    ASSERT_EQ(weights->shape[0], tokens);
+    ASSERT(k >= 1 && k <= MOE_MAX_TOP_K);
+    ASSERT(dtype_eq(weights->dt, F32));
+    ASSERT_EQ(permuted->shape[1], y->shape[1]);
+    ASSERT(dtype_eq(permuted->dt, y->dt));
+    ASSERT_EQ(y->strides[1], y->dt.size);
+    ASSERT_EQ(permuted->strides[1], permuted->dt.size);
+
+    MoeUnpermuteCpuPlan plan{tokens, k, y->shape[1], permuted->shape[0],
+                             y->strides[0], permuted->strides[0], weights->strides[0], weights->strides[1],
+                             plan_indices(positions, tokens, k)};
+    dispatch_float(y->dt, [&](auto t) {
+        plan.kernel = moe_unpermute<decltype(t)>;
+    });
+    return plan;
+}
+
+MoeCpuDescriptor *create_moe_cpu_descriptor(Device device, MoeConfig const *config) {
+    auto descriptor = new MoeCpuDescriptor{device};
+    if (config) {
+        if (config->weights && config->experts && config->logits) {
+            descriptor->gate = plan_moe_gate_cpu(config->weights, config->experts, config->logits);
+        }
+        if (config->permuted && config->cu_seqlens && config->positions && config->x && config->experts) {
+            descriptor->permute = plan_moe_permute_cpu(config->permuted, config->cu_seqlens, config->positions, config->x, config->experts);
+        }
+        if (config->y && config->permuted && config->positions && config->weights) {
+            descriptor->unpermute = plan_moe_unpermute_cpu(config->y, config->permuted, config->positions, config->weights);
+        }
+    }
+    return descriptor;
+}
+
+uint64_t get_moe_cpu_workspace_size(MoeCpuDescriptor const *descriptor) {
+    if (!descriptor->permute) {
+        return 0;
+    }
+    return align_workspace(moe_permute_shares(*descriptor->permute) * descriptor->permute->experts * sizeof(int64_t));
+}
+
+void moe_gate_cpu(MoeCpuDescriptor const *descriptor, Tensor weights, Tensor experts, Tensor logits, bool normalize, void *stream) {
+    launch(
+        descriptor->gate, [&] { return plan_moe_gate_cpu(weights.layout, experts.layout, logits.layout); }, stream,
+        {weights.data, experts.data, logits.data},
+        [normalize](MoeGateCpuPlan const &plan, void *const *data) { plan.kernel(plan, data[0], data[1], data[2], normalize); });
+}
+
+void moe_permute_cpu(MoeCpuDescriptor const *descriptor, void *workspace, uint64_t workspace_size,
+                     Tensor permuted, Tensor cu_seqlens, Tensor positions, Tensor x, Tensor experts, void *stream) {
+    launch(
+        descriptor->permute, [&] { return plan_moe_permute_cpu(permuted.layout, cu_seqlens.layout, positions.layout, x.layout, experts.layout); }, stream,
+        Workspace{workspace, workspace_size}, {permuted.data, cu_seqlens.data, positions.data, x.data, experts.data},
+        [](MoePermuteCpuPlan const &plan, void *const *data, Workspace const &workspace) {
+            moe_permute(plan, data[0], data[1], data[2], data[3], data[4], workspace);
+        });
+}
+
+void moe_unpermute_cpu(MoeCpuDescriptor const *descriptor, Tensor y, Tensor permuted, Tensor positions, Tensor weights, void *stream) {
+    launch(
+        descriptor->unpermute, [&] { return plan_moe_unpermute_cpu(y.layout, permuted.layout, positions.layout, weights.layout); }, stream,
+        {y.data, permuted.data, positions.data, weights.data},
+        [](MoeUnpermuteCpuPlan const &plan, void *const *data) { plan.kernel(plan, data[0], data[1], data[2], data[3]); });
+}
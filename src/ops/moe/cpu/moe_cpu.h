@@ -0,0 +1,72 @@
+#ifndef __CPU_MOE_H__
+#define __CPU_MOE_H__
+
+#include "operators.h"
+#include "ops/moe/moe.h"
+#include <optional>
+
+// most experts a token may be routed to
+constexpr static uint64_t MOE_MAX_TOP_K = 64;
+
+// a (tokens, k) matrix of I32 or I64 indices: byte strides, element bytes
+struct MoeIndexCpuLayout {
+    int64_t row_stride, col_stride;
+    uint64_t size;
+};
+
+struct MoeGateCpuPlan;
+typedef void (*MoeGateCpuKernel)(MoeGateCpuPlan const &plan, void *weights, void *experts, void const *logits, bool normalize);
+
+struct MoeGateCpuPlan {
+    uint64_t tokens, experts, k;
+    // byte strides of the rows of logits, and of the weights
+    int64_t logit_stride, weight_row_stride, weight_col_stride;
+    MoeIndexCpuLayout indices;
+    MoeGateCpuKernel kernel;
+};
+
+// Rows are moved as bytes, whatever their type.
+struct MoePermuteCpuPlan {
+    uint64_t tokens, experts, k, row_bytes;
+    // byte strides of the rows of x and permuted, and of cu_seqlens
+    int64_t x_stride, permuted_stride, offset_stride;
+    uint64_t offset_size;
+    MoeIndexCpuLayout experts_layout, positions;
+};
+
+struct MoeUnpermuteCpuPlan;
+typedef void (*MoeUnpermuteCpuKernel)(MoeUnpermuteCpuPlan const &plan, void *y, void const *permuted, void const *positions, void const *weights);
+
+struct MoeUnpermuteCpuPlan {
+    uint64_t tokens, k, d, rows;
+    int64_t y_stride, permuted_stride, weight_row_stride, weight_col_stride;
+    MoeIndexCpuLayout positions;
+    MoeUnpermuteCpuKernel kernel;
+};
+
+struct MoeCpuDescriptor {
+    Device device;
+    std::optional<MoeGateCpuPlan> gate;
+    std::optional<MoePermuteCpuPlan> permute;
+    std::optional<MoeUnpermuteCpuPlan> unpermute;
+};
+
+MoeGateCpuPlan plan_moe_gate_cpu(TensorLayout const *weights, TensorLayout const *experts, TensorLayout const *logits);
+
+MoePermuteCpuPlan plan_moe_permute_cpu(TensorLayout const *permuted, TensorLayout const *cu_seqlens, TensorLayout const *positions,
+                                       TensorLayout const *x, TensorLayout const *experts);
+
+MoeUnpermuteCpuPlan plan_moe_unpermute_cpu(TensorLayout const *y, TensorLayout const *permuted, TensorLayout const *positions, TensorLayout const *weights);
+
+MoeCpuDescriptor *create_moe_cpu_descriptor(Device device, MoeConfig const *config);
+
+uint64_t get_moe_cpu_workspace_size(MoeCpuDescriptor const *descriptor);
+
+void moe_gate_cpu(MoeCpuDescriptor const *descriptor, Tensor weights, Tensor experts, Tensor logits, bool normalize, void *stream);
+
+void moe_permute_cpu(MoeCpuDescriptor const *descriptor, void *workspace, uint64_t workspace_size,
+                     Tensor permuted, Tensor cu_seqlens, Tensor positions, Tensor x, Tensor experts, void *stream);
+
+void moe_unpermute_cpu(MoeCpuDescriptor const *descriptor, Tensor y, Tensor permuted, Tensor positions, Tensor weights, void *stream);
+
+#endif// __CPU_MOE_H__
@@ -0,0 +1,97 @@
+#include "../profile.h"
+#include "../utils.h"
+#include "ops/moe/moe.h"
+
+#ifdef ENABLE_CPU
+#include "cpu/moe_cpu.h"
+#endif
+
+struct MoeDescriptor {
+    Device device;
+};
+
+__C void *createMoeDescriptor(Device device, void *config) {
+    switch (device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            return (MoeDescriptor *) create_moe_cpu_descriptor(device, (MoeConfig const *) config);
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+    return nullptr;
+}
+
+__C void destroyMoeDescriptor(MoeDescriptor *descriptor) {
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            delete (MoeCpuDescriptor *) (descriptor);
+            break;
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+}
+
+__C void getMoeWorkspaceSize(MoeDescriptor *descriptor, uint64_t *size) {
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            *size = get_moe_cpu_workspace_size((MoeCpuDescriptor *) descriptor);
+            break;
+#endif
+        default:
+            *size = 0;
+    }
+}
+
+__C void moeGate(MoeDescriptor *descriptor, void *workspace, uint64_t workspace_size,
+                 Tensor weights, Tensor experts, Tensor logits, int normalize, void *stream) {
+    ProfileScope profile("moe_gate", [&] {
+        return OpCost{shape_bucket(logits.layout), tensor_bytes(logits.layout) + tensor_bytes(weights.layout) + tensor_bytes(experts.layout),
+                      4 * tensor_elements(logits.layout)};
+    });
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            moe_gate_cpu((MoeCpuDescriptor *) descriptor, weights, experts, logits, normalize != 0, stream);
+            break;
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+}
+
+__C void moePermute(MoeDescriptor *descriptor, void *workspace, uint64_t workspace_size,
+                    Tensor permuted, Tensor cu_seqlens, Tensor positions, Tensor x, Tensor experts, void *stream) {
+    ProfileScope profile("moe_permute", [&] {
+        return OpCost{shape_bucket(permuted.layout), 2 * tensor_bytes(permuted.layout) + tensor_bytes(positions.layout) + tensor_bytes(experts.layout), 0};
+    });
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            moe_permute_cpu((MoeCpuDescriptor *) descriptor, workspace, workspace_size, permuted, cu_seqlens, positions, x, experts, stream);
+            break;
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+}
+
+__C void moeUnpermute(MoeDescriptor *descriptor, void *workspace, uint64_t workspace_size,
+                      Tensor y, Tensor permuted, Tensor positions, Tensor weights, void *stream) {
+    ProfileScope profile("moe_unpermute", [&] {
+        return OpCost{shape_bucket(y.layout), tensor_bytes(y.layout) + tensor_bytes(permuted.layout) + tensor_bytes(positions.layout) + tensor_bytes(weights.layout),
+                      2 * tensor_elements(permuted.layout)};
+    });
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            moe_unpermute_cpu((MoeCpuDescriptor *) descriptor, y, permuted, positions, weights, stream);
+            break;
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include "tensor.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+extern std::atomic<bool> profiling;
+
+// what `ProfileScope` records of a call besides its time
+struct OpCost {
+    std::string shape;
+    double bytes, flops;
+};
+
+int64_t profile_clock();
+
+void profile_record(char const *op, OpCost const &cost, int64_t begin, int64_t end);
+
+double tensor_elements(TensorLayout const *layout);
+
+inline double tensor_bytes(TensorLayout const *layout) {
+    return tensor_elements(layout) * layout->dt.size;
+}
+
+inline uint64_t pow2_bucket(uint64_t n) {
+    uint64_t bucket = 1;
+    while (bucket < n) {
+        bucket <<= 1;
+    }
+    return bucket;
+}
+
+// "f16 512x4096", every dimension rounded up to a power of two
+std::string shape_bucket(TensorLayout const *layout);
+
+// Times the operator call it is declared in while profiling is enabled,
+// `cost()` telling its shape bucket, bytes and flops. Costs nothing but
+// a load when it is not.
+class ProfileScope {
+public:
+    template<class F>
+    ProfileScope(char const *op, F const &cost) : _op(nullptr) {
+        if (profiling.load(std::memory_order_relaxed)) {
+            _cost = cost();
+            _op = op;
+            _begin = profile_clock();
+        }
+    }
+    ProfileScope(const ProfileScope &) = delete;
+
+    ~ProfileScope() {
+        if (_op) {
+            profile_record(_op, _cost, _begin, profile_clock());
+        }
+    }
+
+private:
+    char const *_op;
+    OpCost _cost;
+    int64_t _begin;
+};
+
+#endif// __PROFILE_H__
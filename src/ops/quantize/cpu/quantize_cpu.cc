@@ -0,0 +1,173 @@
+#include "quantize_cpu.h"
+#include "../../../devices/cpu/norm.h"
+#include "../../../devices/cpu/stream.h"
+#include <limits>
+
+template<class T>
+static T *row(void *base, int64_t stride, uint64_t i) {
+    return reinterpret_cast<T *>(reinterpret_cast<char *>(base) + i * stride);
+}
+
+template<class T>
+static T const *row(void const *base, int64_t stride, uint64_t i) {
+    return reinterpret_cast<T const *>(reinterpret_cast<char const *>(base) + i * stride);
+}
+
+// Quantizes the `d` numbers `value(j)` into `q`, setting the scale, and
+// the zero point if there is one. Each pass is a plain loop over the row,
+// so it vectorizes.
+template<class Q, class F>
+static void quantize_row(Q *q, float *scale, int32_t *zero, uint64_t d, F const &value) {
+    if (!zero) {
+        float max = 0;
+        for (uint64_t j = 0; j < d; ++j) {
+            max = std::max(max, std::fabs(value(j)));
+        }
+        *scale = max / 127;
+        auto inv = max == 0 ? 0 : 127 / max;
+        for (uint64_t j = 0; j < d; ++j) {
+            q[j] = Q(std::clamp(std::nearbyint(value(j) * inv), -127.0f, 127.0f));
+        }
+        return;
+    }
+
+    constexpr float q_min = std::numeric_limits<Q>::min(),
+                    q_max = std::numeric_limits<Q>::max();
+    float min = 0, max = 0;
+    for (uint64_t j = 0; j < d; ++j) {
+        auto v = value(j);
+        min = std::min(min, v);
+        max = std::max(max, v);
+    }
+    *scale = (max - min) / (q_max - q_min);
+    auto inv = max == min ? 0 : (q_max - q_min) / (max - min);
+    auto zero_ = std::nearbyint(q_min - min * inv);
+    *zero = int32_t(zero_);
+    for (uint64_t j = 0; j < d; ++j) {
+        q[j] = Q(std::clamp(std::nearbyint(value(j) * inv) + zero_, q_min, q_max));
+    }
+}
+
+template<class T, class Q>
+static void quantize(QuantizeCpuPlan const &plan, void *q, void *scales, void *zeros, void const *x, void const *, float) {
+    parallel_for(plan.n, [&](int64_t begin, int64_t end) {
+        for (auto i = begin; i < end; ++i) {
+            auto x_ = row<T>(x, plan.x_stride, i);
+            quantize_row(row<Q>(q, plan.q_stride, i), row<float>(scales, plan.scale_stride, i),
+                         plan.asymmetric ? row<int32_t>(zeros, plan.zero_stride, i) : nullptr, plan.d,
+                         [x_](uint64_t j) { return to_f32(x_[j]); });
+        }
+    });
+}
+
+// every row normalized as `rmsNorm` does on the fly, each pass over it
+// multiplying again instead of keeping a copy
+template<class T, class Q, class W>
+static void quantize_rms_norm(QuantizeCpuPlan const &plan, void *q, void *scales, void *zeros, void const *x, void const *w, float epsilon) {
+    auto w_ = reinterpret_cast<W const *>(w);
+    parallel_for(plan.n, [&](int64_t begin, int64_t end) {
+        for (auto i = begin; i < end; ++i) {
+            auto x_ = row<T>(x, plan.x_stride, i);
+            auto rms = rms_scale(x_, plan.d, epsilon);
+            quantize_row(row<Q>(q, plan.q_stride, i), row<float>(scales, plan.scale_stride, i),
+                         plan.asymmetric ? row<int32_t>(zeros, plan.zero_stride, i) : nullptr, plan.d,
+                         [x_, w_, rms](uint64_t j) { return to_f32(x_[j]) * rms * to_f32(w_[j]); });
+        }
+    });
+}
+
+template<class T, class Q>
+static void dequantize(QuantizeCpuPlan const &plan, void *x, void const *q, void const *scales, void const *zeros) {
+    parallel_for(plan.n, [&](int64_t begin, int64_t end) {
+        for (auto i = begin; i < end; ++i) {
+            auto x_ = row<T>(x, plan.x_stride, i);
+            auto q_ = row<Q>(q, plan.q_stride, i);
+            auto scale = *row<float>(scales, plan.scale_stride, i);
+            auto zero = plan.asymmetric ? float(*row<int32_t>(zeros, plan.zero_stride, i)) : 0.0f;
+            for (uint64_t j = 0; j < plan.d; ++j) {
+                x_[j] = from_f32<T>((float(q_[j]) - zero) * scale);
+            }
+        }
+    });
+}
+
+// call `f` with a value of the storage type of the integer `dt`
+template<class F>
+static void dispatch_integer(DataLayout dt, F &&f) {
+    if (dtype_eq(dt, I8)) {
+        f(int8_t{});
+    } else if (dtype_eq(dt, U8)) {
+        f(uint8_t{});
+    } else {
+        PANIC(UnsupportedDataType);
+    }
+}
+
+QuantizeCpuPlan plan_quantize_cpu(TensorLayout const *q, TensorLayout const *scales, TensorLayout const *zeros, TensorLayout const *x, TensorLayout const *w) {
+    ASSERT_EQ(q->ndim, 2);
+    ASSERT_EQ(x->ndim, 2);
+    ASSERT_EQ(scales->ndim, 1);
+    auto n = x->shape[0],
+         d = x->shape[1];
+    ASSERT_EQ(q->shape[0], n);
+    ASSERT_EQ(q->shape[1], d);
+    ASSERT_EQ(scales->shape[0], n);
+    ASSERT(dtype_eq(scales->dt, F32));
+    ASSERT_EQ(q->strides[1], q->dt.size);
+    ASSERT_EQ(x->strides[1], x->dt.size);
+
+    QuantizeCpuPlan plan{n, d, q->strides[0], x->strides[0], scales->strides[0], 0, zeros != nullptr};
+    if (zeros) {
+        ASSERT_EQ(zeros->ndim, 1);
+        ASSERT_EQ(zeros->shape[0], n);
+        ASSERT(dtype_eq(zeros->dt, I32));
+        plan.zero_stride = zeros->strides[0];
+    } else {
+        // symmetric around a zero only a signed type holds
+        ASSERT(dtype_eq(q->dt, I8));
+    }
+    if (w) {
+        ASSERT_EQ(w->ndim, 1);
+        ASSERT_EQ(w->shape[0], d);
+        ASSERT_EQ(w->strides[0], w->dt.size);
+    }
+
+    dispatch_float(x->dt, [&](auto data) {
+        using T = decltype(data);
+        dispatch_integer(q->dt, [&](auto quantized) {
+            using Q = decltype(quantized);
+            plan.dequantize = dequantize<T, Q>;
+            if (w) {
+                // the weight may be stored in a wider type than the activations
+                dispatch_float(w->dt, [&](auto weight) {
+                    plan.quantize = quantize_rms_norm<T, Q, decltype(weight)>;
+                });
+            } else {
+                plan.quantize = quantize<T, Q>;
+            }
+        });
+    });
+    return plan;
+}
+
+QuantizeCpuDescriptor *create_quantize_cpu_descriptor(Device device, QuantizeConfig const *config) {
+    auto descriptor = new QuantizeCpuDescriptor{device};
+    if (config) {
+        descriptor->plan = plan_quantize_cpu(config->q, config->scales, config->zeros, config->x, config->w);
+    }
+    return descriptor;
+}
+
+void quantize_cpu(QuantizeCpuDescriptor const *descriptor, Tensor q, Tensor scales, Tensor zeros, Tensor x, Tensor w, float epsilon, void *stream) {
+    launch(
+        descriptor->plan, [&] { return plan_quantize_cpu(q.layout, scales.layout, zeros.layout, x.layout, w.layout); }, stream,
+        {q.data, scales.data, zeros.data, x.data, w.data},
+        [epsilon](QuantizeCpuPlan const &plan, void *const *data) { plan.quantize(plan, data[0], data[1], data[2], data[3], data[4], epsilon); });
+}
+
+void dequantize_cpu(QuantizeCpuDescriptor const *descriptor, Tensor x, Tensor q, Tensor scales, Tensor zeros, void *stream) {
+    launch(
+        descriptor->plan, [&] { return plan_quantize_cpu(q.layout, scales.layout, zeros.layout, x.layout, nullptr); }, stream,
+        {x.data, q.data, scales.data, zeros.data},
+        [](QuantizeCpuPlan const &plan, void *const *data) { plan.dequantize(plan, data[0], data[1], data[2], data[3]); });
+}
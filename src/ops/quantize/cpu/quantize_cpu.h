@@ -0,0 +1,37 @@
+#ifndef __CPU_QUANTIZE_H__
+#define __CPU_QUANTIZE_H__
+
+#include "operators.h"
+#include "ops/quantize/quantize.h"
+#include <optional>
+
+struct QuantizeCpuPlan;
+typedef void (*QuantizeCpuKernel)(QuantizeCpuPlan const &plan, void *q, void *scales, void *zeros, void const *x, void const *w, float epsilon);
+typedef void (*DequantizeCpuKernel)(QuantizeCpuPlan const &plan, void *x, void const *q, void const *scales, void const *zeros);
+
+// The same layouts serve both ways, so a plan has a kernel for each. That
+// of quantizing normalizes the rows first when planned with a weight.
+struct QuantizeCpuPlan {
+    uint64_t n, d;
+    // byte strides between rows, and between scales and zero points
+    int64_t q_stride, x_stride, scale_stride, zero_stride;
+    bool asymmetric;
+    QuantizeCpuKernel quantize;
+    DequantizeCpuKernel dequantize;
+};
+
+struct QuantizeCpuDescriptor {
+    Device device;
+    std::optional<QuantizeCpuPlan> plan;
+};
+
+QuantizeCpuPlan plan_quantize_cpu(TensorLayout const *q, TensorLayout const *scales, TensorLayout const *zeros, TensorLayout const *x, TensorLayout const *w);
+
+QuantizeCpuDescriptor *create_quantize_cpu_descriptor(Device device, QuantizeConfig const *config);
+
+// quantize, of the rows normalized with `w` unless its layout is NULL
+void quantize_cpu(QuantizeCpuDescriptor const *descriptor, Tensor q, Tensor scales, Tensor zeros, Tensor x, Tensor w, float epsilon, void *stream);
+
+void dequantize_cpu(QuantizeCpuDescriptor const *descriptor, Tensor x, Tensor q, Tensor scales, Tensor zeros, void *stream);
+
+#endif// __CPU_QUANTIZE_H__
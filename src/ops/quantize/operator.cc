@@ -0,0 +1,92 @@
+#include "../profile.h"
+#include "../utils.h"
+#include "ops/quantize/quantize.h"
+
+#ifdef ENABLE_CPU
+#include "cpu/quantize_cpu.h"
+#endif
+
+struct QuantizeDescriptor {
+    Device device;
+};
+
+__C void *createQuantizeDescriptor(Device device, void *config) {
+    switch (device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            return (QuantizeDescriptor *) create_quantize_cpu_descriptor(device, (QuantizeConfig const *) config);
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+    return nullptr;
+}
+
+__C void destroyQuantizeDescriptor(QuantizeDescriptor *descriptor) {
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            delete (QuantizeCpuDescriptor *) (descriptor);
+            break;
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+}
+
+__C void getQuantizeWorkspaceSize(QuantizeDescriptor *descriptor, uint64_t *size) {
+    *size = 0;
+}
+
+static double quantized_bytes(Tensor q, Tensor scales, Tensor zeros, Tensor x) {
+    auto bytes = tensor_bytes(q.layout) + tensor_bytes(scales.layout) + tensor_bytes(x.layout);
+    return zeros.layout ? bytes + tensor_bytes(zeros.layout) : bytes;
+}
+
+__C void quantize(QuantizeDescriptor *descriptor, void *workspace, uint64_t workspace_size,
+                  Tensor q, Tensor scales, Tensor zeros, Tensor x, void *stream) {
+    ProfileScope profile("quantize", [&] {
+        return OpCost{shape_bucket(q.layout), quantized_bytes(q, scales, zeros, x), 3 * tensor_elements(x.layout)};
+    });
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            quantize_cpu((QuantizeCpuDescriptor *) descriptor, q, scales, zeros, x, Tensor{nullptr, nullptr}, 0, stream);
+            break;
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+}
+
+__C void quantizeRMSNorm(QuantizeDescriptor *descriptor, void *workspace, uint64_t workspace_size,
+                         Tensor q, Tensor scales, Tensor zeros, Tensor x, Tensor w, float epsilon, void *stream) {
+    ProfileScope profile("quantize_rms_norm", [&] {
+        return OpCost{shape_bucket(q.layout), quantized_bytes(q, scales, zeros, x) + tensor_bytes(w.layout), 7 * tensor_elements(x.layout)};
+    });
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            quantize_cpu((QuantizeCpuDescriptor *) descriptor, q, scales, zeros, x, w, epsilon, stream);
+            break;
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+}
+
+__C void dequantize(QuantizeDescriptor *descriptor, void *workspace, uint64_t workspace_size,
+                    Tensor x, Tensor q, Tensor scales, Tensor zeros, void *stream) {
+    ProfileScope profile("dequantize", [&] {
+        return OpCost{shape_bucket(x.layout), quantized_bytes(q, scales, zeros, x), 2 * tensor_elements(x.layout)};
+    });
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            dequantize_cpu((QuantizeCpuDescriptor *) descriptor, x, q, scales, zeros, stream);
+            break;
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+}
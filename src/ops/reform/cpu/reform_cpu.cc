@@ -1,59 +1,68 @@
 #include "reform_cpu.h"
 #include "../../../devices/cpu/common_cpu.h"
+#include "../../../devices/cpu/stream.h"
+#include "../../../devices/cpu/thread_pool.h"
 #include "../../utils.h"
 #include <cstring>
-#include <numeric>
 
-inline int indices(int i, int ndim, int64_t *strides, uint64_t *shape) {
-    int ans = 0;
-    for (int j = ndim - 2; j >= 0; --j) {
+inline int64_t indices(uint64_t i, std::vector<int64_t> const &strides, std::vector<uint64_t> const &shape) {
+    int64_t ans = 0;
+    for (int j = int(shape.size()) - 1; j >= 0; --j) {
         ans += (i % shape[j]) * strides[j];
         i /= shape[j];
     }
     return ans;
 }
 
-void copy_contiguous(uint8_t *dst_ptr, uint8_t const *src_ptr, int n, Tensor y, Tensor x) {
-#pragma omp parallel for
-    for (int i = 0; i < n; ++i) {
-        auto dst_offset = indices(i, y.layout->ndim, y.layout->strides, y.layout->shape);
-        auto src_offset = indices(i, y.layout->ndim, x.layout->strides, x.layout->shape);
-        std::memcpy(dst_ptr + dst_offset, src_ptr + src_offset, y.layout->shape[y.layout->ndim - 1] * y.layout->dt.size);
-    }
+void copy_contiguous(ReformCpuPlan const &plan, uint8_t *dst_ptr, uint8_t const *src_ptr) {
+    parallel_for(plan.rows, [&](int64_t begin, int64_t end) {
+        for (auto i = begin; i < end; ++i) {
+            auto dst_offset = indices(i, plan.y_strides, plan.shape);
+            auto src_offset = indices(i, plan.x_strides, plan.shape);
+            std::memcpy(dst_ptr + dst_offset, src_ptr + src_offset, plan.row_bytes);
+        }
+    });
 }
 
-union DataLayout_ {
-    DataLayout i;
-    unsigned short u;
-};
-
-void reform_cpu(Tensor y, Tensor x) {
-    DataLayout_ dl_y, dl_x;
-    dl_y.i = y.layout->dt;
-    dl_x.i = x.layout->dt;
-    ASSERT_EQ(dl_y.u, dl_x.u);
-    ASSERT_EQ(y.layout->ndim, x.layout->ndim);
-    auto ndim = y.layout->ndim;
+ReformCpuPlan plan_reform_cpu(TensorLayout const *y, TensorLayout const *x) {
+    ASSERT(dtype_eq(y->dt, x->dt));
+    ASSERT_EQ(y->ndim, x->ndim);
+    auto ndim = y->ndim;
     ASSERT(ndim >= 2);
-    for (int i = 0; i < ndim; ++i) {
-        ASSERT_EQ(y.layout->shape[i], x.layout->shape[i]);
+    for (size_t i = 0; i < ndim; ++i) {
+        ASSERT_EQ(y->shape[i], x->shape[i]);
     }
-    ASSERT_EQ(y.layout->strides[ndim - 1], y.layout->dt.size);
-    ASSERT_EQ(x.layout->strides[ndim - 1], x.layout->dt.size);
-    unsigned int r = 0;
-    if (ndim == 2) {
-        r = y.layout->shape[0];
-    } else if (ndim == 3) {
-        r = y.layout->shape[0] * y.layout->shape[1];
-    } else {
-        for (int i = ndim - 3; i >= 1; --i) {
-            ASSERT_EQ(y.layout->shape[i] * y.layout->strides[i], y.layout->strides[i - 1]);
-            ASSERT_EQ(x.layout->shape[i] * x.layout->strides[i], x.layout->strides[i - 1]);
-        }
-        r = std::accumulate(y.layout->shape, y.layout->shape + ndim - 1, 1, std::multiplies<unsigned int>());
+    ASSERT_EQ(y->strides[ndim - 1], y->dt.size);
+    ASSERT_EQ(x->strides[ndim - 1], x->dt.size);
+    for (int i = int(ndim) - 3; i >= 1; --i) {
+        ASSERT_EQ(y->shape[i] * y->strides[i], y->strides[i - 1]);
+        ASSERT_EQ(x->shape[i] * x->strides[i], x->strides[i - 1]);
+    }
+
+    ReformCpuPlan plan;
+    plan.rows = 1;
+    for (size_t i = 0; i < ndim - 1; ++i) {
+        plan.rows *= y->shape[i];
     }
-    auto dst_ptr = reinterpret_cast<uint8_t *>(y.data);
-    auto src_ptr = reinterpret_cast<uint8_t const *>(x.data);
+    plan.row_bytes = y->shape[ndim - 1] * y->dt.size;
+    plan.shape.assign(y->shape, y->shape + ndim - 1);
+    plan.y_strides.assign(y->strides, y->strides + ndim - 1);
+    plan.x_strides.assign(x->strides, x->strides + ndim - 1);
+    return plan;
+}
+
+ReformCpuDescriptor *create_reform_cpu_descriptor(Device device, ReformConfig const *config) {
+    auto descriptor = new ReformCpuDescriptor{device};
+    if (config) {
+        descriptor->plan = plan_reform_cpu(config->y, config->x);
+    }
+    return descriptor;
+}
 
-    copy_contiguous(dst_ptr, src_ptr, r, y, x);
+void reform_cpu(ReformCpuDescriptor const *descriptor, Tensor y, Tensor x, void *stream) {
+    launch(
+        descriptor->plan, [&] { return plan_reform_cpu(y.layout, x.layout); }, stream, {y.data, x.data},
+        [](ReformCpuPlan const &plan, void *const *data) {
+            copy_contiguous(plan, reinterpret_cast<uint8_t *>(data[0]), reinterpret_cast<uint8_t const *>(data[1]));
+        });
 }
@@ -2,11 +2,27 @@
 #define __CPU_REFORM_H__
 
 #include "operators.h"
+#include "ops/reform/reform.h"
+#include <optional>
+#include <vector>
+
+struct ReformCpuPlan {
+    // number of contiguous rows and the bytes in each
+    uint64_t rows, row_bytes;
+    // shape and byte strides of the dimensions enumerating rows
+    std::vector<uint64_t> shape;
+    std::vector<int64_t> y_strides, x_strides;
+};
 
 struct ReformCpuDescriptor {
     Device device;
+    std::optional<ReformCpuPlan> plan;
 };
 
-void reform_cpu(Tensor y, Tensor x);
+ReformCpuPlan plan_reform_cpu(TensorLayout const *y, TensorLayout const *x);
+
+ReformCpuDescriptor *create_reform_cpu_descriptor(Device device, ReformConfig const *config);
+
+void reform_cpu(ReformCpuDescriptor const *descriptor, Tensor y, Tensor x, void *stream);
 
 #endif// __CPU_REFORM_H__
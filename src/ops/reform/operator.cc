@@ -1,3 +1,4 @@
+#include "../profile.h"
 #include "../utils.h"
 #include "ops/reform/reform.h"
 
@@ -19,7 +20,7 @@ __C ReformDescriptor *createReformDescriptor(Device device, void *config) {
     switch (device) {
 #ifdef ENABLE_CPU
         case DevCpu:
-            return (ReformDescriptor *) (new ReformCpuDescriptor{device});
+            return (ReformDescriptor *) create_reform_cpu_descriptor(device, (ReformConfig const *) config);
 #endif
 #ifdef ENABLE_NV_GPU
         case DevNvGpu: {
@@ -60,11 +61,18 @@ __C void destroyReformDescriptor(ReformDescriptor *descriptor) {
     }
 }
 
-__C void reform(ReformDescriptor *descriptor, Tensor y, Tensor x, void *stream) {
+__C void getReformWorkspaceSize(ReformDescriptor *descriptor, uint64_t *size) {
+    *size = 0;
+}
+
+__C void reform(ReformDescriptor *descriptor, void *workspace, uint64_t workspace_size, Tensor y, Tensor x, void *stream) {
+    ProfileScope profile("reform", [&] {
+        return OpCost{shape_bucket(y.layout), tensor_bytes(y.layout) + tensor_bytes(x.layout), 0};
+    });
     switch (descriptor->device) {
 #ifdef ENABLE_CPU
         case DevCpu:
-            reform_cpu(y, x);
+            reform_cpu((ReformCpuDescriptor *) descriptor, y, x, stream);
             break;
 #endif
 #ifdef ENABLE_NV_GPU
@@ -1,39 +1,35 @@
 ﻿#include "rms_norm_cpu.h"
-#include "../../../devices/cpu/common_cpu.h"
-#include "../../utils.h"
-#include <cmath>
+#include "../../../devices/cpu/stream.h"
+#include <utility>
 
-void rms_norm_cpu_f16(Tensor y, Tensor x, Tensor w, float epsilon) {
-    ASSERT_EQ(y.layout->ndim, 2);
-    ASSERT_EQ(x.layout->ndim, 2);
-    ASSERT_EQ(w.layout->ndim, 1);
-
-    auto n = y.layout->shape[0],
-         d = y.layout->shape[1];
-
-    ASSERT_EQ(x.layout->shape[0], n);
-    ASSERT_EQ(x.layout->shape[1], d);
-    ASSERT_EQ(w.layout->shape[0], d);
-
-    auto stride_y = y.layout->strides[0];
-    auto stride_x = x.layout->strides[0];
-
-    for (size_t i = 0; i < n; ++i) {
-        auto y_ = reinterpret_cast<uint16_t *>(reinterpret_cast<char *>(y.data) + i * stride_y);
-        auto x_ = reinterpret_cast<uint16_t const *>(reinterpret_cast<char const *>(x.data) + i * stride_x);
-        auto w_ = reinterpret_cast<uint16_t const *>(w.data);
+template<class Tdata, class Tweight>
+static void rms_norm(RMSNormCpuPlan const &plan, void *y, void const *x, void const *w, float epsilon) {
+    normalize_rows<Tdata, Tweight>(plan.norm, y, x, nullptr, w, nullptr, [epsilon](Tdata const *x_, uint64_t d) {
+        return std::pair(0.0f, rms_scale(x_, d, epsilon));
+    });
+}
 
-        auto sum_sq = 0.0f;
-        for (size_t j = 0; j < d; ++j) {
-            auto x__ = f16_to_f32(x_[j]);
-            sum_sq += x__ * x__;
-        }
+RMSNormCpuPlan plan_rms_norm_cpu(TensorLayout const *y, TensorLayout const *x, TensorLayout const *w) {
+    RMSNormCpuPlan plan{plan_norm(y, x, w, nullptr)};
+    // the weight may be stored in a wider type than the activations
+    dispatch_float(y->dt, [&](auto data) {
+        dispatch_float(w->dt, [&](auto weight) {
+            plan.kernel = rms_norm<decltype(data), decltype(weight)>;
+        });
+    });
+    return plan;
+}
 
-        auto k = std::pow(sum_sq / d + epsilon, -.5);
-        for (size_t j = 0; j < d; ++j) {
-            auto x__ = f16_to_f32(x_[j]);
-            auto w__ = f16_to_f32(w_[j]);
-            y_[j] = f32_to_f16(k * x__ * w__);
-        }
+RMSNormCpuDescriptor *create_rms_norm_cpu_descriptor(Device device, RMSNormConfig const *config) {
+    auto descriptor = new RMSNormCpuDescriptor{device};
+    if (config) {
+        descriptor->plan = plan_rms_norm_cpu(config->y, config->x, config->w);
     }
+    return descriptor;
+}
+
+void rms_norm_cpu(RMSNormCpuDescriptor const *descriptor, Tensor y, Tensor x, Tensor w, float epsilon, void *stream) {
+    launch(
+        descriptor->plan, [&] { return plan_rms_norm_cpu(y.layout, x.layout, w.layout); }, stream, {y.data, x.data, w.data},
+        [epsilon](RMSNormCpuPlan const &plan, void *const *data) { plan.kernel(plan, data[0], data[1], data[2], epsilon); });
 }
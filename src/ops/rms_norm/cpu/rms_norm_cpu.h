@@ -1,12 +1,28 @@
 ﻿#ifndef __CPU_RMS_NORM_H__
 #define __CPU_RMS_NORM_H__
 
+#include "../../../devices/cpu/norm.h"
 #include "operators.h"
+#include "ops/rms_norm/rms_norm.h"
+#include <optional>
+
+struct RMSNormCpuPlan;
+typedef void (*RMSNormCpuKernel)(RMSNormCpuPlan const &plan, void *y, void const *x, void const *w, float epsilon);
+
+struct RMSNormCpuPlan {
+    NormPlan norm;
+    RMSNormCpuKernel kernel;
+};
 
 struct RMSNormCpuDescriptor {
     Device device;
+    std::optional<RMSNormCpuPlan> plan;
 };
 
-void rms_norm_cpu_f16(Tensor y, Tensor x, Tensor w, float epsilon);
+RMSNormCpuPlan plan_rms_norm_cpu(TensorLayout const *y, TensorLayout const *x, TensorLayout const *w);
+
+RMSNormCpuDescriptor *create_rms_norm_cpu_descriptor(Device device, RMSNormConfig const *config);
+
+void rms_norm_cpu(RMSNormCpuDescriptor const *descriptor, Tensor y, Tensor x, Tensor w, float epsilon, void *stream);
 
 #endif// __CPU_RMS_NORM_H__
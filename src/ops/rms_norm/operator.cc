@@ -1,3 +1,4 @@
+﻿#include "../profile.h"
 #include "../utils.h"
 #include "ops/rms_norm/rms_norm.h"
 
@@ -20,7 +21,7 @@ __C void *createRMSNormDescriptor(Device device, void *config) {
     switch (device) {
 #ifdef ENABLE_CPU
         case DevCpu:
-            return (RMSNormDescriptor *) (new RMSNormCpuDescriptor{device});
+            return (RMSNormDescriptor *) create_rms_norm_cpu_descriptor(device, (RMSNormConfig const *) config);
 #endif
 #ifdef ENABLE_NV_GPU
         case DevNvGpu:
@@ -60,11 +61,18 @@ __C void destroyRMSNormDescriptor(RMSNormDescriptor *descriptor) {
     }
 }
 
-__C void rmsNorm(RMSNormDescriptor *descriptor, Tensor y, Tensor x, Tensor w, float epsilon, void *stream) {
+__C void getRMSNormWorkspaceSize(RMSNormDescriptor *descriptor, uint64_t *size) {
+    *size = 0;
+}
+
+__C void rmsNorm(RMSNormDescriptor *descriptor, void *workspace, uint64_t workspace_size, Tensor y, Tensor x, Tensor w, float epsilon, void *stream) {
+    ProfileScope profile("rms_norm", [&] {
+        return OpCost{shape_bucket(y.layout), tensor_bytes(y.layout) + tensor_bytes(x.layout) + tensor_bytes(w.layout), 4 * tensor_elements(x.layout)};
+    });
     switch (descriptor->device) {
 #ifdef ENABLE_CPU
         case DevCpu:
-            rms_norm_cpu_f16(y, x, w, epsilon);
+            rms_norm_cpu((RMSNormCpuDescriptor *) descriptor, y, x, w, epsilon, stream);
             break;
 #endif
 #ifdef ENABLE_NV_GPU
@@ -1,35 +1,81 @@
 #include "rotary_embedding_cpu.h"
-#include "../../../devices/cpu/common_cpu.h"
+#include "../../../devices/cpu/stream.h"
+#include "../../../devices/cpu/thread_pool.h"
 #include "../../utils.h"
-#include <cmath>
 
-void rotary_embedding_cpu_f16(Tensor t, Tensor pos, float theta) {
-    ASSERT_EQ(t.layout->ndim, 3);
-    ASSERT_EQ(pos.layout->ndim, 1);
-
-    auto nt = t.layout->shape[0],
-         nh = t.layout->shape[1],
-         dh = t.layout->shape[2] / 2;
+// the offsets of packed sequences are widened into the workspace
+template<class T>
+static void rotary_embedding(RotaryEmbeddingCpuPlan const &plan, void *t, void const *pos, void const *cu_seqlens,
+                             void const *start_pos, float theta, Workspace const &workspace) {
+    auto nh = plan.nh,
+         dh = plan.dh;
+    int64_t *offsets = nullptr;
+    if (plan.varlen) {
+        offsets = static_cast<int64_t *>(workspace.get(seq_offsets_bytes(plan.cu_seqlens)));
+        read_seq_offsets(plan.cu_seqlens, cu_seqlens, offsets, plan.nt);
+    }
 
-    ASSERT_EQ(pos.layout->shape[0], nt);
+    parallel_for(plan.nt * nh, [&](int64_t begin, int64_t end) {
+        for (auto item = begin; item < end; ++item) {
+            auto i = item / nh,
+                 j = item % nh;
+            unsigned int pos__;
+            if (plan.varlen) {
+                // counted along its sequence, from where it starts
+                auto s = sequence_of(offsets, plan.cu_seqlens.sequences, i);
+                auto start = plan.start_stride ? *reinterpret_cast<unsigned int const *>(reinterpret_cast<char const *>(start_pos) + s * plan.start_stride) : 0;
+                pos__ = start + unsigned(i - offsets[s]);
+            } else {
+                pos__ = reinterpret_cast<unsigned int const *>(pos)[i];
+            }
+            auto t_ = reinterpret_cast<T *>(reinterpret_cast<char *>(t) + i * plan.stride_0 + j * plan.stride_1);
+            rotate_pairs(t_, t_, dh, pos__, theta);
+        }
+    });
+}
 
-    auto stride_0 = t.layout->strides[0];
-    auto stride_1 = t.layout->strides[1];
+RotaryEmbeddingCpuPlan plan_rotary_embedding_cpu(TensorLayout const *t, TensorLayout const *pos, TensorLayout const *cu_seqlens, TensorLayout const *start_pos) {
+    ASSERT_EQ(t->ndim, 3);
+    ASSERT_EQ(t->strides[2], t->dt.size);
 
-    for (int i = 0; i < nt; ++i) {
-        auto pos_ = reinterpret_cast<unsigned int const *>(pos.data) + i;
-        for (int j = 0; j < nh; ++j) {
-            auto t_ = reinterpret_cast<uint16_t *>(reinterpret_cast<char *>(t.data) + i * stride_0 + j * stride_1);
-            for (int k = 0; k < dh; ++k) {
-                auto a = f16_to_f32(t_[2 * k]);
-                auto b = f16_to_f32(t_[2 * k + 1]);
-                auto pos__ = *pos_;
-                float freq = float(pos__) / powf(theta, float(k) / float(dh));
-                float sin = sinf(freq);
-                float cos = cosf(freq);
-                t_[2 * k] = f32_to_f16(a * cos - b * sin);
-                t_[2 * k + 1] = f32_to_f16(a * sin + b * cos);
-            }
+    RotaryEmbeddingCpuPlan plan{t->shape[0], t->shape[1], t->shape[2] / 2, t->strides[0], t->strides[1], cu_seqlens != nullptr};
+    if (plan.varlen) {
+        plan.cu_seqlens = plan_seq_offsets(cu_seqlens);
+        plan.start_stride = 0;
+        if (start_pos) {
+            ASSERT_EQ(start_pos->ndim, 1);
+            ASSERT_EQ(start_pos->shape[0], plan.cu_seqlens.sequences);
+            ASSERT_EQ(start_pos->dt.size, 4);
+            plan.start_stride = start_pos->strides[0];
         }
+    } else {
+        ASSERT_EQ(pos->ndim, 1);
+        ASSERT_EQ(pos->shape[0], t->shape[0]);
     }
+    dispatch_float(t->dt, [&](auto data) {
+        plan.kernel = rotary_embedding<decltype(data)>;
+    });
+    return plan;
+}
+
+RotaryEmbeddingCpuDescriptor *create_rotary_embedding_cpu_descriptor(Device device, RotaryEmbeddingConfig const *config) {
+    auto descriptor = new RotaryEmbeddingCpuDescriptor{device};
+    if (config) {
+        descriptor->plan = plan_rotary_embedding_cpu(config->t, config->pos, config->cu_seqlens, config->start_pos);
+    }
+    return descriptor;
+}
+
+uint64_t get_rotary_embedding_cpu_workspace_size(RotaryEmbeddingCpuDescriptor const *descriptor) {
+    return descriptor->plan && descriptor->plan->varlen ? seq_offsets_bytes(descriptor->plan->cu_seqlens) : 0;
+}
+
+void rotary_embedding_cpu(RotaryEmbeddingCpuDescriptor const *descriptor, void *workspace, uint64_t workspace_size, Tensor t, Tensor pos,
+                          Tensor cu_seqlens, Tensor start_pos, float theta, void *stream) {
+    launch(
+        descriptor->plan, [&] { return plan_rotary_embedding_cpu(t.layout, pos.layout, cu_seqlens.layout, start_pos.layout); }, stream,
+        Workspace{workspace, workspace_size}, {t.data, pos.data, cu_seqlens.data, start_pos.data},
+        [theta](RotaryEmbeddingCpuPlan const &plan, void *const *data, Workspace const &workspace) {
+            plan.kernel(plan, data[0], data[1], data[2], data[3], theta, workspace);
+        });
 }
@@ -1,12 +1,57 @@
 #ifndef __CPU_ROTARY_EMBEDDING_H__
 #define __CPU_ROTARY_EMBEDDING_H__
 
+#include "../../../devices/cpu/arena.h"
+#include "../../../devices/cpu/common_cpu.h"
+#include "../../../devices/cpu/seqlens.h"
 #include "operators.h"
+#include "ops/rotary_embedding/rotary_embedding.h"
+#include <cmath>
+#include <optional>
+
+// Rotates the `dh` interleaved pairs of `x` by angles `pos` / theta^(k / dh)
+// into `y`, which may be `x`.
+template<class T>
+void rotate_pairs(T *y, T const *x, uint64_t dh, unsigned int pos, float theta) {
+    for (size_t k = 0; k < dh; ++k) {
+        auto a = to_f32(x[2 * k]);
+        auto b = to_f32(x[2 * k + 1]);
+        float freq = float(pos) / powf(theta, float(k) / float(dh));
+        float sin = sinf(freq);
+        float cos = cosf(freq);
+        y[2 * k] = from_f32<T>(a * cos - b * sin);
+        y[2 * k + 1] = from_f32<T>(a * sin + b * cos);
+    }
+}
+
+struct RotaryEmbeddingCpuPlan;
+typedef void (*RotaryEmbeddingCpuKernel)(RotaryEmbeddingCpuPlan const &plan, void *t, void const *pos, void const *cu_seqlens,
+                                         void const *start_pos, float theta, Workspace const &workspace);
+
+struct RotaryEmbeddingCpuPlan {
+    uint64_t nt, nh, dh;
+    // byte strides of the token and head dimensions
+    int64_t stride_0, stride_1;
+    // whether the positions are counted along packed sequences instead of given,
+    // and from where; `start_stride` is 0 when every sequence starts at 0
+    bool varlen;
+    SeqOffsetsCpuLayout cu_seqlens;
+    int64_t start_stride;
+    RotaryEmbeddingCpuKernel kernel;
+};
 
 struct RotaryEmbeddingCpuDescriptor {
     Device device;
+    std::optional<RotaryEmbeddingCpuPlan> plan;
 };
 
-void rotary_embedding_cpu_f16(Tensor t, Tensor pos, float theta);
+RotaryEmbeddingCpuPlan plan_rotary_embedding_cpu(TensorLayout const *t, TensorLayout const *pos, TensorLayout const *cu_seqlens, TensorLayout const *start_pos);
+
+RotaryEmbeddingCpuDescriptor *create_rotary_embedding_cpu_descriptor(Device device, RotaryEmbeddingConfig const *config);
+
+uint64_t get_rotary_embedding_cpu_workspace_size(RotaryEmbeddingCpuDescriptor const *descriptor);
+
+void rotary_embedding_cpu(RotaryEmbeddingCpuDescriptor const *descriptor, void *workspace, uint64_t workspace_size, Tensor t, Tensor pos,
+                          Tensor cu_seqlens, Tensor start_pos, float theta, void *stream);
 
-#endif// __CPU_RMS_NORM_H__
+#endif// __CPU_ROTARY_EMBEDDING_H__
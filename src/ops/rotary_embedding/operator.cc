@@ -1,3 +1,4 @@
+#include "../profile.h"
 #include "../utils.h"
 #include "ops/rotary_embedding/rotary_embedding.h"
 
@@ -19,7 +20,7 @@ __C void *createRotaryEmbeddingDescriptor(Device device, void *config) {
     switch (device) {
 #ifdef ENABLE_CPU
         case DevCpu:
-            return (RotaryEmbeddingDescriptor *) (new RotaryEmbeddingCpuDescriptor{device});
+            return (RotaryEmbeddingDescriptor *) create_rotary_embedding_cpu_descriptor(device, (RotaryEmbeddingConfig const *) config);
 #endif
 #ifdef ENABLE_NV_GPU
         case DevNvGpu:
@@ -63,11 +64,26 @@ __C void destroyRotaryEmbeddingDescriptor(RotaryEmbeddingDescriptor *descriptor)
     }
 }
 
-__C void rotaryEmbedding(RotaryEmbeddingDescriptor *descriptor, Tensor t, Tensor pos, float theta, void *stream) {
+__C void getRotaryEmbeddingWorkspaceSize(RotaryEmbeddingDescriptor *descriptor, uint64_t *size) {
     switch (descriptor->device) {
 #ifdef ENABLE_CPU
         case DevCpu:
-            rotary_embedding_cpu_f16(t, pos, theta);
+            *size = get_rotary_embedding_cpu_workspace_size((RotaryEmbeddingCpuDescriptor *) descriptor);
+            break;
+#endif
+        default:
+            *size = 0;
+    }
+}
+
+__C void rotaryEmbedding(RotaryEmbeddingDescriptor *descriptor, void *workspace, uint64_t workspace_size, Tensor t, Tensor pos, float theta, void *stream) {
+    ProfileScope profile("rotary_embedding", [&] {
+        return OpCost{shape_bucket(t.layout), 2 * tensor_bytes(t.layout) + tensor_bytes(pos.layout), 3 * tensor_elements(t.layout)};
+    });
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            rotary_embedding_cpu((RotaryEmbeddingCpuDescriptor *) descriptor, workspace, workspace_size, t, pos, Tensor{nullptr, nullptr}, Tensor{nullptr, nullptr}, theta, stream);
             break;
 #endif
 #ifdef ENABLE_NV_GPU
@@ -84,3 +100,19 @@ __C void rotaryEmbedding(RotaryEmbeddingDescriptor *descriptor, Tensor t, Tensor
             PANIC(UnsupportedDevice);
     }
 };
+
+__C void rotaryEmbeddingVarlen(RotaryEmbeddingDescriptor *descriptor, void *workspace, uint64_t workspace_size, Tensor t,
+                               Tensor cu_seqlens, Tensor start_pos, float theta, void *stream) {
+    ProfileScope profile("rotary_embedding_varlen", [&] {
+        return OpCost{shape_bucket(t.layout), 2 * tensor_bytes(t.layout) + tensor_bytes(cu_seqlens.layout), 3 * tensor_elements(t.layout)};
+    });
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            rotary_embedding_cpu((RotaryEmbeddingCpuDescriptor *) descriptor, workspace, workspace_size, t, Tensor{nullptr, nullptr}, cu_seqlens, start_pos, theta, stream);
+            break;
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+}
@@ -0,0 +1,292 @@
+#include "sample_cpu.h"
+#include "../../../devices/cpu/common_cpu.h"
+#include "../../../devices/cpu/stream.h"
+#include "../../../devices/cpu/thread_pool.h"
+#include "../../utils.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Vocab entries one task scores: small enough that every thread gets a
+// share of a decode step, large enough that few candidates are merged.
+constexpr static uint64_t SAMPLE_MIN_SLICE = 256, SAMPLE_MAX_SLICE = 4096;
+
+namespace {
+
+struct Candidate {
+    float value;
+    uint32_t index;
+};
+
+// higher logits first, the lower index of equal ones
+inline bool better(Candidate const &a, Candidate const &b) {
+    return a.value > b.value || (a.value == b.value && a.index < b.index);
+}
+
+// How a call splits the workspace: the `keep` best candidates of every slice
+// of every row, then per thread the logits of a slice and the hidden states.
+struct SampleLayout {
+    uint64_t slice, slices, keep;
+    size_t candidates_bytes, logits_bytes, thread_bytes;
+
+    SampleLayout(SampleCpuPlan const &plan, uint64_t k, int threads) {
+        slice = std::clamp<uint64_t>(ROUND_UP_DIV(plan.vocab, uint64_t(2 * threads)), SAMPLE_MIN_SLICE, SAMPLE_MAX_SLICE);
+        slices = ROUND_UP_DIV(plan.vocab, slice);
+        keep = std::min(k, slice);
+        candidates_bytes = align_workspace(plan.batch * slices * keep * sizeof(Candidate));
+        logits_bytes = align_workspace(plan.batch * slice * sizeof(float));
+        thread_bytes = logits_bytes + align_workspace(plan.batch * plan.dim * sizeof(float));
+    }
+
+    size_t bytes(int threads) const { return candidates_bytes + threads * thread_bytes; }
+};
+
+}// namespace
+
+// Writes the `keep` best of `len` logits to `out`, in no particular order,
+// padded with candidates worse than any when there are fewer.
+static void keep_best(float const *logits, uint64_t len, uint64_t offset, uint64_t keep, Candidate *out) {
+    if (keep == 1) {
+        uint64_t best = 0;
+        for (uint64_t j = 1; j < len; ++j) {
+            if (logits[j] > logits[best]) {
+                best = j;
+            }
+        }
+        out[0] = {logits[best], uint32_t(offset + best)};
+        return;
+    }
+    auto n = std::min(keep, len);
+    for (uint64_t j = 0; j < n; ++j) {
+        out[j] = {logits[j], uint32_t(offset + j)};
+    }
+    for (uint64_t j = n; j < keep; ++j) {
+        out[j] = {-std::numeric_limits<float>::infinity(), std::numeric_limits<uint32_t>::max()};
+    }
+    if (len <= keep) {
+        return;
+    }
+    // a heap whose front is the worst candidate kept
+    std::make_heap(out, out + keep, better);
+    for (auto j = keep; j < len; ++j) {
+        Candidate c{logits[j], uint32_t(offset + j)};
+        if (better(c, out[0])) {
+            std::pop_heap(out, out + keep, better);
+            out[keep - 1] = c;
+            std::push_heap(out, out + keep, better);
+        }
+    }
+}
+
+// a number in [0, 1) from splitmix64 of the seed and the row
+static float uniform(uint64_t seed, uint64_t row) {
+    uint64_t z = seed + (row + 1) * 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    z ^= z >> 31;
+    return float(z >> 40) * 0x1p-24f;
+}
+
+// draws from the `k` candidates sorted best first, overwriting their values
+// with the cumulative probability
+static uint32_t draw(Candidate *candidates, uint64_t k, SampleCpuParams const &params, uint64_t row) {
+    auto max = candidates[0].value;
+    float total = 0;
+    for (uint64_t j = 0; j < k; ++j) {
+        candidates[j].value = total += std::exp((candidates[j].value - max) / params.temperature);
+    }
+    // the fewest candidates holding a fraction `topp` of the probability
+    auto n = k;
+    for (uint64_t j = 0; j < k; ++j) {
+        if (candidates[j].value >= params.topp * total) {
+            n = j + 1;
+            break;
+        }
+    }
+    auto u = uniform(params.seed, row) * candidates[n - 1].value;
+    for (uint64_t j = 0; j + 1 < n; ++j) {
+        if (u < candidates[j].value) {
+            return candidates[j].index;
+        }
+    }
+    return candidates[n - 1].index;
+}
+
+static bool greedy(SampleCpuParams const &params) {
+    return params.temperature <= 0 || params.topk == 1;
+}
+
+// Every task loads the logits of a slice of the vocab for all rows and keeps
+// their best candidates, then the candidates of each row are merged and one
+// is drawn.
+static void sample(SampleCpuPlan const &plan, SampleCpuParams const &params,
+                   void *result, void const *source, void const *weight, Workspace const &workspace) {
+    auto threads = ThreadPool::instance().threads();
+    auto k = greedy(params) ? 1 : params.topk == 0 ? plan.vocab
+                                                   : std::min(params.topk, plan.vocab);
+    SampleLayout layout(plan, k, threads);
+    auto scratch = static_cast<char *>(workspace.get(layout.bytes(threads)));
+    auto candidates = reinterpret_cast<Candidate *>(scratch);
+    auto per_row = layout.slices * layout.keep;
+
+    parallel_for(layout.slices, [&](int64_t slices_begin, int64_t slices_end, int thread) {
+        auto slice = scratch + layout.candidates_bytes + thread * layout.thread_bytes;
+        auto logits = reinterpret_cast<float *>(slice);
+        auto hidden = reinterpret_cast<float *>(slice + layout.logits_bytes);
+        for (auto s = uint64_t(slices_begin); s < uint64_t(slices_end); ++s) {
+            auto begin = s * layout.slice,
+                 end = std::min(begin + layout.slice, plan.vocab);
+            plan.load(plan, logits, hidden, source, weight, begin, end);
+            for (uint64_t i = 0; i < plan.batch; ++i) {
+                keep_best(logits + i * (end - begin), end - begin, begin, layout.keep, candidates + i * per_row + s * layout.keep);
+            }
+        }
+    });
+
+    parallel_for(plan.batch, [&](int64_t rows_begin, int64_t rows_end) {
+        for (auto i = uint64_t(rows_begin); i < uint64_t(rows_end); ++i) {
+            auto row = candidates + i * per_row;
+            if (k < per_row) {
+                std::nth_element(row, row + k - 1, row + per_row, better);
+            }
+            std::sort(row, row + k, better);
+            auto token = greedy(params) ? row[0].index : draw(row, k, params, i);
+            auto out = static_cast<char *>(result) + i * plan.result_stride;
+            if (plan.result_size == 8) {
+                *reinterpret_cast<int64_t *>(out) = token;
+            } else {
+                *reinterpret_cast<int32_t *>(out) = int32_t(token);
+            }
+        }
+    });
+}
+
+template<class T>
+static void load_logits(SampleCpuPlan const &plan, float *logits, float *, void const *source, void const *, uint64_t begin, uint64_t end) {
+    auto len = end - begin;
+    for (uint64_t i = 0; i < plan.batch; ++i) {
+        auto row = reinterpret_cast<T const *>(source) + i * plan.source_stride + begin;
+        for (uint64_t j = 0; j < len; ++j) {
+            logits[i * len + j] = to_f32(row[j]);
+        }
+    }
+}
+
+template<class T>
+static void load_hidden(SampleCpuPlan const &plan, float *hidden, void const *source) {
+    for (uint64_t i = 0; i < plan.batch; ++i) {
+        auto row = reinterpret_cast<T const *>(source) + i * plan.source_stride;
+        for (uint64_t d = 0; d < plan.dim; ++d) {
+            hidden[i * plan.dim + d] = to_f32(row[d]);
+        }
+    }
+}
+
+// weight contiguous along dim: a dot product per logit, each column of the
+// weight read once for all rows
+template<class T>
+static void load_matmul_dot(SampleCpuPlan const &plan, float *logits, float *hidden, void const *source, void const *weight, uint64_t begin, uint64_t end) {
+    load_hidden<T>(plan, hidden, source);
+    auto len = end - begin;
+    for (auto v = begin; v < end; ++v) {
+        auto column = reinterpret_cast<T const *>(weight) + v * plan.weight_vocab_stride;
+        for (uint64_t i = 0; i < plan.batch; ++i) {
+            logits[i * len + v - begin] = dot(hidden + i * plan.dim, column, plan.dim);
+        }
+    }
+}
+
+// weight contiguous along vocab: its rows are scaled into the logits, each
+// read once for all rows
+template<class T>
+static void load_matmul_axpy(SampleCpuPlan const &plan, float *logits, float *hidden, void const *source, void const *weight, uint64_t begin, uint64_t end) {
+    load_hidden<T>(plan, hidden, source);
+    auto len = end - begin;
+    std::fill(logits, logits + plan.batch * len, 0.0f);
+    for (uint64_t d = 0; d < plan.dim; ++d) {
+        auto row = reinterpret_cast<T const *>(weight) + d * plan.weight_dim_stride + begin;
+        for (uint64_t i = 0; i < plan.batch; ++i) {
+            auto h = hidden[i * plan.dim + d];
+            auto out = logits + i * len;
+            for (uint64_t j = 0; j < len; ++j) {
+                out[j] += h * to_f32(row[j]);
+            }
+        }
+    }
+}
+
+static SampleCpuPlan plan_result(TensorLayout const *result, uint64_t vocab) {
+    ASSERT_EQ(result->ndim, 1);
+    ASSERT(dtype_eq(result->dt, I32) || dtype_eq(result->dt, I64));
+    ASSERT(vocab > 0 && vocab < std::numeric_limits<uint32_t>::max());
+    SampleCpuPlan plan{};
+    plan.batch = result->shape[0];
+    plan.vocab = vocab;
+    plan.result_stride = result->strides[0];
+    plan.result_size = result->dt.size;
+    return plan;
+}
+
+SampleCpuPlan plan_sample_cpu(TensorLayout const *result, TensorLayout const *logits) {
+    ASSERT_EQ(logits->ndim, 2);
+    ASSERT_EQ(logits->strides[1], logits->dt.size);
+    auto plan = plan_result(result, logits->shape[1]);
+    ASSERT_EQ(logits->shape[0], plan.batch);
+    plan.source_stride = logits->strides[0] / logits->dt.size;
+    dispatch_float(logits->dt, [&](auto t) {
+        plan.load = load_logits<decltype(t)>;
+    });
+    return plan;
+}
+
+SampleCpuPlan plan_sample_matmul_cpu(TensorLayout const *result, TensorLayout const *hidden, TensorLayout const *weight) {
+    ASSERT_EQ(hidden->ndim, 2);
+    ASSERT_EQ(weight->ndim, 2);
+    ASSERT(dtype_eq(hidden->dt, weight->dt));
+    ASSERT_EQ(hidden->strides[1], hidden->dt.size);
+    ASSERT_EQ(weight->shape[0], hidden->shape[1]);
+    auto plan = plan_result(result, weight->shape[1]);
+    ASSERT_EQ(hidden->shape[0], plan.batch);
+    plan.dim = hidden->shape[1];
+    plan.source_stride = hidden->strides[0] / hidden->dt.size;
+    plan.weight_dim_stride = weight->strides[0] / weight->dt.size;
+    plan.weight_vocab_stride = weight->strides[1] / weight->dt.size;
+    auto along_dim = plan.weight_dim_stride == 1;
+    ASSERT(along_dim || plan.weight_vocab_stride == 1);
+    dispatch_float(hidden->dt, [&](auto t) {
+        plan.load = along_dim ? load_matmul_dot<decltype(t)> : load_matmul_axpy<decltype(t)>;
+    });
+    return plan;
+}
+
+SampleCpuDescriptor *create_sample_cpu_descriptor(Device device, SampleConfig const *config) {
+    auto descriptor = new SampleCpuDescriptor{device};
+    if (config) {
+        descriptor->plan = config->logits ? plan_sample_cpu(config->result, config->logits)
+                                          : plan_sample_matmul_cpu(config->result, config->hidden, config->weight);
+    }
+    return descriptor;
+}
+
+uint64_t get_sample_cpu_workspace_size(SampleCpuDescriptor const *descriptor) {
+    if (!descriptor->plan) {
+        return 0;
+    }
+    // every logit a candidate, as when `topk` is 0
+    auto threads = ThreadPool::instance().threads();
+    return SampleLayout(*descriptor->plan, descriptor->plan->vocab, threads).bytes(threads);
+}
+
+void sample_cpu(SampleCpuDescriptor const *descriptor, void *workspace, uint64_t workspace_size,
+                Tensor result, Tensor logits, SampleCpuParams params, void *stream) {
+    launch(
+        descriptor->plan, [&] { return plan_sample_cpu(result.layout, logits.layout); }, stream, Workspace{workspace, workspace_size}, {result.data, logits.data},
+        [params](SampleCpuPlan const &plan, void *const *data, Workspace const &workspace) { sample(plan, params, data[0], data[1], nullptr, workspace); });
+}
+
+void sample_matmul_cpu(SampleCpuDescriptor const *descriptor, void *workspace, uint64_t workspace_size,
+                       Tensor result, Tensor hidden, Tensor weight, SampleCpuParams params, void *stream) {
+    launch(
+        descriptor->plan, [&] { return plan_sample_matmul_cpu(result.layout, hidden.layout, weight.layout); }, stream, Workspace{workspace, workspace_size}, {result.data, hidden.data, weight.data},
+        [params](SampleCpuPlan const &plan, void *const *data, Workspace const &workspace) { sample(plan, params, data[0], data[1], data[2], workspace); });
+}
@@ -0,0 +1,52 @@
+#ifndef __CPU_SAMPLE_H__
+#define __CPU_SAMPLE_H__
+
+#include "../../../devices/cpu/arena.h"
+#include "operators.h"
+#include "ops/sample/sample.h"
+#include <optional>
+
+struct SampleCpuPlan;
+// Writes the f32 logits of every row for the vocab slice [begin, end) to
+// `logits`, row after row `end - begin` apart. `scratch` holds `dim` floats
+// of every row.
+typedef void (*SampleCpuLoad)(SampleCpuPlan const &plan, float *logits, float *scratch, void const *source, void const *weight, uint64_t begin, uint64_t end);
+
+struct SampleCpuPlan {
+    // `dim` is 0 unless the logits are computed from hidden states
+    uint64_t batch, vocab, dim;
+    // byte stride and size of the elements of result
+    int64_t result_stride;
+    uint64_t result_size;
+    // element strides of the rows of logits or hidden, and of weight along dim and vocab
+    int64_t source_stride, weight_dim_stride, weight_vocab_stride;
+    SampleCpuLoad load;
+};
+
+struct SampleCpuParams {
+    float temperature;
+    uint64_t topk;
+    float topp;
+    uint64_t seed;
+};
+
+struct SampleCpuDescriptor {
+    Device device;
+    std::optional<SampleCpuPlan> plan;
+};
+
+SampleCpuPlan plan_sample_cpu(TensorLayout const *result, TensorLayout const *logits);
+
+SampleCpuPlan plan_sample_matmul_cpu(TensorLayout const *result, TensorLayout const *hidden, TensorLayout const *weight);
+
+SampleCpuDescriptor *create_sample_cpu_descriptor(Device device, SampleConfig const *config);
+
+uint64_t get_sample_cpu_workspace_size(SampleCpuDescriptor const *descriptor);
+
+void sample_cpu(SampleCpuDescriptor const *descriptor, void *workspace, uint64_t workspace_size,
+                Tensor result, Tensor logits, SampleCpuParams params, void *stream);
+
+void sample_matmul_cpu(SampleCpuDescriptor const *descriptor, void *workspace, uint64_t workspace_size,
+                       Tensor result, Tensor hidden, Tensor weight, SampleCpuParams params, void *stream);
+
+#endif// __CPU_SAMPLE_H__
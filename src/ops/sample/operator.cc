@@ -0,0 +1,82 @@
+#include "../profile.h"
+#include "../utils.h"
+#include "ops/sample/sample.h"
+
+#ifdef ENABLE_CPU
+#include "cpu/sample_cpu.h"
+#endif
+
+struct SampleDescriptor {
+    Device device;
+};
+
+__C void *createSampleDescriptor(Device device, void *config) {
+    switch (device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            return (SampleDescriptor *) create_sample_cpu_descriptor(device, (SampleConfig const *) config);
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+    return nullptr;
+}
+
+__C void destroySampleDescriptor(SampleDescriptor *descriptor) {
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            delete (SampleCpuDescriptor *) (descriptor);
+            break;
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+}
+
+__C void getSampleWorkspaceSize(SampleDescriptor *descriptor, uint64_t *size) {
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            *size = get_sample_cpu_workspace_size((SampleCpuDescriptor *) descriptor);
+            break;
+#endif
+        default:
+            *size = 0;
+    }
+}
+
+__C void sample(SampleDescriptor *descriptor, void *workspace, uint64_t workspace_size, Tensor result, Tensor logits,
+                float temperature, uint64_t topk, float topp, uint64_t seed, void *stream) {
+    ProfileScope profile("sample", [&] {
+        return OpCost{shape_bucket(logits.layout), tensor_bytes(logits.layout) + tensor_bytes(result.layout), 2 * tensor_elements(logits.layout)};
+    });
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            sample_cpu((SampleCpuDescriptor *) descriptor, workspace, workspace_size, result, logits, {temperature, topk, topp, seed}, stream);
+            break;
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+}
+
+__C void sampleMatmul(SampleDescriptor *descriptor, void *workspace, uint64_t workspace_size, Tensor result, Tensor hidden, Tensor weight,
+                      float temperature, uint64_t topk, float topp, uint64_t seed, void *stream) {
+    ProfileScope profile("sample_matmul", [&] {
+        auto dim = hidden.layout->shape[1];
+        return OpCost{shape_bucket(weight.layout) + " m" + std::to_string(pow2_bucket(hidden.layout->shape[0])),
+                      tensor_bytes(hidden.layout) + tensor_bytes(weight.layout) + tensor_bytes(result.layout),
+                      2.0 * hidden.layout->shape[0] * dim * weight.layout->shape[1]};
+    });
+    switch (descriptor->device) {
+#ifdef ENABLE_CPU
+        case DevCpu:
+            sample_matmul_cpu((SampleCpuDescriptor *) descriptor, workspace, workspace_size, result, hidden, weight, {temperature, topk, topp, seed}, stream);
+            break;
+#endif
+        default:
+            PANIC(UnsupportedDevice);
+    }
+}
@@ -1,12 +1,18 @@
 #ifndef __CPU_SWIGLU_H__
 #define __CPU_SWIGLU_H__
 
+#include "../../activation/cpu/activation_cpu.h"
 #include "operators.h"
+#include "ops/swiglu/swiglu.h"
+#include <optional>
 
 struct SwigluCpuDescriptor {
     Device device;
+    std::optional<ActivationCpuPlan> plan;
 };
 
-void swiglu_cpu_f16(Tensor gate, Tensor up);
+SwigluCpuDescriptor *create_swiglu_cpu_descriptor(Device device, SwigluConfig const *config);
+
+void swiglu_cpu(SwigluCpuDescriptor const *descriptor, Tensor gate, Tensor up, void *stream);
 
 #endif// __CPU_SWIGLU_H__
@@ -1,3 +1,4 @@
+#include "../profile.h"
 #include "../utils.h"
 #include "ops/swiglu/swiglu.h"
 
@@ -20,7 +21,7 @@ __C void *createSwigluDescriptor(Device device, void *config) {
     switch (device) {
 #ifdef ENABLE_CPU
     case DevCpu:
-        return (SwigluDescriptor *) (new SwigluCpuDescriptor{device});
+        return (SwigluDescriptor *) create_swiglu_cpu_descriptor(device, (SwigluConfig const *) config);
 #endif
 #ifdef ENABLE_NV_GPU
     case DevNvGpu:
@@ -64,11 +65,18 @@ __C void destroySwigluDescriptor(SwigluDescriptor *descriptor) {
     }
 }
 
-__C void swiglu(SwigluDescriptor *descriptor, Tensor gate, Tensor up, void *stream) {
+__C void getSwigluWorkspaceSize(SwigluDescriptor *descriptor, uint64_t *size) {
+    *size = 0;
+}
+
+__C void swiglu(SwigluDescriptor *descriptor, void *workspace, uint64_t workspace_size, Tensor gate, Tensor up, void *stream) {
+    ProfileScope profile("swiglu", [&] {
+        return OpCost{shape_bucket(gate.layout), 2 * tensor_bytes(gate.layout) + tensor_bytes(up.layout), 4 * tensor_elements(gate.layout)};
+    });
     switch (descriptor->device) {
 #ifdef ENABLE_CPU
         case DevCpu:
-            swiglu_cpu_f16(gate, up);
+            swiglu_cpu((SwigluCpuDescriptor *) descriptor, gate, up, stream);
             break;
 #endif
 #ifdef ENABLE_NV_GPU
@@ -1,6 +1,8 @@
 #ifndef __UTILS_H__
 #define __UTILS_H__
 
+#include "data_type.h"
+#include "tensor.h"
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -22,5 +24,27 @@ inline void assert_true(int expr, const char *msg, const char *file, int line) {
     printf("Error at %s:%d - %s\n", __FILE__, __LINE__, #EXPR); \
     exit(EXIT_FAILURE)
 
+// check if two data layouts describe the same data type
+inline bool dtype_eq(DataLayout a, DataLayout b) {
+    return a.packed == b.packed &&
+           a.sign == b.sign &&
+           a.size == b.size &&
+           a.mantissa == b.mantissa &&
+           a.exponent == b.exponent;
+}
+
+// check if two tensor layouts have the same data type, shape and strides
+inline bool layout_eq(TensorLayout const *a, TensorLayout const *b) {
+    if (!dtype_eq(a->dt, b->dt) || a->ndim != b->ndim) {
+        return false;
+    }
+    for (uint64_t i = 0; i < a->ndim; ++i) {
+        if (a->shape[i] != b->shape[i] || a->strides[i] != b->strides[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
 #define ROUND_UP_DIV(x, y) ((x + y - 1) / y)
 #endif// __UTILS_H__
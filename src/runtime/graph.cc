@@ -0,0 +1,44 @@
+#include "runtime/graph.h"
+#ifdef ENABLE_CPU
+#include "../devices/cpu/stream.h"
+#endif
+
+#ifdef ENABLE_CPU
+
+__C __export void beginCpuStreamCapture(void *stream) {
+    static_cast<CpuStream *>(stream)->begin_capture();
+}
+
+__C __export void *endCpuStreamCapture(void *stream) {
+    return static_cast<CpuStream *>(stream)->end_capture();
+}
+
+__C __export void destroyCpuGraph(void *graph) {
+    delete static_cast<CpuGraph *>(graph);
+}
+
+__C __export void updateCpuGraph(void *graph, CpuGraphBinding const *bindings, int num_bindings) {
+    for (auto &call : static_cast<CpuGraph *>(graph)->calls) {
+        for (auto &data : call.data) {
+            auto ptr = reinterpret_cast<uintptr_t>(data);
+            for (int i = 0; i < num_bindings; ++i) {
+                auto old_data = reinterpret_cast<uintptr_t>(bindings[i].old_data);
+                if (bindings[i].size == 0 ? ptr == old_data : ptr - old_data < bindings[i].size) {
+                    data = static_cast<char *>(bindings[i].new_data) + (ptr - old_data);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+__C __export void launchCpuGraph(void *graph, void *stream) {
+    auto graph_ = static_cast<CpuGraph *>(graph);
+    if (stream) {
+        static_cast<CpuStream *>(stream)->enqueue({[graph_](void *const *) { (*graph_)(); }, {}});
+    } else {
+        (*graph_)();
+    }
+}
+
+#endif
@@ -0,0 +1,52 @@
+#include "runtime/numa.h"
+#include <cstdlib>
+#include <cstring>
+#ifdef ENABLE_CPU
+#include "../devices/cpu/numa.h"
+#include "../devices/cpu/thread_pool.h"
+#endif
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+__C __export int getNumaNodeCount() {
+#ifdef ENABLE_CPU
+    return ThreadPool::instance().nodes();
+#else
+    return 1;
+#endif
+}
+
+__C __export void *numaAllocate(uint64_t size) {
+#ifdef _WIN32
+    return _aligned_malloc(size, 4096);
+#else
+    // anonymous mappings get their pages on first touch
+    auto ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return ptr == MAP_FAILED ? nullptr : ptr;
+#endif
+}
+
+__C __export void numaFree(void *ptr, uint64_t size) {
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    if (ptr) {
+        munmap(ptr, size);
+    }
+#endif
+}
+
+__C __export void numaPlace(void *dst, void const *src, uint64_t rows, uint64_t row_bytes, NumaPlacement placement) {
+#ifdef ENABLE_CPU
+    numa_place(dst, src, rows, row_bytes, placement == NumaInterleave);
+#else
+    if (src) {
+        std::memcpy(dst, src, rows * row_bytes);
+    } else {
+        std::memset(dst, 0, rows * row_bytes);
+    }
+#endif
+}
@@ -0,0 +1,210 @@
+#include "runtime/profile.h"
+#include "../ops/profile.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// a log histogram of nanoseconds, 16 buckets per power of two
+constexpr static int BUCKETS_PER_OCTAVE = 16, BUCKETS = 40 * BUCKETS_PER_OCTAVE;
+constexpr static size_t TRACE_CAPACITY = size_t(1) << 20;
+
+static int bucket_of(int64_t ns) {
+    auto bucket = int(std::log2(double(std::max<int64_t>(ns, 1))) * BUCKETS_PER_OCTAVE);
+    return std::min(bucket, BUCKETS - 1);
+}
+
+namespace {
+
+struct Entry {
+    std::string op, shape;
+    uint64_t calls;
+    int64_t total, min, max;
+    double bytes, flops;
+    std::array<uint64_t, BUCKETS> histogram;
+
+    // microseconds below which a fraction `q` of the calls took
+    double percentile(double q) const {
+        auto rank = uint64_t(std::ceil(q * calls));
+        uint64_t seen = 0;
+        for (int bucket = 0; bucket < BUCKETS; ++bucket) {
+            if ((seen += histogram[bucket]) >= rank) {
+                auto ns = std::exp2((bucket + 0.5) / BUCKETS_PER_OCTAVE);
+                return std::clamp(ns, double(min), double(max)) * 1e-3;
+            }
+        }
+        return max * 1e-3;
+    }
+};
+
+struct Event {
+    uint32_t entry, thread;
+    int64_t begin, end;
+};
+
+struct Profiler {
+    std::mutex mutex;
+    std::vector<Entry> entries;
+    std::unordered_map<std::string, uint32_t> index;
+    // the last `TRACE_CAPACITY` calls, `next` the oldest once it is full
+    std::vector<Event> trace;
+    size_t next = 0;
+    std::string trace_path;
+
+    int dump(char const *path);
+
+    ~Profiler() {
+        if (!trace_path.empty()) {
+            dump(trace_path.c_str());
+        }
+    }
+};
+
+}// namespace
+
+static Profiler &profiler() {
+    static Profiler profiler;
+    return profiler;
+}
+
+static bool enabled_by_env() {
+    auto env = std::getenv("INFINI_PROFILE");
+    if (!env || !*env || !std::strcmp(env, "0")) {
+        return false;
+    }
+    if (std::strcmp(env, "1")) {
+        profiler().trace_path = env;
+    }
+    return true;
+}
+
+std::atomic<bool> profiling(enabled_by_env());
+
+int64_t profile_clock() {
+    static auto epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+static uint32_t thread_index() {
+    static std::atomic<uint32_t> threads(0);
+    thread_local uint32_t index = threads++;
+    return index;
+}
+
+void profile_record(char const *op, OpCost const &cost, int64_t begin, int64_t end) {
+    auto &p = profiler();
+    auto ns = end - begin;
+    auto thread = thread_index();
+    std::lock_guard<std::mutex> lock(p.mutex);
+
+    auto key = std::string(op) + ' ' + cost.shape;
+    auto it = p.index.find(key);
+    if (it == p.index.end()) {
+        it = p.index.emplace(std::move(key), uint32_t(p.entries.size())).first;
+        p.entries.push_back({op, cost.shape, 0, 0, ns, ns, 0, 0, {}});
+    }
+    auto &e = p.entries[it->second];
+    ++e.calls;
+    e.total += ns;
+    e.min = std::min(e.min, ns);
+    e.max = std::max(e.max, ns);
+    e.bytes += cost.bytes;
+    e.flops += cost.flops;
+    ++e.histogram[bucket_of(ns)];
+
+    Event event{it->second, thread, begin, end};
+    if (p.trace.size() < TRACE_CAPACITY) {
+        p.trace.push_back(event);
+    } else {
+        p.trace[p.next] = event;
+        p.next = (p.next + 1) % TRACE_CAPACITY;
+    }
+}
+
+double tensor_elements(TensorLayout const *layout) {
+    double elements = 1;
+    for (uint64_t i = 0; i < layout->ndim; ++i) {
+        elements *= layout->shape[i];
+    }
+    return elements;
+}
+
+std::string shape_bucket(TensorLayout const *layout) {
+    auto const &dt = layout->dt;
+    std::string s = dt.exponent == 0                   ? (dt.sign ? "i" : "u") + std::to_string(dt.size * 8)
+                    : dt.size == 2 && dt.mantissa == 7 ? "bf16"
+                    : dt.size == 1                     ? "e" + std::to_string(dt.exponent) + "m" + std::to_string(dt.mantissa)
+                                                       : "f" + std::to_string(dt.size * 8);
+    for (uint64_t i = 0; i < layout->ndim; ++i) {
+        s += (i ? 'x' : ' ') + std::to_string(pow2_bucket(layout->shape[i]));
+    }
+    return s;
+}
+
+__C __export void setProfiling(int enabled) {
+    profiling.store(enabled != 0);
+}
+
+__C __export int isProfiling() {
+    return profiling.load();
+}
+
+__C __export uint64_t getProfileCount() {
+    auto &p = profiler();
+    std::lock_guard<std::mutex> lock(p.mutex);
+    return p.entries.size();
+}
+
+__C __export void getProfile(uint64_t index, OpProfile *profile) {
+    auto &p = profiler();
+    std::lock_guard<std::mutex> lock(p.mutex);
+    auto const &e = p.entries.at(index);
+    std::memset(profile, 0, sizeof(OpProfile));
+    std::strncpy(profile->op, e.op.c_str(), sizeof(profile->op) - 1);
+    std::strncpy(profile->shape, e.shape.c_str(), sizeof(profile->shape) - 1);
+    profile->calls = e.calls;
+    profile->total_us = e.total * 1e-3;
+    profile->min_us = e.min * 1e-3;
+    profile->max_us = e.max * 1e-3;
+    profile->p50_us = e.percentile(0.5);
+    profile->p90_us = e.percentile(0.9);
+    profile->p99_us = e.percentile(0.99);
+    profile->bytes = e.bytes;
+    profile->flops = e.flops;
+}
+
+__C __export void resetProfile() {
+    auto &p = profiler();
+    std::lock_guard<std::mutex> lock(p.mutex);
+    p.entries.clear();
+    p.index.clear();
+    p.trace.clear();
+    p.next = 0;
+}
+
+int Profiler::dump(char const *path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto file = std::fopen(path, "w");
+    if (!file) {
+        return -1;
+    }
+    std::fprintf(file, "{\"traceEvents\": [");
+    for (size_t i = 0; i < trace.size(); ++i) {
+        auto const &event = trace[(next + i) % trace.size()];
+        auto const &e = entries[event.entry];
+        std::fprintf(file, "%s\n{\"name\": \"%s\", \"cat\": \"op\", \"ph\": \"X\", \"pid\": 0, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f, \"args\": {\"shape\": \"%s\"}}",
+                     i ? "," : "", e.op.c_str(), event.thread, event.begin * 1e-3, (event.end - event.begin) * 1e-3, e.shape.c_str());
+    }
+    std::fprintf(file, "\n], \"displayTimeUnit\": \"ns\"}\n");
+    return std::fclose(file) == 0 ? 0 : -1;
+}
+
+__C __export int dumpProfileTrace(char const *path) {
+    return profiler().dump(path);
+}
@@ -0,0 +1,53 @@
+#include "runtime/stream.h"
+#ifdef ENABLE_CPU
+#include "../devices/cpu/stream.h"
+#endif
+
+#ifdef ENABLE_CPU
+
+__C __export void *createCpuStream() {
+    return new CpuStream;
+}
+
+__C __export void destroyCpuStream(void *stream) {
+    delete static_cast<CpuStream *>(stream);
+}
+
+__C __export void synchronizeCpuStream(void *stream) {
+    static_cast<CpuStream *>(stream)->synchronize();
+}
+
+__C __export void *createCpuEvent() {
+    return new CpuEvent{nullptr, 0};
+}
+
+__C __export void destroyCpuEvent(void *event) {
+    delete static_cast<CpuEvent *>(event);
+}
+
+__C __export void recordCpuEvent(void *event, void *stream) {
+    auto stream_ = static_cast<CpuStream *>(stream);
+    *static_cast<CpuEvent *>(event) = {stream_, stream_->enqueued()};
+}
+
+__C __export int queryCpuEvent(void *event) {
+    auto event_ = static_cast<CpuEvent *>(event);
+    // like cuda, an event never recorded counts as reached
+    return !event_->stream || event_->stream->completed(event_->position);
+}
+
+__C __export void synchronizeCpuEvent(void *event) {
+    auto event_ = static_cast<CpuEvent *>(event);
+    if (event_->stream) {
+        event_->stream->wait(event_->position);
+    }
+}
+
+__C __export void cpuStreamWaitEvent(void *stream, void *event) {
+    auto event_ = *static_cast<CpuEvent *>(event);
+    if (event_.stream && event_.stream != stream) {
+        static_cast<CpuStream *>(stream)->enqueue({[event_](void *const *) { event_.stream->wait(event_.position); }, {}});
+    }
+}
+
+#endif
@@ -0,0 +1,22 @@
+#include "runtime/thread_pool.h"
+#ifdef ENABLE_CPU
+#include "../devices/cpu/thread_pool.h"
+#endif
+
+__C __export void setCpuThreadPool(int num_threads, int const *cores, int num_cores) {
+#ifdef ENABLE_CPU
+    std::vector<int> list;
+    if (cores) {
+        list.assign(cores, cores + num_cores);
+    }
+    ThreadPool::instance().configure(num_threads, list);
+#endif
+}
+
+__C __export int getCpuThreadPoolSize() {
+#ifdef ENABLE_CPU
+    return ThreadPool::instance().threads();
+#else
+    return 1;
+#endif
+}
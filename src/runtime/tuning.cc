@@ -0,0 +1,34 @@
+#include "runtime/tuning.h"
+#ifdef ENABLE_CPU
+#include "../devices/cpu/tuning.h"
+#endif
+
+__C __export void setAutotune(int enabled) {
+#ifdef ENABLE_CPU
+    set_autotuning(enabled != 0);
+#endif
+}
+
+__C __export int isAutotuning() {
+#ifdef ENABLE_CPU
+    return autotuning();
+#else
+    return 0;
+#endif
+}
+
+__C __export int loadTuningCache(char const *path) {
+#ifdef ENABLE_CPU
+    return tuning_load(path);
+#else
+    return -1;
+#endif
+}
+
+__C __export int saveTuningCache(char const *path) {
+#ifdef ENABLE_CPU
+    return tuning_save(path);
+#else
+    return -1;
+#endif
+}
@@ -0,0 +1,607 @@
+#include "runtime/weights.h"
+#include "../ops/utils.h"
+#include "tensor/tensor_descriptor.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// the data of a written file starts at a multiple of this many bytes
+constexpr uint64_t WEIGHT_ALIGNMENT = 64;
+// metadata key listing the weights stored transposed, one per line
+constexpr char const *TRANSPOSED_KEY = "infini.transposed";
+
+struct WeightType {
+    char const *name;
+    DataLayout dt;
+};
+
+const WeightType WEIGHT_TYPES[] = {
+    {"F16", F16}, {"BF16", BF16}, {"F32", F32}, {"F64", F64}, {"F8_E4M3", F8E4M3}, {"F8_E5M2", F8E5M2},
+    {"I8", I8}, {"I16", I16}, {"I32", I32}, {"I64", I64}, {"U8", U8}, {"U16", U16}, {"U32", U32}, {"U64", U64},
+};
+
+struct Weight {
+    std::string name, dtype;
+    // shape as stored, which for a transposed weight has its last two
+    // dimensions swapped from those of `layout`
+    std::vector<uint64_t> shape;
+    bool transposed;
+    // offset from the start of the data and bytes
+    uint64_t offset, bytes;
+    // bytes of an element and the layout, 0 and NULL for a data type
+    // without one, whose bytes are only copied
+    uint64_t element;
+    TensorDescriptor layout;
+};
+
+// The subset of JSON a safetensors header is: objects, arrays, strings and
+// unsigned integers, with anything else only skipped. Parsing stops at the
+// first error, after which every result is empty.
+struct HeaderParser {
+    char const *p, *end;
+    bool failed = false;
+
+    void fail() {
+        failed = true;
+        p = end;
+    }
+
+    void skip_space() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+            ++p;
+        }
+    }
+
+    bool consume(char c) {
+        skip_space();
+        if (p < end && *p == c) {
+            ++p;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c) {
+        if (!consume(c)) {
+            fail();
+        }
+    }
+
+    // whether a list continues after an element, consuming `,` or `close`
+    bool next(char close) {
+        if (consume(',')) {
+            return true;
+        }
+        expect(close);
+        return false;
+    }
+
+    void append_utf8(std::string &s, uint32_t c) {
+        if (c < 0x80) {
+            s += char(c);
+        } else if (c < 0x800) {
+            s += char(0xc0 | c >> 6);
+            s += char(0x80 | (c & 0x3f));
+        } else if (c < 0x10000) {
+            s += char(0xe0 | c >> 12);
+            s += char(0x80 | (c >> 6 & 0x3f));
+            s += char(0x80 | (c & 0x3f));
+        } else {
+            s += char(0xf0 | c >> 18);
+            s += char(0x80 | (c >> 12 & 0x3f));
+            s += char(0x80 | (c >> 6 & 0x3f));
+            s += char(0x80 | (c & 0x3f));
+        }
+    }
+
+    uint32_t hex4() {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i, ++p) {
+            if (p >= end) {
+                fail();
+                return 0;
+            }
+            char c = *p;
+            value = value << 4 | (c >= '0' && c <= '9'   ? c - '0'
+                                  : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                                  : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                                                         : (fail(), 0));
+        }
+        return value;
+    }
+
+    std::string string() {
+        std::string s;
+        expect('"');
+        while (p < end && *p != '"') {
+            if ((unsigned char) *p < 0x20) {
+                fail();
+                break;
+            }
+            if (*p != '\\') {
+                s += *p++;
+                continue;
+            }
+            if (++p >= end) {
+                break;
+            }
+            switch (*p++) {
+                case '"': s += '"'; break;
+                case '\\': s += '\\'; break;
+                case '/': s += '/'; break;
+                case 'b': s += '\b'; break;
+                case 'f': s += '\f'; break;
+                case 'n': s += '\n'; break;
+                case 'r': s += '\r'; break;
+                case 't': s += '\t'; break;
+                case 'u': {
+                    auto c = hex4();
+                    // a high surrogate pairs with the low one escaped next,
+                    // and neither stands alone
+                    if (c >= 0xd800 && c < 0xdc00) {
+                        if (end - p < 6 || p[0] != '\\' || p[1] != 'u') {
+                            fail();
+                            break;
+                        }
+                        p += 2;
+                        auto low = hex4();
+                        if (low < 0xdc00 || low >= 0xe000) {
+                            fail();
+                            break;
+                        }
+                        c = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+                    } else if (c >= 0xdc00 && c < 0xe000) {
+                        fail();
+                        break;
+                    }
+                    append_utf8(s, c);
+                    break;
+                }
+                default: fail();
+            }
+        }
+        expect('"');
+        return failed ? std::string() : s;
+    }
+
+    uint64_t number() {
+        skip_space();
+        if (p >= end || *p < '0' || *p > '9') {
+            fail();
+            return 0;
+        }
+        uint64_t value = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            auto digit = uint64_t(*p++ - '0');
+            if (value > (UINT64_MAX - digit) / 10) {
+                fail();
+                return 0;
+            }
+            value = value * 10 + digit;
+        }
+        return value;
+    }
+
+    std::vector<uint64_t> numbers() {
+        std::vector<uint64_t> values;
+        expect('[');
+        if (!consume(']')) {
+            do {
+                values.push_back(number());
+            } while (!failed && next(']'));
+        }
+        return values;
+    }
+
+    void skip_value() {
+        skip_space();
+        if (p >= end) {
+            fail();
+        } else if (*p == '"') {
+            string();
+        } else if (consume('[')) {
+            if (!consume(']')) {
+                do {
+                    skip_value();
+                } while (!failed && next(']'));
+            }
+        } else if (consume('{')) {
+            if (!consume('}')) {
+                do {
+                    string();
+                    expect(':');
+                    skip_value();
+                } while (!failed && next('}'));
+            }
+        } else {
+            // numbers, true, false and null
+            auto start = p;
+            while (p < end && (std::isalnum((unsigned char) *p) || *p == '-' || *p == '+' || *p == '.')) {
+                ++p;
+            }
+            if (p == start) {
+                fail();
+            }
+        }
+    }
+};
+
+uint64_t align_weight(uint64_t offset) {
+    return (offset + WEIGHT_ALIGNMENT - 1) / WEIGHT_ALIGNMENT * WEIGHT_ALIGNMENT;
+}
+
+std::string escape_json(std::string const &s) {
+    std::string out;
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += char(c);
+        } else if (c < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else {
+            out += char(c);
+        }
+    }
+    return out;
+}
+
+}// namespace
+
+struct WeightFile {
+    void const *map = nullptr;
+    uint64_t size = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE, mapping = nullptr;
+#endif
+    uint8_t const *data = nullptr;
+    // those of a data type with a layout, and the others
+    std::vector<Weight> weights, raw;
+    std::unordered_map<std::string, uint64_t> index;
+    std::unordered_map<std::string, std::string> metadata;
+
+    ~WeightFile() {
+        for (auto const &weight : weights) {
+            if (weight.layout) {
+                destroyTensorDescriptor(weight.layout);
+            }
+        }
+#ifdef _WIN32
+        if (map) {
+            UnmapViewOfFile(map);
+        }
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+        }
+#else
+        if (map) {
+            munmap(const_cast<void *>(map), size);
+        }
+#endif
+    }
+
+    bool map_file(char const *path) {
+#ifdef _WIN32
+        file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        LARGE_INTEGER bytes;
+        if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &bytes) || bytes.QuadPart == 0) {
+            return false;
+        }
+        size = uint64_t(bytes.QuadPart);
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        map = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        return map != nullptr;
+#else
+        auto fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            close(fd);
+            return false;
+        }
+        size = uint64_t(st.st_size);
+        // shared, so that processes serving the same model share its pages
+        auto ptr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (ptr == MAP_FAILED) {
+            return false;
+        }
+        map = ptr;
+        return true;
+#endif
+    }
+
+    bool parse_header() {
+        auto bytes = static_cast<uint8_t const *>(map);
+        if (size < 8) {
+            return false;
+        }
+        // the header length is little endian
+        uint64_t header = 0;
+        for (int i = 7; i >= 0; --i) {
+            header = header << 8 | bytes[i];
+        }
+        if (header > size - 8) {
+            return false;
+        }
+        data = bytes + 8 + header;
+        auto data_size = size - 8 - header;
+
+        HeaderParser parser{reinterpret_cast<char const *>(bytes + 8), reinterpret_cast<char const *>(data)};
+        parser.expect('{');
+        if (!parser.consume('}')) {
+            do {
+                auto name = parser.string();
+                parser.expect(':');
+                if (name == "__metadata__") {
+                    parser.expect('{');
+                    if (!parser.consume('}')) {
+                        do {
+                            auto key = parser.string();
+                            parser.expect(':');
+                            metadata[key] = parser.string();
+                        } while (!parser.failed && parser.next('}'));
+                    }
+                    continue;
+                }
+                Weight weight{name, "", {}, false, 0, 0, 0, nullptr};
+                std::vector<uint64_t> offsets;
+                parser.expect('{');
+                if (!parser.consume('}')) {
+                    do {
+                        auto key = parser.string();
+                        parser.expect(':');
+                        if (key == "dtype") {
+                            weight.dtype = parser.string();
+                        } else if (key == "shape") {
+                            weight.shape = parser.numbers();
+                        } else if (key == "data_offsets") {
+                            offsets = parser.numbers();
+                        } else {
+                            parser.skip_value();
+                        }
+                    } while (!parser.failed && parser.next('}'));
+                }
+                if (parser.failed || weight.dtype.empty() || offsets.size() != 2 || offsets[0] > offsets[1] || offsets[1] > data_size) {
+                    return false;
+                }
+                weight.offset = offsets[0];
+                weight.bytes = offsets[1] - offsets[0];
+                weights.push_back(std::move(weight));
+            } while (!parser.failed && parser.next('}'));
+        }
+        if (parser.failed) {
+            return false;
+        }
+
+        std::unordered_set<std::string> transposed;
+        if (auto it = metadata.find(TRANSPOSED_KEY); it != metadata.end()) {
+            for (size_t begin = 0, end; begin < it->second.size(); begin = end + 1) {
+                end = std::min(it->second.find('\n', begin), it->second.size());
+                transposed.insert(it->second.substr(begin, end - begin));
+            }
+        }
+
+        std::unordered_set<std::string> names;
+        for (auto const &weight : weights) {
+            if (!names.insert(weight.name).second) {
+                return false;
+            }
+        }
+        std::stable_sort(weights.begin(), weights.end(), [](Weight const &a, Weight const &b) { return a.offset < b.offset; });
+        auto kept = weights.begin();
+        for (auto &weight : weights) {
+            auto type = std::find_if(std::begin(WEIGHT_TYPES), std::end(WEIGHT_TYPES), [&](WeightType const &t) { return weight.dtype == t.name; });
+            auto ndim = weight.shape.size();
+            weight.transposed = transposed.count(weight.name) && ndim >= 2;
+            if (type == std::end(WEIGHT_TYPES)) {
+                raw.push_back(std::move(weight));
+                continue;
+            }
+            weight.element = type->dt.size;
+            // dense strides of the stored shape, in bytes
+            std::vector<uint64_t> shape = weight.shape;
+            std::vector<int64_t> strides(ndim);
+            uint64_t elements = 1;
+            for (size_t i = ndim; i-- > 0;) {
+                strides[i] = int64_t(elements * type->dt.size);
+                if (shape[i] && elements > UINT64_MAX / shape[i]) {
+                    return false;
+                }
+                elements *= shape[i];
+            }
+            if (elements > UINT64_MAX / type->dt.size || elements * type->dt.size != weight.bytes) {
+                return false;
+            }
+            if (weight.transposed) {
+                std::swap(shape[ndim - 2], shape[ndim - 1]);
+                std::swap(strides[ndim - 2], strides[ndim - 1]);
+            }
+            createTensorDescriptor(&weight.layout, ndim, shape.data(), strides.data(), type->dt);
+            if (&*kept != &weight) {
+                *kept = std::move(weight);
+                // owned by `kept` alone, should a later weight fail
+                weight.layout = nullptr;
+            }
+            ++kept;
+        }
+        weights.erase(kept, weights.end());
+        for (uint64_t i = 0; i < weights.size(); ++i) {
+            index.emplace(weights[i].name, i);
+        }
+        return true;
+    }
+
+    // Write the logical tensor of `weight` to `out` densely, with its last
+    // two dimensions swapped when `transpose`.
+    bool write_weight(std::FILE *out, Weight const &weight, bool transpose) const {
+        auto src = data + weight.offset;
+        if (transpose == weight.transposed) {
+            return std::fwrite(src, 1, weight.bytes, out) == weight.bytes;
+        }
+        // a transposition of each (rows, cols) matrix of the stored weight,
+        // a block of rows of the result at a time
+        auto element = weight.element;
+        auto ndim = weight.shape.size();
+        auto rows = weight.shape[ndim - 2], cols = weight.shape[ndim - 1];
+        auto matrices = rows && cols ? weight.bytes / (rows * cols * element) : 0;
+        constexpr uint64_t BLOCK = 32;
+        std::vector<uint8_t> buffer(BLOCK * rows * element);
+        for (uint64_t i = 0; i < matrices; ++i) {
+            auto matrix = src + i * rows * cols * element;
+            for (uint64_t c0 = 0; c0 < cols; c0 += BLOCK) {
+                auto c1 = std::min(c0 + BLOCK, cols);
+                for (uint64_t r0 = 0; r0 < rows; r0 += BLOCK) {
+                    auto r1 = std::min(r0 + BLOCK, rows);
+                    for (auto r = r0; r < r1; ++r) {
+                        for (auto c = c0; c < c1; ++c) {
+                            std::memcpy(&buffer[((c - c0) * rows + r) * element], matrix + (r * cols + c) * element, element);
+                        }
+                    }
+                }
+                auto bytes = (c1 - c0) * rows * element;
+                if (std::fwrite(buffer.data(), 1, bytes, out) != bytes) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+};
+
+__C __export WeightFile *openWeightFile(char const *path) {
+    auto file = new WeightFile;
+    if (!file->map_file(path) || !file->parse_header()) {
+        delete file;
+        return nullptr;
+    }
+    return file;
+}
+
+__C __export void closeWeightFile(WeightFile *file) {
+    delete file;
+}
+
+__C __export uint64_t getWeightCount(WeightFile *file) {
+    return file->weights.size();
+}
+
+__C __export char const *getWeightName(WeightFile *file, uint64_t index) {
+    ASSERT(index < file->weights.size());
+    return file->weights[index].name.c_str();
+}
+
+__C __export Tensor getWeight(WeightFile *file, char const *name) {
+    auto it = file->index.find(name);
+    if (it == file->index.end()) {
+        return Tensor{nullptr, nullptr};
+    }
+    auto const &weight = file->weights[it->second];
+    return Tensor{weight.layout, const_cast<uint8_t *>(file->data + weight.offset)};
+}
+
+__C __export char const *getWeightMetadata(WeightFile *file, char const *key) {
+    auto it = file->metadata.find(key);
+    return it == file->metadata.end() ? nullptr : it->second.c_str();
+}
+
+__C __export int writePackedWeights(WeightFile *file, char const *path, char const *const *names, uint64_t count) {
+    std::unordered_set<std::string> transposed;
+    for (uint64_t i = 0; i < count; ++i) {
+        auto it = file->index.find(names[i]);
+        if (it == file->index.end() || file->weights[it->second].shape.size() < 2) {
+            return -1;
+        }
+        transposed.insert(names[i]);
+    }
+
+    std::string header = "{\"__metadata__\":{";
+    auto metadata = file->metadata;
+    metadata.erase(TRANSPOSED_KEY);
+    for (auto const &[key, value] : metadata) {
+        header += '"' + escape_json(key) + "\":\"" + escape_json(value) + "\",";
+    }
+    // whether to store a tensor transposed, as it is for bytes only copied
+    auto transpose = [&](Weight const &weight) {
+        return weight.layout ? transposed.count(weight.name) != 0 : weight.transposed;
+    };
+    std::string listed;
+    for (auto const *list : {&file->weights, &file->raw}) {
+        for (auto const &weight : *list) {
+            if (transpose(weight)) {
+                listed += (listed.empty() ? "" : "\n") + weight.name;
+            }
+        }
+    }
+    header += '"' + std::string(TRANSPOSED_KEY) + "\":\"" + escape_json(listed) + "\"}";
+    // Every tensor in order of falling element size, the sizes being powers
+    // of two, so each is aligned to its element with no gaps between them,
+    // which safetensors does not allow. Bytes only copied go last.
+    std::vector<Weight const *> order;
+    for (auto const *list : {&file->weights, &file->raw}) {
+        for (auto const &weight : *list) {
+            order.push_back(&weight);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [](Weight const *a, Weight const *b) { return a->element > b->element; });
+    uint64_t offset = 0;
+    for (auto const *weight : order) {
+        // the stored shape, of the logical layout swapped when transposed
+        auto shape = weight->shape;
+        if (weight->transposed != transpose(*weight)) {
+            std::swap(shape[shape.size() - 2], shape[shape.size() - 1]);
+        }
+        header += ",\"" + escape_json(weight->name) + "\":{\"dtype\":\"" + escape_json(weight->dtype) + "\",\"shape\":[";
+        for (size_t i = 0; i < shape.size(); ++i) {
+            header += (i ? "," : "") + std::to_string(shape[i]);
+        }
+        header += "],\"data_offsets\":[" + std::to_string(offset) + ',' + std::to_string(offset + weight->bytes) + "]}";
+        offset += weight->bytes;
+    }
+    header += '}';
+    // trailing spaces put the data at a multiple of the alignment
+    header.resize(align_weight(8 + header.size()) - 8, ' ');
+
+    // write aside and rename, so a reader never sees half a file
+    auto temp = std::string(path) + ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    auto out = std::fopen(temp.c_str(), "wb");
+    if (!out) {
+        return -1;
+    }
+    uint8_t length[8];
+    for (int i = 0; i < 8; ++i) {
+        length[i] = uint8_t(uint64_t(header.size()) >> (8 * i));
+    }
+    bool ok = std::fwrite(length, 1, 8, out) == 8 && std::fwrite(header.data(), 1, header.size(), out) == header.size();
+    for (size_t i = 0; ok && i < order.size(); ++i) {
+        ok = file->write_weight(out, *order[i], transpose(*order[i]));
+    }
+    ok = std::fclose(out) == 0 && ok;
+    if (!ok) {
+        std::remove(temp.c_str());
+        return -1;
+    }
+    return std::rename(temp.c_str(), path) == 0 ? 0 : -1;
+}
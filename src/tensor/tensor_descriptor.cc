@@ -1,16 +1,115 @@
 #include "tensor/tensor_descriptor.h"
+#include "../ops/utils.h"
 #include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+// point `shape` and `strides` at inline or heap storage and fill them
+static void fill_layout(TensorLayout *layout, uint64_t ndim, uint64_t const *shape, int64_t const *strides, DataLayout datatype) {
+    layout->dt = datatype;
+    layout->ndim = ndim;
+    if (ndim <= TENSOR_INLINE_NDIM) {
+        layout->shape = layout->inline_shape;
+        layout->strides = layout->inline_strides;
+    } else {
+        layout->shape = new uint64_t[ndim];
+        layout->strides = new int64_t[ndim];
+    }
+    std::memcpy(layout->shape, shape, ndim * sizeof(uint64_t));
+    std::memcpy(layout->strides, strides, ndim * sizeof(int64_t));
+}
 
 __C __export void createTensorDescriptor(TensorDescriptor* desc_ptr, uint64_t ndim, uint64_t *shape_, int64_t *strides_, DataLayout datatype) {
-    uint64_t *shape = new uint64_t[ndim];
-    int64_t *strides = new int64_t[ndim];
-    std::memcpy(shape, shape_, ndim * sizeof(uint64_t));
-    std::memcpy(strides, strides_, ndim * sizeof(int64_t));
-    *desc_ptr = new TensorLayout{datatype, ndim, shape, strides};
+    auto layout = new TensorLayout;
+    fill_layout(layout, ndim, shape_, strides_, datatype);
+    *desc_ptr = layout;
 }
 
 __C __export void destroyTensorDescriptor(TensorDescriptor desc){
-    delete[] desc->shape;
-    delete[] desc->strides;
+    if (desc->shape != desc->inline_shape) {
+        delete[] desc->shape;
+        delete[] desc->strides;
+    }
     delete desc;
 }
+
+__C __export void initTensorDescriptor(TensorLayout *layout, uint64_t ndim, uint64_t const *shape, int64_t const *strides, DataLayout datatype) {
+    ASSERT(ndim <= TENSOR_INLINE_NDIM);
+    fill_layout(layout, ndim, shape, strides, datatype);
+}
+
+// FNV-1a over data type, shape and strides
+static uint64_t layout_hash(uint64_t ndim, uint64_t const *shape, int64_t const *strides, DataLayout dt) {
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&](uint64_t value) {
+        hash ^= value;
+        hash *= 1099511628211ull;
+    };
+    mix(uint64_t(dt.packed) | uint64_t(dt.sign) << 8 | uint64_t(dt.size) << 9 | uint64_t(dt.mantissa) << 16 | uint64_t(dt.exponent) << 24);
+    mix(ndim);
+    for (uint64_t i = 0; i < ndim; ++i) {
+        mix(shape[i]);
+        mix(uint64_t(strides[i]));
+    }
+    return hash;
+}
+
+static bool layout_matches(TensorLayout const *layout, uint64_t ndim, uint64_t const *shape, int64_t const *strides, DataLayout dt) {
+    return dtype_eq(layout->dt, dt) &&
+           layout->ndim == ndim &&
+           std::memcmp(layout->shape, shape, ndim * sizeof(uint64_t)) == 0 &&
+           std::memcmp(layout->strides, strides, ndim * sizeof(int64_t)) == 0;
+}
+
+// Interns layouts: a cached descriptor lives until the cache is cleared, so
+// one handed out stays valid however many other layouts are requested after
+// it, from any thread. Layouts that differ per call, such as one growing
+// with the KV length, belong in `initTensorDescriptor` instead.
+static struct DescriptorCache {
+    std::shared_mutex mutex;
+    std::unordered_multimap<uint64_t, TensorDescriptor> map;
+
+    TensorDescriptor find(uint64_t hash, uint64_t ndim, uint64_t const *shape, int64_t const *strides, DataLayout dt) {
+        auto range = map.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (layout_matches(it->second, ndim, shape, strides, dt)) {
+                return it->second;
+            }
+        }
+        return nullptr;
+    }
+
+    ~DescriptorCache() { clear(); }
+
+    void clear() {
+        for (auto &entry : map) {
+            destroyTensorDescriptor(entry.second);
+        }
+        map.clear();
+    }
+} cache;
+
+__C __export void getCachedTensorDescriptor(TensorDescriptor *desc_ptr, uint64_t ndim, uint64_t const *shape, int64_t const *strides, DataLayout datatype) {
+    auto hash = layout_hash(ndim, shape, strides, datatype);
+    {
+        std::shared_lock<std::shared_mutex> lock(cache.mutex);
+        if ((*desc_ptr = cache.find(hash, ndim, shape, strides, datatype))) {
+            return;
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(cache.mutex);
+    // another thread may have added it in between
+    if ((*desc_ptr = cache.find(hash, ndim, shape, strides, datatype))) {
+        return;
+    }
+    auto layout = new TensorLayout;
+    fill_layout(layout, ndim, shape, strides, datatype);
+    cache.map.emplace(hash, layout);
+    *desc_ptr = layout;
+}
+
+__C __export void clearTensorDescriptorCache() {
+    std::unique_lock<std::shared_mutex> lock(cache.mutex);
+    cache.clear();
+}
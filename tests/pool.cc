@@ -0,0 +1,79 @@
+// Stress test of `Pool`: threads pop values, check nobody else holds them
+// and push them back, while the pool stays full, nearly empty or in between.
+#include "../src/devices/pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#define CHECK(expr)                                                          \
+    if (!(expr)) {                                                           \
+        fprintf(stderr, "check failed: %s at line %d\n", #expr, __LINE__); \
+        exit(EXIT_FAILURE);                                                  \
+    }
+
+// `values` values in a pool of `capacity`, shared by `threads` threads
+static void stress(size_t capacity, size_t values, int threads, int rounds) {
+    Pool<std::unique_ptr<size_t>> pool(capacity);
+    std::vector<std::atomic<int>> holders(values);
+    for (size_t i = 0; i < values; ++i) {
+        CHECK(pool.push(std::make_unique<size_t>(i)));
+    }
+    CHECK(values < capacity || !pool.push(std::make_unique<size_t>(values)));
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            std::vector<std::unique_ptr<size_t>> held;
+            for (int r = 0; r < rounds; ++r) {
+                // hold up to three values at once to vary the pool depth
+                for (int k = 0; k <= (r + t) % 3; ++k) {
+                    auto val = pool.pop();
+                    if (!val) {
+                        break;
+                    }
+                    CHECK(*val && **val < values);
+                    CHECK(holders[**val].fetch_add(1) == 0);
+                    held.push_back(std::move(*val));
+                }
+                for (auto &val : held) {
+                    holders[*val].fetch_sub(1);
+                    CHECK(pool.push(std::move(val)));
+                }
+                held.clear();
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    // every value is back exactly once
+    std::vector<int> seen(values);
+    while (auto val = pool.pop()) {
+        ++seen[**val];
+    }
+    for (size_t i = 0; i < values; ++i) {
+        CHECK(seen[i] == 1);
+    }
+}
+
+int main(int argc, char **argv) {
+    auto rounds = argc > 1 ? std::atoi(argv[1]) : 100000;
+    auto threads = int(std::max(4u, 2 * std::thread::hardware_concurrency()));
+    stress(64, 64, threads, rounds);
+    stress(64, 3, threads, rounds);
+    stress(1024, 200, threads, rounds);
+    stress(1, 1, threads, rounds);
+
+    Pool<int> empty(0);
+    CHECK(!empty.push(1) && !empty.pop());
+    Pool<int> moved(std::move(empty));
+    CHECK(!moved.push(1) && !empty.pop());
+
+    printf("pool test passed\n");
+    return 0;
+}
@@ -40,8 +40,9 @@ if has_config("cpu") then
 
         set_languages("cxx17")
         add_files("src/devices/cpu/*.cc", "src/ops/*/cpu/*.cc")
-        add_cxflags("-fopenmp")
-        add_ldflags("-fopenmp")
+        if not is_plat("windows") then
+            add_syslinks("pthread", {public = true})
+        end
     target_end()
 
 end
@@ -133,6 +134,7 @@ target("operators")
     set_languages("cxx17")
     add_files("src/ops/*/operator.cc")
     add_files("src/tensor/*.cc")
+    add_files("src/runtime/*.cc")
 target_end()
 
 target("main")
@@ -143,6 +145,29 @@ target("main")
     add_files("src/main.c")
 target_end()
 
+target("bench")
+    set_kind("binary")
+    set_default(false)
+    add_deps("operators")
+
+    set_languages("cxx17")
+    add_files("bench/*.cc")
+    if not is_plat("windows") then
+        add_syslinks("pthread")
+    end
+target_end()
+
+target("pool-test")
+    set_kind("binary")
+    set_default(false)
+
+    set_languages("cxx17")
+    add_files("tests/pool.cc")
+    if not is_plat("windows") then
+        add_syslinks("pthread")
+    end
+target_end()
+
 task("install-operators")
     set_menu {
         usage = "xmake install-operators",